@@ -27,10 +27,13 @@
 #include "UDPDumper.h"
 #include "remoterateestimator.h"
 #include "EventLoop.h"
+#include "FlatHashMap.h"
 #include "Datachannels.h"
 #include "Endpoint.h"
 #include "SRTPSession.h"
 #include "SendSideBandwidthEstimation.h"
+#include "Pacer.h"
+#include "rtp/TransportWideCCReceiveStats.h"
 
 class DTLSICETransport : 
 	public RTPSender,
@@ -63,11 +66,11 @@ public:
 	class Sender
 	{
 	public:
-		virtual int Send(const ICERemoteCandidate *candiadte, Packet&& buffer, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback = std::nullopt) = 0;
+		virtual int Send(const ICERemoteCandidate *candiadte, Packet&& buffer, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback = std::nullopt, EventLoop::Priority priority = EventLoop::Priority::Control) = 0;
 	};
 
 public:
-	DTLSICETransport(Sender *sender,TimeService& timeService, ObjectPool<Packet>& packetPool);
+	DTLSICETransport(Sender *sender,TimeService& timeService, PacketPool& packetPool);
 	virtual ~DTLSICETransport();
 	
 	void Start();
@@ -109,6 +112,13 @@ public:
 	void SetRemoteOverrideBWE(bool overrideBew);
 	void SetRemoteOverrideBitrate(DWORD bitrate);
 	void DisableREMB(bool disabled);
+	//Number of packets per outgoing group kept serialized for retransmission, applies to groups added afterwards
+	void SetRTXSerializedCacheSize(WORD size);
+	//Pace outgoing rtp packets at a multiple of the bwe target bitrate instead of sending them right away
+	void EnablePacing(bool enabled);
+	//Send media packets from the header of the previous one on each outgoing group when possible instead of serializing them
+	void EnableHeaderTemplates(bool enabled);
+	Pacer::Stats GetPacerStats();
 	
 	ICERemoteCandidate* GetActiveRemoteCandidate() const { return active;	};
 	const char* GetRemoteUsername() const { return iceRemoteUsername.c_str();	};
@@ -121,6 +131,8 @@ public:
 	virtual void onDTLSSetupError() override;
 	virtual void onDTLSShutdown() override;
 	virtual int onData(const ICERemoteCandidate* candidate,const BYTE* data,DWORD size)  override;
+	virtual int onData(const ICERemoteCandidate* candidate,RTPPayload::shared&& payload)  override;
+	virtual int onData(const ICERemoteCandidate* candidate,RTPPayload::shared* payloads,size_t count)  override;
 	
 	DWORD GetRTT() const { return rtt; }
 	
@@ -132,13 +144,18 @@ private:
 	void SetState(DTLSState state);
 	void CheckProbeTimer();
 	void Probe(QWORD now);
+	void Pace(QWORD now);
 	int Send(const RTPPacket::shared& packet);
 	int Send(const RTCPCompoundPacket::shared& rtcp);
+	//Send already serialized rtcp packet
+	int Send(Packet&& buffer, DWORD len);
 	void SetRTT(DWORD rtt,QWORD now);
 	void onRTCP(const RTCPCompoundPacket::shared &rtcp);
+	int onRTP(const ICERemoteCandidate* candidate,RTPPacket::shared& packet,const BYTE* data,DWORD len,DWORD size,QWORD now);
 	void ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq);
+	void ReSendSerializedPacket(RTPOutgoingSourceGroup *group,WORD seq,const RTPOutgoingSourceGroup::SerializedPacket& serialized,QWORD now);
 	DWORD SendProbe(const RTPPacket::shared& packet);
-	DWORD SendProbe(RTPOutgoingSourceGroup *group,BYTE padding);
+	DWORD SendProbe(RTPOutgoingSourceGroup *group,BYTE padding,BYTE count = 1);
 	void SendTransportWideFeedbackMessage(DWORD ssrc);
 	
 	int SetLocalCryptoSDES(const char* suite, const BYTE* key, const DWORD len);
@@ -148,6 +165,7 @@ private:
 	RTPOutgoingSourceGroup* GetOutgoingSourceGroup(DWORD ssrc);
 	RTPIncomingSource*	GetIncomingSource(DWORD ssrc);
 	RTPOutgoingSource*	GetOutgoingSource(DWORD ssrc);
+	RTPIncomingSourceGroup* AssignIncomingSourceGroup(DWORD ssrc,const RTPPacket::shared& packet);
 
 private:
 	struct Maps
@@ -160,7 +178,7 @@ private:
 private:
 	Sender*		sender = nullptr;
 	TimeService&	timeService;
-	ObjectPool<Packet>& packetPool;
+	PacketPool& packetPool;
 	datachannels::impl::Endpoint endpoint;
 	datachannels::Endpoint::Options dcOptions;
 	Listener::shared listener;
@@ -173,13 +191,14 @@ private:
 	SRTPSession	recv;
 	WORD		transportSeqNum			= 0;
 	WORD		feedbackPacketCount		= 0;
-	DWORD		lastFeedbackPacketExtSeqNum	= 0;
 	WORD		feedbackCycles			= 0;
 
 	//TODO: change by shared pointers
-	std::map<DWORD, RTPOutgoingSourceGroup*> outgoing;
-	std::map<DWORD, RTPIncomingSourceGroup*> incoming;
-	std::map<std::string,RTPIncomingSourceGroup*> rids;
+	//SSRC routing tables, looked up on every packet
+	FlatHashMap<DWORD, RTPOutgoingSourceGroup*> outgoing;
+	FlatHashMap<DWORD, RTPIncomingSourceGroup*> incoming;
+	//Only used for resolving the group of unknown ssrcs
+	std::map<std::pair<std::string,std::string>,RTPIncomingSourceGroup*> rids;
 	std::map<std::string,std::set<RTPIncomingSourceGroup*>> mids;
 	CircularQueue<RTPPacket::shared> history;
 	
@@ -195,7 +214,7 @@ private:
 	Acumulator<uint32_t, uint64_t> rtxBitrate;
 	Acumulator<uint32_t, uint64_t> probingBitrate;
 	
-	std::map<DWORD,PacketStats> transportWideReceivedPacketsStats;
+	TransportWideCCReceiveStats transportWideReceiveStats;
 	
 	std::unique_ptr<UDPDumper> dumper;
 	volatile bool dumpInRTP			= false;
@@ -215,8 +234,14 @@ private:
 	std::shared_ptr<SendSideBandwidthEstimation> senderSideBandwidthEstimator;
 	Timer::shared sseTimer;
 
+	Pacer pacer;
+	Timer::shared pacerTimer;
+	bool pacingEnabled = false;
+
 	bool overrideBWE = false;
 	bool disableREMB = false;
+	WORD rtxSerializedCacheSize = 0;
+	bool headerTemplatesEnabled = false;
 	uint32_t remoteOverrideBitrate = 0;
 
 	Timer::shared iceTimeoutTimer;
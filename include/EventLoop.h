@@ -6,26 +6,53 @@
 #include <chrono>
 #include <optional>
 #include <poll.h>
+#include <sys/socket.h>
 #include <cassert>
 #include <optional>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <deque>
+#include <atomic>
 #include "config.h"
 #include "concurrentqueue.h"
 #include "Packet.h"
-#include "ObjectPool.h"
+#include "PacketPool.h"
 #include "TimeService.h"
+#include "TimerWheel.h"
+#include "FlowScheduler.h"
 #include "FileDescriptor.h"
 #include "PacketHeader.h"
+#include "rtp/RTPPayload.h"
 
 using namespace std::chrono_literals;
 
 class EventLoop : public TimeService
 {
 public:
+	//Datagram received on a pooled payload buffer
+	struct Datagram
+	{
+		RTPPayload::shared payload;
+		uint32_t ipAddr	= 0;
+		uint16_t port	= 0;
+	};
 	class Listener
 	{
 	public:
 		virtual ~Listener() = default;
 		virtual void OnRead(const int fd, const uint8_t* data, const size_t size, const uint32_t ipAddr, const uint16_t port) = 0;
+		//Datagram has been received directly on a pooled payload buffer, listener can keep it to avoid copying it again
+		virtual void OnReadPayload(const int fd, RTPPayload::shared&& payload, const uint32_t ipAddr, const uint16_t port)
+		{
+			OnRead(fd, payload->GetMediaData(), payload->GetMediaLength(), ipAddr, port);
+		}
+		//All datagrams read on a single call, listener can move out the payloads it keeps
+		virtual void OnReadPayloads(const int fd, Datagram* datagrams, const size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+				OnReadPayload(fd, std::move(datagrams[i].payload), datagrams[i].ipAddr, datagrams[i].port);
+		}
 	};
 	enum State
 	{
@@ -33,12 +60,63 @@ public:
 		Lagging,
 		Overflown
 	};
+	//Send priority classes, in order: earlier ones are sent first and dropped last on overload
+	enum Priority : uint8_t
+	{
+		Control,
+		Audio,
+		Video,
+		Retransmission,
+		Probing
+	};
+	static constexpr size_t NumPriorities = Priority::Probing + 1;
+	struct SendingStats
+	{
+		State	 state		= State::Normal;
+		size_t	 queued		= 0;
+		size_t	 flows		= 0;
+		uint64_t lagging	= 0;
+		uint64_t overflown	= 0;
+		uint64_t dropped[NumPriorities] = {};
+	};
+	//Readiness notification backend
+	enum Backend
+	{
+		Poll,
+		Epoll
+	};
 	
 	static bool SetAffinity(std::thread::native_handle_type thread, int cpu);
 	static bool SetThreadName(std::thread::native_handle_type thread, const std::string& name);
 private:
+	class Poller
+	{
+	public:
+		enum Event : uint32_t
+		{
+			Readable = 1,
+			Writable = 2,
+			Error    = 4
+		};
+		struct Ready
+		{
+			int fd;
+			uint32_t events;
+		};
+	public:
+		virtual ~Poller() = default;
+		virtual bool Add(int fd) = 0;
+		virtual bool SetWritable(int fd, bool writable) = 0;
+		virtual bool Remove(int fd) = 0;
+		//Wait for events and fill the ready list, returns number of ready fds or -1 on error
+		virtual int  Wait(const std::chrono::microseconds& timeout, std::vector<Ready>& ready) = 0;
+	};
+	class PollPoller;
+	class EpollPoller;
+
 	class TimerImpl : 
 		public Timer, 
+		public TimerWheel::Entry,
 		public std::enable_shared_from_this<TimerImpl>
 	{
 	public:
@@ -59,6 +137,7 @@ private:
 		TimerImpl(const TimerImpl&) = delete;
 		virtual void Cancel() override;
 		virtual void Again(const std::chrono::milliseconds& ms) override;
+		virtual void AgainMicroseconds(const std::chrono::microseconds& us) override;
 		virtual void Repeat(const std::chrono::milliseconds& repeat) override;
 		virtual void Reschedule(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat) override;
 		virtual bool IsScheduled()			const override { return next.count();	}
@@ -69,6 +148,8 @@ private:
 		std::chrono::milliseconds next;
 		std::chrono::milliseconds repeat;
 		std::function<void(std::chrono::milliseconds)> callback;
+		//Keep us alive while scheduled on the wheel
+		shared self;
 	};
 	
 	struct RawTx
@@ -92,42 +173,74 @@ public:
 	bool Start(int fd = FD_INVALID);
 	bool Stop();
 	
+	//Must be called before Start
+	bool SetBackend(Backend backend);
+	Backend GetBackend() const { return backend; }
+	//Must be called before Start, number of datagrams read on each recvmmsg call
+	bool SetReceiveBatchSize(size_t size);
+	size_t GetReceiveBatchSize() const { return receiveBatchSize; }
+	//Must be called before Start, let the kernel coalesce datagrams with UDP_GRO and split them before calling the listener
+	bool SetReceiveOffload(bool enabled);
+	bool IsReceiveOffloadEnabled() const { return gro; }
+	//Must be called before Start, busy wait for tasks, sends and packets up to this time before blocking, 0 to disable
+	bool SetSpin(const std::chrono::microseconds& spin);
+	std::chrono::microseconds GetSpin() const { return spin; }
+	//Must be called before Start, set SO_BUSY_POLL on the sockets so the kernel polls the device queue while reading, 0 to disable
+	bool SetSocketBusyPoll(const std::chrono::microseconds& busyPoll);
+	std::chrono::microseconds GetSocketBusyPoll() const { return socketBusyPoll; }
+	//Register additional sockets to be read on this loop, listener must outlive the registration
+	void AddSocket(int fd, Listener* listener);
+	void RemoveSocket(int fd);
+	
 	virtual const std::chrono::milliseconds GetNow() const override { return now; }
 	virtual Timer::shared CreateTimer(const std::function<void(std::chrono::milliseconds)>& callback) override;
 	virtual Timer::shared CreateTimer(const std::chrono::milliseconds& ms, const std::function<void(std::chrono::milliseconds)>& timeout) override;
 	virtual Timer::shared CreateTimer(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat, const std::function<void(std::chrono::milliseconds)>& timeout) override;
+	using TimeService::Async;
+	virtual void Async(Task&& task) override;
 	virtual void Async(const std::function<void(std::chrono::milliseconds)>& func) override;
 	virtual void Async(const std::function<void(std::chrono::milliseconds)>& func, const std::function<void(std::chrono::milliseconds)>& callback) override;
 	virtual std::future<void> Future(const std::function<void(std::chrono::milliseconds)>& func) override;
 	
-	void Send(const uint32_t ipAddr, const uint16_t port, Packet&& packet, const std::optional<PacketHeader::FlowRoutingInfo>& rawTxData = std::nullopt, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback = std::nullopt);
+	void Send(const uint32_t ipAddr, const uint16_t port, Packet&& packet, const std::optional<PacketHeader::FlowRoutingInfo>& rawTxData = std::nullopt, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback = std::nullopt, Priority priority = Priority::Control);
+	//Thread safe snapshot of the sending queues state
+	SendingStats GetSendingStats() const;
 	void Run(const std::chrono::milliseconds &duration = std::chrono::milliseconds::max());
 	
 	void SetRawTx(const FileDescriptor &fd, const PacketHeader& header, const PacketHeader::FlowRoutingInfo& defaultRoute);
 	void ClearRawTx();
+	//Coalesce consecutive same destination and size packets into a single UDP_SEGMENT send when supported by the socket
+	void SetSegmentationOffload(bool enabled);
+	bool IsSegmentationOffloadSupported() const { return gsoSupported; }
 	bool SetAffinity(int cpu);
 	bool SetThreadName(const std::string& name);
 	bool SetPriority(int priority);
 	bool IsRunning() const { return running; }
 	
 
-	ObjectPool<Packet>& GetPacketPool() { return packetPool; }
+	PacketPool& GetPacketPool() { return packetPool; }
 
 protected:
 	void Signal();
 	void ClearSignal();
+	bool CreatePoller();
+	void EnableReceiveOffload(int fd);
+	void EnableBusyPoll(int fd);
 	inline void AssertThread() const { assert(std::this_thread::get_id()==thread.get_id()); }
+	inline bool IsLoopThread() const { return std::this_thread::get_id()==thread.get_id(); }
+	void ScheduleTimer(const TimerImpl::shared& timer, const std::chrono::microseconds& deadline);
 	void CancelTimer(TimerImpl::shared timer);
 	
 	void ProcessTasks(const std::chrono::milliseconds& now);
 	void ProcessTriggers(const std::chrono::milliseconds& now);
-	int  GetNextTimeout(int defaultTimeout, const std::chrono::milliseconds& until = std::chrono::milliseconds::max()) const;
+	std::chrono::microseconds GetNextTimeout(const std::chrono::microseconds& defaultTimeout, const std::chrono::milliseconds& until = std::chrono::milliseconds::max()) const;
 	const auto GetPipe() const
 	{
 		return pipe;
 	}
 
 	const std::chrono::milliseconds Now();
+	const std::chrono::microseconds GetPreciseNow() const { return preciseNow; }
 private:
 	struct SendBuffer
 	{
@@ -137,9 +250,10 @@ private:
 		{
 		}
 		
-		SendBuffer(uint32_t ipAddr, uint16_t port, const std::optional<PacketHeader::FlowRoutingInfo>& rawTxData, Packet&& packet, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback) :
+		SendBuffer(uint32_t ipAddr, uint16_t port, const std::optional<PacketHeader::FlowRoutingInfo>& rawTxData, Packet&& packet, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback, Priority priority = Priority::Control) :
 			ipAddr(ipAddr),
 			port(port),
+			priority(priority),
 			packet(std::move(packet)),
 			rawTxData(rawTxData),
 			callback(callback)
@@ -148,6 +262,7 @@ private:
 		SendBuffer(SendBuffer&& other) :
 			ipAddr(other.ipAddr),
 			port(other.port),
+			priority(other.priority),
 			packet(std::move(other.packet)),
 			rawTxData(other.rawTxData),
 			callback(other.callback)
@@ -160,35 +275,72 @@ private:
 		
 		uint32_t ipAddr = 0;
 		uint16_t port = 0;
+		Priority priority = Priority::Control;
 		Packet   packet;
 		std::optional<PacketHeader::FlowRoutingInfo> rawTxData;
 		std::optional<std::function<void(std::chrono::milliseconds)>> callback;
 		
 	};
+	//Packets pending to be sent, one queue per destination and priority
+	using SendScheduler = FlowScheduler<SendBuffer,NumPriorities>;
 	static const size_t MaxSendingQueueSize;
+	static const size_t MaxFlowSendingQueueSize;
+	static const size_t SendingQuantum;
 	static const size_t MaxMultipleSendingMessages;
 	static const size_t MaxMultipleReceivingMessages;
 	static const size_t PacketPoolSize;
+	static const size_t MaxSegmentationOffloadSegments;
+	static const size_t MaxSegmentationOffloadSize;
+	static const size_t MaxReceiveBatchSize;
+	static const size_t MaxReceiveOffloadSize;
+	
+	//Control message space for receive offload segment size
+	union ReceiveControl
+	{
+		char buf[CMSG_SPACE(sizeof(int))];
+		cmsghdr align;
+	};
+	struct ReceiveBuffers;
+private:
+	void ProcessIn(int fd, Listener* listener);
+	void ProcessOut(std::vector<SendBuffer>& items);
+	void EnqueueFlow(SendBuffer&& item);
+	void SetSendingState(State state);
+	bool Spin(std::chrono::microseconds& timeout, std::vector<Poller::Ready>& ready);
 private:
 	std::thread	thread;
-	State		state		= State::Normal;
+	std::atomic<State> state	= State::Normal;
 	Listener*	listener	= nullptr;
 	int		fd		= 0;
 	int		pipe[2]		= {FD_INVALID, FD_INVALID};
-	pollfd		ufds[2]		= {};
+#ifdef __linux__
+	Backend		backend		= Backend::Epoll;
+#else
+	Backend		backend		= Backend::Poll;
+#endif
+	std::unique_ptr<Poller> poller;
+	std::unordered_map<int,Listener*> sockets;
 	std::atomic_flag signaled	= ATOMIC_FLAG_INIT;
 	volatile bool	running		= false;
 	std::chrono::milliseconds now	= 0ms;
+	std::chrono::microseconds preciseNow = 0us;
 	moodycamel::ConcurrentQueue<SendBuffer>	sending;
-	moodycamel::ConcurrentQueue<
-		std::pair<
-			std::function<void(std::chrono::milliseconds)>,
-			std::optional<std::function<void(std::chrono::milliseconds)>>
-		>
-	>  tasks;
-	std::multimap<std::chrono::milliseconds,TimerImpl::shared> timers;
-	ObjectPool<Packet> packetPool;
+	SendScheduler	scheduler	{MaxSendingQueueSize, MaxFlowSendingQueueSize, SendingQuantum};
+	std::atomic<uint64_t> laggingCount	= 0;
+	std::atomic<uint64_t> overflownCount	= 0;
+	std::atomic<uint64_t> dropped[NumPriorities] = {};
+	moodycamel::ConcurrentQueue<Task> tasks;
+	TimerWheel timers;
+	std::vector<TimerWheel::Entry*> expired;
+	PacketPool packetPool;
 	std::optional<RawTx> rawTx;
+	bool		gso		= true;
+	bool		gsoSupported	= false;
+	bool		gro		= false;
+	size_t		receiveBatchSize = MaxMultipleReceivingMessages;
+	std::chrono::microseconds spin	= 0us;
+	std::chrono::microseconds socketBusyPoll = 0us;
+	std::unique_ptr<ReceiveBuffers> receiveBuffers;
 
 };
 
@@ -0,0 +1,198 @@
+#ifndef FLATHASHMAP_H
+#define FLATHASHMAP_H
+
+#include <stdint.h>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Open addressing hash map for integer keys
+ *
+ * Entries are stored in a single power of two sized array with linear
+ * probing, so a lookup is a multiplication and usually a single cache miss.
+ * Removal shifts back the following entries instead of leaving tombstones.
+ * Values must be default constructible and are moved when the table grows,
+ * store pointers if their address must be stable.
+ */
+template<typename Key, typename Value>
+class FlatHashMap
+{
+	static_assert(std::is_integral_v<Key>, "FlatHashMap keys must be integers");
+	struct Slot;
+public:
+	using value_type = std::pair<Key, Value>;
+
+	template<typename SlotType, typename EntryType>
+	class Iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type	= FlatHashMap::value_type;
+		using difference_type	= std::ptrdiff_t;
+		using pointer		= EntryType*;
+		using reference		= EntryType&;
+
+		Iterator(SlotType* slot, SlotType* end) : slot(slot), end(end)	{ Skip();				}
+		reference operator*()		const			{ return slot->entry;			}
+		pointer	  operator->()		const			{ return &slot->entry;			}
+		Iterator& operator++()					{ ++slot; Skip(); return *this;		}
+		bool operator==(const Iterator& other)	const		{ return slot==other.slot;		}
+		bool operator!=(const Iterator& other)	const		{ return slot!=other.slot;		}
+	private:
+		void Skip()	{ while (slot!=end && !slot->used) ++slot;	}
+	private:
+		SlotType* slot;
+		SlotType* end;
+	};
+	using iterator		= Iterator<Slot, value_type>;
+	using const_iterator	= Iterator<const Slot, const value_type>;
+public:
+	FlatHashMap(size_t capacity = 16)
+	{
+		//Get power of two big enough for the initial capacity
+		size_t size = 16;
+		while (size * MaxLoad < capacity * MaxLoadDivisor)
+			size <<= 1;
+		Resize(size);
+	}
+
+	size_t size()	const { return count;		}
+	bool   empty()	const { return !count;		}
+
+	iterator	begin()		{ return {slots.data(), slots.data() + slots.size()};				}
+	iterator	end()		{ return {slots.data() + slots.size(), slots.data() + slots.size()};		}
+	const_iterator	begin()	const	{ return {slots.data(), slots.data() + slots.size()};				}
+	const_iterator	end()	const	{ return {slots.data() + slots.size(), slots.data() + slots.size()};		}
+
+	//Get pointer to the value or null if not found
+	Value* find(Key key)
+	{
+		for (size_t pos = Position(key); slots[pos].used; pos = (pos + 1) & mask)
+			if (slots[pos].entry.first==key)
+				return &slots[pos].entry.second;
+		return nullptr;
+	}
+
+	const Value* find(Key key) const
+	{
+		return const_cast<FlatHashMap*>(this)->find(key);
+	}
+
+	//Get existing value or create a new one, returns if it was inserted
+	template<typename... Args>
+	std::pair<Value*,bool> try_emplace(Key key, Args&&... args)
+	{
+		//Check if already present
+		if (Value* value = find(key))
+			return {value, false};
+
+		//Grow if needed
+		if ((count + 1) * MaxLoadDivisor > slots.size() * MaxLoad)
+			Resize(slots.size() << 1);
+
+		//Get first free slot
+		size_t pos = Position(key);
+		while (slots[pos].used)
+			pos = (pos + 1) & mask;
+
+		//Store it
+		slots[pos].entry.first = key;
+		slots[pos].entry.second = Value(std::forward<Args>(args)...);
+		slots[pos].used = true;
+		count++;
+
+		return {&slots[pos].entry.second, true};
+	}
+
+	Value& operator[](Key key)
+	{
+		return *try_emplace(key).first;
+	}
+
+	bool erase(Key key)
+	{
+		//Find it
+		size_t pos = Position(key);
+		while (slots[pos].used && slots[pos].entry.first!=key)
+			pos = (pos + 1) & mask;
+
+		//If not found
+		if (!slots[pos].used)
+			return false;
+
+		//Shift back following entries of the probe sequence into the hole
+		for (size_t next = (pos + 1) & mask; slots[next].used; next = (next + 1) & mask)
+		{
+			//Only if the hole is between its ideal position and its current one
+			size_t ideal = Position(slots[next].entry.first);
+			if (((next - ideal) & mask) < ((next - pos) & mask))
+				continue;
+			slots[pos].entry = std::move(slots[next].entry);
+			pos = next;
+		}
+
+		//Free last one
+		slots[pos].Reset();
+		count--;
+
+		return true;
+	}
+
+	void clear()
+	{
+		for (auto& slot : slots)
+			slot.Reset();
+		count = 0;
+	}
+private:
+	static constexpr size_t MaxLoad = 3;
+	static constexpr size_t MaxLoadDivisor = 4;
+
+	struct Slot
+	{
+		void Reset()
+		{
+			entry = {};
+			used = false;
+		}
+		value_type entry = {};
+		bool used = false;
+	};
+
+	size_t Position(Key key) const
+	{
+		//Fibonacci hashing, takes the high bits so packed keys are spread
+		return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> shift);
+	}
+
+	void Resize(size_t size)
+	{
+		std::vector<Slot> old(size);
+		std::swap(slots, old);
+		mask = size - 1;
+		shift = 64 - __builtin_ctzll(size);
+		count = 0;
+
+		//Reinsert
+		for (auto& slot : old)
+		{
+			if (!slot.used)
+				continue;
+			size_t pos = Position(slot.entry.first);
+			while (slots[pos].used)
+				pos = (pos + 1) & mask;
+			slots[pos].entry = std::move(slot.entry);
+			slots[pos].used = true;
+			count++;
+		}
+	}
+private:
+	std::vector<Slot> slots;
+	size_t mask	= 0;
+	size_t shift	= 0;
+	size_t count	= 0;
+};
+
+#endif /* FLATHASHMAP_H */
@@ -0,0 +1,206 @@
+#ifndef FLOWSCHEDULER_H
+#define FLOWSCHEDULER_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Deficit round robin scheduler of items queued per destination flow.
+ *
+ * Each flow has one queue per priority, lower values are sent first within
+ * the flow. Active flows take turns sending up to a quantum of bytes, and the
+ * unused deficit is carried over to the next turn while the flow has items
+ * queued. Flows are removed as soon as they are idle, so they don't keep any
+ * deficit. When a flow or the whole scheduler is full, the oldest item of a
+ * lower priority is dropped to make room for the new one.
+ *
+ * Not thread safe, only the total queued count can be read from other threads.
+ */
+template <typename Item, size_t Priorities>
+class FlowScheduler
+{
+public:
+	enum Result
+	{
+		Queued,
+		FlowFull,
+		Overflown
+	};
+public:
+	FlowScheduler(size_t maxQueued, size_t maxFlowQueued, size_t quantum) :
+		maxQueued(maxQueued),
+		maxFlowQueued(maxFlowQueued),
+		quantum(quantum)
+	{
+	}
+
+	//Queue an item, the lower priority items dropped to make room are passed to onDrop(Item&&, priority). If not queued the item is not moved and must be released by the caller
+	template <typename OnDrop>
+	Result Enqueue(uint64_t key, uint8_t priority, Item&& item, OnDrop&& onDrop)
+	{
+		//Get flow, create it if needed
+		auto [it, inserted] = flows.try_emplace(key);
+		auto& flow = it->second;
+
+		//If destination queue is full
+		if (flow.size>=maxFlowQueued && !DropLowerPriority(flow, priority, onDrop))
+		{
+			//Remove it if it was just created
+			if (inserted)
+				flows.erase(it);
+			return FlowFull;
+		}
+
+		//If all queues are full
+		if (queued>=maxQueued)
+		{
+			bool done = DropLowerPriority(flow, priority, onDrop);
+			//Look for lower priority items on other destinations
+			for (auto active = activeFlows.begin(); !done && active!=activeFlows.end(); ++active)
+				done = DropLowerPriority(flows[*active], priority, onDrop);
+			//If there were none
+			if (!done)
+			{
+				//Remove it if it was just created
+				if (inserted)
+					flows.erase(it);
+				return Overflown;
+			}
+		}
+
+		//If it was idle
+		if (!flow.active)
+		{
+			//Add it to round robin
+			activeFlows.push_back(key);
+			flow.active = true;
+		}
+
+		//Update counters
+		flow.size++;
+		queued++;
+		queuedPriorities[priority]++;
+
+		//Enqueue
+		flow.queues[priority].emplace_back(std::move(item));
+
+		return Queued;
+	}
+
+	//Move items to send in round robin until there are max items or there is nothing else queued. getSize(const Item&) returns the size in bytes of an item
+	template <typename GetSize>
+	void Dequeue(std::vector<Item>& items, size_t max, GetSize&& getSize)
+	{
+		while (items.size()<max && !activeFlows.empty())
+		{
+			//Get flow on turn
+			uint64_t key = activeFlows.front();
+			auto& flow = flows[key];
+
+			//If starting its turn
+			if (!flow.turn)
+			{
+				//Add quantum
+				flow.deficit += quantum;
+				flow.turn = true;
+			}
+
+			//Send while it has enough deficit
+			while (items.size()<max && flow.size)
+			{
+				//Get highest priority queue with items
+				auto queue = std::find_if(std::begin(flow.queues), std::end(flow.queues), [](const auto& queue) { return !queue.empty(); });
+				//Get item size
+				size_t size = getSize(queue->front());
+				//Check if it can be sent on this turn
+				if (size>flow.deficit)
+					break;
+				//Update counters
+				flow.deficit -= size;
+				flow.size--;
+				queued--;
+				queuedPriorities[queue - std::begin(flow.queues)]--;
+				//Move to items to send
+				items.emplace_back(std::move(queue->front()));
+				queue->pop_front();
+			}
+
+			//If batch is full and it could still send more, keep the turn for next time
+			if (items.size()==max && flow.size)
+				break;
+
+			//Turn done
+			flow.turn = false;
+			activeFlows.pop_front();
+
+			//If it has still items
+			if (flow.size)
+				//Wait for next turn
+				activeFlows.push_back(key);
+			else
+				//Remove it, deficit is not kept for idle flows
+				flows.erase(key);
+		}
+	}
+
+	size_t GetQueued() const			{ return queued;			}
+	size_t GetQueued(uint8_t priority) const	{ return queuedPriorities[priority];	}
+	size_t GetFlows() const				{ return flows.size();			}
+	bool   HasFlow(uint64_t key) const		{ return flows.count(key);		}
+	size_t GetDeficit(uint64_t key) const
+	{
+		auto it = flows.find(key);
+		return it!=flows.end() ? it->second.deficit : 0;
+	}
+private:
+	struct Flow
+	{
+		std::deque<Item> queues[Priorities];
+		size_t	size	= 0;
+		size_t	deficit	= 0;
+		bool	active	= false;
+		bool	turn	= false;
+	};
+
+	template <typename OnDrop>
+	bool DropLowerPriority(Flow& flow, uint8_t priority, OnDrop& onDrop)
+	{
+		//From lowest priority
+		for (size_t i = Priorities-1; i>priority; --i)
+		{
+			//Get queue
+			auto& queue = flow.queues[i];
+			//If empty
+			if (queue.empty())
+				//Next
+				continue;
+			//Drop oldest one, it is the less useful
+			Item item = std::move(queue.front());
+			queue.pop_front();
+			//Update counters
+			flow.size--;
+			queued--;
+			queuedPriorities[i]--;
+			//Release it
+			onDrop(std::move(item), (uint8_t)i);
+			//Done
+			return true;
+		}
+		//Nothing to drop
+		return false;
+	}
+private:
+	size_t maxQueued;
+	size_t maxFlowQueued;
+	size_t quantum;
+	std::unordered_map<uint64_t,Flow> flows;
+	std::deque<uint64_t> activeFlows;
+	std::atomic<size_t> queued = 0;
+	size_t queuedPriorities[Priorities] = {};
+};
+
+#endif /* FLOWSCHEDULER_H */
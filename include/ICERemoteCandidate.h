@@ -24,6 +24,7 @@
 #include "config.h"
 #include <optional>
 #include "PacketHeader.h"
+#include "rtp/RTPPayload.h"
 
 
 class ICERemoteCandidate
@@ -40,6 +41,19 @@ public:
 	{
 	public:
 		virtual int onData(const ICERemoteCandidate* candidate,const BYTE* data,DWORD size) = 0;
+		//Data received on a pooled payload that can be kept by the listener
+		virtual int onData(const ICERemoteCandidate* candidate,RTPPayload::shared&& payload)
+		{
+			return onData(candidate,payload->GetMediaData(),payload->GetMediaLength());
+		}
+		//Several payloads received back to back from the same candidate
+		virtual int onData(const ICERemoteCandidate* candidate,RTPPayload::shared* payloads,size_t count)
+		{
+			int ret = 0;
+			for (size_t i = 0; i < count; ++i)
+				ret += onData(candidate,std::move(payloads[i]));
+			return ret;
+		}
 	};
 public:
 	
@@ -74,6 +88,14 @@ public:
 	{
 		return listener->onData(this,data,size);
 	}
+	int onData(RTPPayload::shared&& payload)
+	{
+		return listener->onData(this,std::move(payload));
+	}
+	int onData(RTPPayload::shared* payloads, size_t count)
+	{
+		return listener->onData(this,payloads,count);
+	}
 	void SetState(State state) 
 	{
 		this->state = state;
@@ -89,9 +111,15 @@ public:
 	      DWORD     GetIPAddress()		const { return ntohl(addr.sin_addr.s_addr);	}
 	      WORD	GetPort()		const {	return ntohs(addr.sin_port);		}
 	std::string	GetRemoteAddress()	const { return std::string(GetIP()) + ":" + std::to_string(GetPort()); }
+	uint64_t	GetRemoteKey()		const { return GetRemoteKey(GetIPAddress(),GetPort());	}
 	State		GetState()		const { return state;				}
 	const std::optional<PacketHeader::FlowRoutingInfo>&	GetRawTxData()	const { return rawTxData;		}
 public:
+	//Packed ip:port, used for indexing candidates without formatting the address
+	static uint64_t GetRemoteKey(DWORD address,WORD port)
+	{
+		return (uint64_t)address<<16 | port;
+	}
 	static std::string GetRemoteAddress(DWORD address,WORD port)
 	{
 		const uint8_t* host = (const uint8_t*)&address;
@@ -0,0 +1,136 @@
+#ifndef INLINEFUNCTION_H
+#define INLINEFUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Move only type erased callable with inline storage
+ *
+ * Callables up to Capacity bytes are stored inside the object, so creating
+ * and moving it never allocates. Bigger ones are boxed on the heap so any
+ * callable can still be used.
+ */
+template<typename Signature, size_t Capacity = 64>
+class InlineFunction;
+
+template<typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity>
+{
+public:
+	template<typename Func>
+	static constexpr bool IsInline = sizeof(Func)<=Capacity
+		&& alignof(Func)<=alignof(std::max_align_t)
+		&& std::is_nothrow_move_constructible_v<Func>;
+public:
+	InlineFunction() = default;
+	InlineFunction(std::nullptr_t) {}
+
+	template<typename Func, typename = std::enable_if_t<
+		!std::is_same_v<std::decay_t<Func>, InlineFunction> &&
+		std::is_invocable_r_v<R, std::decay_t<Func>&, Args...>
+	>>
+	InlineFunction(Func&& func)
+	{
+		using Callable = std::decay_t<Func>;
+
+		if constexpr (IsInline<Callable>)
+		{
+			//Store it in place
+			new (storage) Callable(std::forward<Func>(func));
+			ops = &InlineOperations<Callable>;
+		} else {
+			//Box it
+			new (storage) Callable*(new Callable(std::forward<Func>(func)));
+			ops = &HeapOperations<Callable>;
+		}
+	}
+
+	InlineFunction(InlineFunction&& other) noexcept
+	{
+		Take(other);
+	}
+
+	InlineFunction& operator=(InlineFunction&& other) noexcept
+	{
+		if (this!=&other)
+		{
+			Reset();
+			Take(other);
+		}
+		return *this;
+	}
+
+	InlineFunction(const InlineFunction&) = delete;
+	InlineFunction& operator=(const InlineFunction&) = delete;
+
+	~InlineFunction()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		if (ops)
+			ops->destroy(storage);
+		ops = nullptr;
+	}
+
+	explicit operator bool() const { return ops; }
+
+	R operator()(Args... args)
+	{
+		return ops->invoke(storage, std::forward<Args>(args)...);
+	}
+private:
+	struct Operations
+	{
+		R    (*invoke)(void* storage, Args&&... args);
+		void (*move)(void* to, void* from);
+		void (*destroy)(void* storage);
+	};
+
+	template<typename Callable>
+	static inline const Operations InlineOperations = {
+		[](void* storage, Args&&... args) -> R {
+			return (*static_cast<Callable*>(storage))(std::forward<Args>(args)...);
+		},
+		[](void* to, void* from) {
+			new (to) Callable(std::move(*static_cast<Callable*>(from)));
+			static_cast<Callable*>(from)->~Callable();
+		},
+		[](void* storage) {
+			static_cast<Callable*>(storage)->~Callable();
+		}
+	};
+
+	template<typename Callable>
+	static inline const Operations HeapOperations = {
+		[](void* storage, Args&&... args) -> R {
+			return (**static_cast<Callable**>(storage))(std::forward<Args>(args)...);
+		},
+		[](void* to, void* from) {
+			*static_cast<Callable**>(to) = *static_cast<Callable**>(from);
+		},
+		[](void* storage) {
+			delete *static_cast<Callable**>(storage);
+		}
+	};
+
+	void Take(InlineFunction& other) noexcept
+	{
+		if (!other.ops)
+			return;
+		//Move callable and leave other empty
+		other.ops->move(storage, other.storage);
+		ops = other.ops;
+		other.ops = nullptr;
+	}
+private:
+	alignas(std::max_align_t) unsigned char storage[Capacity];
+	const Operations* ops = nullptr;
+};
+
+#endif /* INLINEFUNCTION_H */
@@ -0,0 +1,85 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <deque>
+#include <map>
+#include "config.h"
+#include "acumulator.h"
+#include "rtp/RTPPacket.h"
+
+/*
+ * Token bucket pacer for outgoing rtp packets
+ *
+ * Packets are queued per outgoing group and released at a multiple of the
+ * target bitrate, audio groups are always served first and video groups are
+ * served round robin. The bucket may go into debt by one packet, so a packet
+ * is never held back only because it is bigger than the available budget.
+ * All times are in microseconds, the pacer does not own any timer, the caller
+ * must dequeue packets and wake up again at GetNextSendTime().
+ */
+class Pacer
+{
+public:
+	struct Stats
+	{
+		DWORD	queuedPackets	= 0;
+		DWORD	queuedBytes	= 0;
+		QWORD	queueDelay	= 0;	//Delay of the oldest queued packet
+		QWORD	avgQueueDelay	= 0;	//Average delay of the packets released in the last second
+		QWORD	maxQueueDelay	= 0;	//Max delay of the packets released in the last second
+		DWORD	pacingBitrate	= 0;
+	};
+public:
+	Pacer();
+
+	//Pacing is at pacingFactor times the target bitrate, zero disables pacing
+	void SetTargetBitrate(DWORD bitrate);
+	void SetPacingFactor(float factor)		{ pacingFactor = factor;	}
+	//Packets waiting longer than this are released regardless of the budget
+	void SetMaxQueueDelay(QWORD us)			{ maxQueueDelay = us;		}
+
+	void Enqueue(DWORD ssrc, const RTPPacket::shared& packet, QWORD now);
+	RTPPacket::shared Dequeue(QWORD now);
+	//Drop all packets queued for a group
+	void Remove(DWORD ssrc);
+	void Clear();
+
+	//Time at which the next packet could be released, only meaningful if not empty
+	QWORD GetNextSendTime(QWORD now) const;
+	bool IsEmpty() const				{ return !queuedPackets;	}
+	Stats GetStats(QWORD now);
+
+	static DWORD GetPacketSize(const RTPPacket::shared& packet);
+private:
+	struct Entry
+	{
+		RTPPacket::shared packet;
+		QWORD enqueued;
+	};
+	struct Queue
+	{
+		bool audio = false;
+		std::deque<Entry> packets;
+	};
+	static constexpr QWORD MaxBurst = 5000;	//Max budget accumulated while idle, in us at pacing rate
+
+	void Refill(QWORD now);
+	std::map<DWORD,Queue>::iterator Next();
+	QWORD GetOldestEnqueued() const;
+private:
+	std::map<DWORD,Queue> queues;
+	DWORD lastServed	= 0;
+	DWORD queuedPackets	= 0;
+	DWORD queuedBytes	= 0;
+	DWORD queuedAudio	= 0;
+
+	float pacingFactor	= 2.5f;
+	QWORD maxQueueDelay	= 2000000;
+	DWORD pacingBitrate	= 0;
+	int64_t budget		= 0;	//In bits
+	QWORD last		= 0;
+
+	MaxAcumulator<QWORD,QWORD> delays;
+};
+
+#endif /* PACER_H */
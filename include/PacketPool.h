@@ -0,0 +1,269 @@
+#ifndef PACKETPOOL_H_
+#define PACKETPOOL_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "concurrentqueue.h"
+#include "Packet.h"
+
+/*
+ * Thread safe packet buffer pool
+ *
+ * Each thread keeps a small cache of packets in two magazines, so picking
+ * and releasing is lock free and touches no shared memory in the common
+ * case. Full and empty magazines are exchanged with a global depot, so
+ * buffers picked on one thread and released on another one are recycled
+ * instead of allocated again.
+ */
+class PacketPool
+{
+public:
+	static constexpr size_t MagazineSize = 32;
+
+	struct Stats
+	{
+		uint64_t hits		= 0;
+		uint64_t misses		= 0;
+		uint64_t dropped	= 0;
+		size_t	 available	= 0;
+	};
+public:
+	PacketPool(std::size_t size) :
+		depot(std::make_shared<Depot>(size))
+	{
+		//Preallocate buffers in full magazines
+		for (size_t i = 0; i < depot->capacity; ++i)
+		{
+			Magazine magazine;
+			magazine.reserve(MagazineSize);
+			for (size_t j = 0; j < MagazineSize; ++j)
+				magazine.emplace_back();
+			depot->full.enqueue(std::move(magazine));
+		}
+	}
+
+	PacketPool(const PacketPool&) = delete;
+	PacketPool& operator=(const PacketPool&) = delete;
+
+	~PacketPool()
+	{
+		//Return cached packets of current thread, other threads keep the depot alive until they exit
+		Caches::Get().Flush(depot.get());
+	}
+
+	Packet pick()
+	{
+		auto& cache = Caches::Get().Find(depot);
+
+		//If current magazine is empty
+		if (cache.loaded.empty())
+		{
+			//If previous one has packets
+			if (!cache.previous.empty())
+			{
+				//Use it
+				std::swap(cache.loaded, cache.previous);
+			} else {
+				Magazine magazine;
+				//Try to get a full one from the depot
+				if (!depot->full.try_dequeue(magazine))
+				{
+					//Allocate new one
+					cache.misses++;
+					return Packet();
+				}
+				//Return empty one to depot
+				if (cache.previous.capacity())
+					depot->empty.enqueue(std::move(cache.previous));
+				//Rotate
+				cache.previous = std::move(cache.loaded);
+				cache.loaded = std::move(magazine);
+				//Update stats
+				cache.Sync(*depot);
+			}
+		}
+
+		//Got it from cache
+		cache.hits++;
+
+		//Get last one
+		Packet packet = std::move(cache.loaded.back());
+		cache.loaded.pop_back();
+
+		return packet;
+	}
+
+	void release(Packet&& packet)
+	{
+		//Reset object
+		packet.Reset();
+
+		//Do not store moved out packets
+		if (!packet.GetCapacity())
+			return;
+
+		auto& cache = Caches::Get().Find(depot);
+
+		//If current magazine is full
+		if (cache.loaded.size()>=MagazineSize)
+		{
+			//If previous one has room
+			if (cache.previous.size()<MagazineSize)
+			{
+				//Use it
+				std::swap(cache.loaded, cache.previous);
+			} else {
+				//If the depot has room for it
+				if (depot->full.size_approx()<depot->capacity)
+				{
+					//Give full one to the depot
+					depot->full.enqueue(std::move(cache.previous));
+				} else {
+					//Free them
+					cache.dropped += cache.previous.size();
+					cache.previous.clear();
+				}
+				//Rotate
+				cache.previous = std::move(cache.loaded);
+				//Get an empty one from the depot, or allocate it
+				depot->empty.try_dequeue(cache.loaded);
+				cache.loaded.reserve(MagazineSize);
+				//Update stats
+				cache.Sync(*depot);
+			}
+		}
+
+		//Store it
+		cache.loaded.emplace_back(std::move(packet));
+	}
+
+	size_t size() const
+	{
+		return depot->capacity * MagazineSize;
+	}
+
+	//Counters are updated by each thread every time it exchanges a magazine with the depot
+	Stats GetStats() const
+	{
+		Stats stats;
+		stats.hits	= depot->hits;
+		stats.misses	= depot->misses;
+		stats.dropped	= depot->dropped;
+		stats.available	= depot->full.size_approx() * MagazineSize;
+		return stats;
+	}
+
+	//Return packets cached by current thread to the depot and update stats
+	void Flush()
+	{
+		Caches::Get().Flush(depot.get());
+	}
+private:
+	using Magazine = std::vector<Packet>;
+
+	struct Depot
+	{
+		Depot(size_t size) :
+			capacity((size + MagazineSize - 1) / MagazineSize)
+		{
+		}
+		const size_t capacity;
+		moodycamel::ConcurrentQueue<Magazine> full;
+		moodycamel::ConcurrentQueue<Magazine> empty;
+		std::atomic<uint64_t> hits	= 0;
+		std::atomic<uint64_t> misses	= 0;
+		std::atomic<uint64_t> dropped	= 0;
+	};
+
+	struct Cache
+	{
+		void Sync(Depot& depot)
+		{
+			depot.hits	+= hits;
+			depot.misses	+= misses;
+			depot.dropped	+= dropped;
+			hits = misses = dropped = 0;
+		}
+
+		void Flush()
+		{
+			//Return magazines with packets
+			for (auto magazine : {&loaded, &previous})
+			{
+				if (magazine->empty())
+					continue;
+				if (depot->full.size_approx()<depot->capacity)
+					depot->full.enqueue(std::move(*magazine));
+				else
+					dropped += magazine->size();
+				magazine->clear();
+			}
+			Sync(*depot);
+			depot.reset();
+		}
+
+		std::shared_ptr<Depot> depot;
+		Magazine loaded;
+		Magazine previous;
+		uint64_t hits		= 0;
+		uint64_t misses		= 0;
+		uint64_t dropped	= 0;
+	};
+
+	//Per thread caches, one for each of the last pools used
+	struct Caches
+	{
+		static constexpr size_t Size = 8;
+
+		static Caches& Get()
+		{
+			static thread_local Caches caches;
+			return caches;
+		}
+
+		~Caches()
+		{
+			for (auto& cache : caches)
+				if (cache.depot)
+					cache.Flush();
+		}
+
+		Cache& Find(const std::shared_ptr<Depot>& depot)
+		{
+			//Most recently used first
+			for (size_t i = 0; i < Size; ++i)
+			{
+				if (caches[i].depot!=depot)
+					continue;
+				//Move it to front
+				if (i)
+					std::rotate(caches.begin(), caches.begin() + i, caches.begin() + i + 1);
+				return caches[0];
+			}
+			//Evict least recently used one
+			auto& last = caches[Size - 1];
+			if (last.depot)
+				last.Flush();
+			std::rotate(caches.begin(), caches.begin() + Size - 1, caches.end());
+			//Attach
+			caches[0].depot = depot;
+			return caches[0];
+		}
+
+		void Flush(Depot* depot)
+		{
+			for (auto& cache : caches)
+				if (cache.depot.get()==depot)
+					cache.Flush();
+		}
+
+		std::array<Cache, Size> caches;
+	};
+private:
+	std::shared_ptr<Depot> depot;
+};
+
+#endif //PACKETPOOL_H_
@@ -5,8 +5,10 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <array>
 #include <map>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <poll.h>
 #include <srtp2/srtp.h>
@@ -14,6 +16,8 @@
 #include "DTLSICETransport.h"
 #include "EventLoop.h"
 #include "PacketHeader.h"
+#include "FlatHashMap.h"
+#include "stunmessage.h"
 
 class RTPBundleTransport :
 	public DTLSICETransport::Sender,
@@ -41,7 +45,22 @@ public:
 		size_t iceResponsesReceived	= 0;
 		uint64_t lastKeepAliveRequestSent	= 0;
 		uint64_t lastKeepAliveRequestReceived	= 0;
-		
+		//Cached message integrity keys for the local and remote ICE passwords
+		STUNMessage::HMACKey localKey;
+		STUNMessage::HMACKey remoteKey;
+		//Each connection has its own keepalive deadline on the loop timer wheel
+		Timer::shared keepAliveTimer;
+	};
+	
+	class Router
+	{
+	public:
+		virtual ~Router() = default;
+		//Called on the transport loop for packets not belonging to any local connection, returns the transport owning them if any
+		virtual RTPBundleTransport* OnUnknown(RTPBundleTransport* transport, std::string_view username, const uint32_t ip, const uint16_t port) = 0;
+		//Called on the transport loop when remote candidates are added or removed
+		virtual void OnCandidateAdded(RTPBundleTransport* transport, const uint32_t ip, const uint16_t port) = 0;
+		virtual void OnCandidateRemoved(RTPBundleTransport* transport, const uint32_t ip, const uint16_t port) = 0;
 	};
 public:
 	RTPBundleTransport(uint32_t packetPoolSize = 0);
@@ -55,11 +74,20 @@ public:
 	int End();
 	
 	int GetLocalPort() const { return port; }
+	int GetSocket() const { return socket; }
+	
+	//Must be called before Init
+	void SetReusePort(bool reusePort)	{ this->reusePort = reusePort;				}
+	void SetRouter(Router* router)		{ this->router = router;				}
+	//Handle a packet received by another transport on the same port
+	void Deliver(RTPPayload::shared&& payload, const uint32_t ip, const uint16_t port);
 	int AddRemoteCandidate(const std::string& username,const char* ip, WORD port);
 	void SetCandidateRawTxData(const std::string& ip, uint16_t port, uint32_t selfAddr, const std::string& dstLladdr);
-	virtual int Send(const ICERemoteCandidate* candidate,Packet&& buffer, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback = std::nullopt) override;
+	virtual int Send(const ICERemoteCandidate* candidate,Packet&& buffer, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback = std::nullopt, EventLoop::Priority priority = EventLoop::Priority::Control) override;
 	
 	virtual void OnRead(const int fd, const uint8_t* data, const size_t size, const uint32_t ip, const uint16_t port) override;
+	virtual void OnReadPayload(const int fd, RTPPayload::shared&& payload, const uint32_t ip, const uint16_t port) override;
+	virtual void OnReadPayloads(const int fd, EventLoop::Datagram* datagrams, const size_t count) override;
 	
 	void SetRawTx(int32_t ifindex, unsigned int sndbuf, bool skipQdisc, const std::string& selfLladdr, uint32_t fallbackSelfAddr, const std::string& fallbackDstLladdr, uint16_t port);
 	void ClearRawTx();
@@ -71,20 +99,28 @@ public:
 	TimeService& GetTimeService()		{ return loop;						}
 private:
 	void onTimer(std::chrono::milliseconds now);
+	void onKeepAlive(const Connection::shared& connection);
+	void ScheduleKeepAlive(const Connection::shared& connection);
 	void SendBindingRequest(Connection::shared connection,ICERemoteCandidate* candidate);
+	bool Route(std::string_view username, const uint8_t* data, const size_t size, const uint32_t ip, const uint16_t port);
 private:
 	//Sockets
 	int 	socket;
 	int 	port;
+	bool	reusePort = false;
+	Router*	router = nullptr;
 	
 	EventLoop loop;
 	Timer::shared iceTimer;
 	std::chrono::milliseconds iceTimeout = 10000ms;
 
-	std::map<std::string, Connection::shared>	connections;
-	std::map<std::string, ICERemoteCandidate>	candidates;
-	std::map<std::pair<uint64_t,uint32_t>, std::pair<std::string,std::string>> transactions;
+	std::map<std::string, Connection::shared, std::less<>>	connections;
+	//Indexed by packed ip:port, candidates are boxed as transports keep pointers to them
+	FlatHashMap<uint64_t, std::unique_ptr<ICERemoteCandidate>> candidates;
+	std::map<std::pair<uint64_t,uint32_t>, std::pair<std::string,uint64_t>> transactions;
 	uint32_t maxTransId = 0;
+	//Consecutive payloads from same candidate handed over together
+	std::array<RTPPayload::shared, 32> batch;
 	Use	use;
 };
 
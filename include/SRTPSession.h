@@ -34,6 +34,12 @@ public:
 		SemaphoreErr	= srtp_err_status_semaphore_err,/**< error while using semaphores            */
 		PFKeyErr	= srtp_err_status_pfkey_err     /**< error while using pfkey                 */
       };
+	//Packet buffer processed in a batch, size is updated in place and set to 0 on error
+	struct Span
+	{
+		uint8_t* data = nullptr;
+		size_t   size = 0;
+	};
 public:
 	SRTPSession() = default;
 	~SRTPSession();
@@ -49,6 +55,10 @@ public:
 	size_t UnprotectRTP(uint8_t* data, size_t size);
 	size_t UnprotectRTCP(uint8_t* data, size_t size);
 	
+	//Process several packets back to back, returns the number of packets processed successfully
+	size_t ProtectRTP(Span* packets, size_t count);
+	size_t UnprotectRTP(Span* packets, size_t count);
+	
 	bool IsSetup() const { return srtp; }
 	const char* GetLastError() const
 	{
@@ -1,6 +1,7 @@
 #ifndef SEND_SIDE_BANDWIDTH_ESTIMATION_H_
 #define SEND_SIDE_BANDWIDTH_ESTIMATION_H_
 
+#include <array>
 #include <deque>
 #include <utility>
 #include <vector>
@@ -9,7 +10,6 @@
 #include "MovingCounter.h"
 #include "rtp/PacketStats.h"
 #include "remoterateestimator.h"
-#include "CircularBuffer.h"
 #include "WrapExtender.h"
 
 class SendSideBandwidthEstimation
@@ -25,11 +25,15 @@ public:
 		Loosy
 	}
 ;
+	//Pair<transport seqnum,us> -> us = 0, not received
+	using ReceivedPacket = std::pair<uint32_t,uint64_t>;
 public:
 	SendSideBandwidthEstimation();
         ~SendSideBandwidthEstimation();
 	void SentPacket(const PacketStats& packet);
-	void ReceivedFeedback(uint8_t feedbackNum, const std::map<uint32_t,uint64_t>& packets, uint64_t when = 0);
+	//Packets must be in transport seqnum order
+	void ReceivedFeedback(uint8_t feedbackNum, const ReceivedPacket* packets, size_t count, uint64_t when = 0);
+	void ReceivedFeedback(uint8_t feedbackNum, const std::vector<ReceivedPacket>& packets, uint64_t when = 0) { ReceivedFeedback(feedbackNum, packets.data(), packets.size(), when); }
 	void UpdateRTT(uint64_t when, uint32_t rtt);
 	uint32_t GetEstimatedBitrate() const;
 	uint32_t GetTargetBitrate() const;
@@ -46,17 +50,27 @@ private:
 	void SetState(ChangeState state);
 	void EstimateBandwidthRate(uint64_t when);
 private:
-	class Stats
+	//Sent packet history, feedback is expected well before the slot is reused
+	static constexpr size_t HistorySize = 8192;
+
+	struct Stats
 	{
-	public:
-		uint64_t time;
-		uint32_t size;
+		uint64_t time = 0;
+		uint16_t size = 0;
+		uint16_t transportSeqNum = 0;
 		bool  mark = false;
 		bool  rtx = false;
 		bool  probing = false;
 	};
+
+	const Stats* GetSentPacket(uint16_t transportSeqNum) const
+	{
+		const Stats& stats = transportWideSentPacketsStats[transportSeqNum % HistorySize];
+		return stats.time && stats.transportSeqNum==transportSeqNum ? &stats : nullptr;
+	}
 private:
-	CircularBuffer<Stats, uint16_t, 32768> transportWideSentPacketsStats;
+	std::array<Stats, HistorySize> transportWideSentPacketsStats = {};
+	uint16_t lastSentTransportSeqNum = 0;
 	uint64_t bandwidthEstimation = 0;
 	uint64_t targetBitrate = 0;
 	uint64_t availableRate = 0;
@@ -0,0 +1,72 @@
+#ifndef SHARDROUTINGTABLE_H
+#define SHARDROUTINGTABLE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "FlatHashMap.h"
+
+/*
+ * Owner shard of ICE connections and authenticated remote addresses of a
+ * ShardedRTPBundleTransport.
+ *
+ * Changes are done under a lock on copies of the tables, which are published
+ * as immutable snapshots. Each shard keeps its own reference to the last
+ * snapshot and only takes the lock to refresh it after a change, so lookups
+ * of packets received by the wrong shard don't lock nor allocate.
+ *
+ * Lookups of a shard must be done from its own thread.
+ */
+class ShardRoutingTable
+{
+public:
+	ShardRoutingTable(uint32_t shards);
+
+	//Connection owners, can be called from any thread
+	uint32_t AddOwner(const std::string& username);
+	std::optional<uint32_t> RestartOwner(const std::string& username, const std::string& restarted);
+	std::optional<uint32_t> RemoveOwner(const std::string& username);
+	std::optional<uint32_t> GetOwner(const std::string& username);
+	size_t GetLoad(uint32_t shard);
+
+	//Remote addresses authenticated by a shard
+	void AddRemote(uint32_t shard, uint32_t ip, uint16_t port);
+	bool RemoveRemote(uint32_t shard, uint32_t ip, uint16_t port);
+
+	//Called from the shard thread
+	std::optional<uint32_t> Lookup(uint32_t shard, std::string_view username);
+	std::optional<uint32_t> Lookup(uint32_t shard, uint32_t ip, uint16_t port);
+private:
+	using Owners	= std::map<std::string, uint32_t, std::less<>>;
+	using Remotes	= FlatHashMap<uint64_t, uint32_t>;
+
+	struct Routes
+	{
+		std::shared_ptr<const Owners>	owners;
+		std::shared_ptr<const Remotes>	remotes;
+	};
+
+	//Each one in its own cache line as they are refreshed from different threads
+	struct alignas(64) Snapshot
+	{
+		Routes routes;
+		uint64_t version = 0;
+	};
+
+	const Routes& GetRoutes(uint32_t shard);
+	void Publish();
+private:
+	std::mutex mutex;
+	Routes routes;
+	std::vector<size_t> load;
+	std::atomic<uint64_t> version = 1;
+	std::vector<Snapshot> snapshots;
+};
+
+#endif /* SHARDROUTINGTABLE_H */
@@ -0,0 +1,68 @@
+#ifndef SHARDEDRTPBUNDLETRANSPORT_H
+#define SHARDEDRTPBUNDLETRANSPORT_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "config.h"
+#include "FileDescriptor.h"
+#include "RTPBundleTransport.h"
+#include "ShardRoutingTable.h"
+
+/*
+ * Serves a single public port from several RTPBundleTransport shards, each
+ * one with its own SO_REUSEPORT socket and event loop pinned to a cpu.
+ *
+ * ICE connections are assigned to the least loaded shard. Once the owner
+ * shard has authenticated a remote candidate, a reuseport BPF program steers
+ * its packets to it. Packets received by other shards before that, or when
+ * the BPF program can't be loaded, are handed over to the owner without
+ * being routed. Lookups are done on lock free snapshots of the routing table.
+ */
+class ShardedRTPBundleTransport :
+	public RTPBundleTransport::Router
+{
+public:
+	ShardedRTPBundleTransport(uint32_t shards, uint32_t packetPoolSize = 0);
+	virtual ~ShardedRTPBundleTransport();
+	int Init(int port = 0);
+	int End();
+
+	RTPBundleTransport::Connection::shared AddICETransport(const std::string &username,const Properties& properties);
+	bool RestartICETransport(const std::string& username, const std::string& restarted, const Properties& properties);
+	int RemoveICETransport(const std::string &username);
+	int AddRemoteCandidate(const std::string& username,const char* ip, WORD port);
+
+	int GetLocalPort() const		{ return port;				}
+	size_t GetShardCount() const		{ return shards.size();			}
+	RTPBundleTransport& GetShard(size_t shard)	{ return *shards[shard];		}
+	bool IsSteeringEnabled() const		{ return steering;			}
+
+	void SetIceTimeout(uint32_t timeout);
+	bool SetAffinity(size_t shard, int cpu);
+	bool SetThreadName(const std::string& name);
+	bool SetPriority(int priority);
+
+	virtual RTPBundleTransport* OnUnknown(RTPBundleTransport* transport, std::string_view username, const uint32_t ip, const uint16_t port) override;
+	virtual void OnCandidateAdded(RTPBundleTransport* transport, const uint32_t ip, const uint16_t port) override;
+	virtual void OnCandidateRemoved(RTPBundleTransport* transport, const uint32_t ip, const uint16_t port) override;
+private:
+	bool AttachSteering();
+	void Steer(uint32_t ip, uint16_t port, uint32_t shard);
+	void Unsteer(uint32_t ip, uint16_t port);
+	uint32_t GetShardIndex(const RTPBundleTransport* transport) const;
+private:
+	std::vector<std::unique_ptr<RTPBundleTransport>> shards;
+	int port = 0;
+
+	ShardRoutingTable table;
+
+	//BPF steering
+	bool steering = false;
+	FileDescriptor sockets;
+	FileDescriptor routes;
+	FileDescriptor program;
+};
+
+#endif /* SHARDEDRTPBUNDLETRANSPORT_H */
@@ -0,0 +1,74 @@
+#ifndef SHAREDOPTIONAL_H
+#define SHAREDOPTIONAL_H
+
+#include <memory>
+#include <optional>
+#include <utility>
+
+/*
+ * Optional value stored out of line, the size of a shared_ptr.
+ *
+ * Copies share the same value. Accessors are read only and modifying it
+ * in place is done with modify(), which makes a private copy first if it
+ * is shared with any other object. It is meant for big members that are
+ * rarely set, so objects that are cloned often, like rtp packets, don't
+ * carry their storage inline and copying them is cheap.
+ * Same as with std::optional, concurrent modification of the same object
+ * must be synchronized by the caller.
+ */
+template <typename T>
+class SharedOptional
+{
+public:
+	SharedOptional() = default;
+	SharedOptional(std::nullopt_t) {}
+	SharedOptional(const T& value) : ptr(std::make_shared<T>(value)) {}
+	SharedOptional(T&& value) : ptr(std::make_shared<T>(std::move(value))) {}
+	SharedOptional(const std::optional<T>& other) : ptr(other ? std::make_shared<T>(*other) : nullptr) {}
+	SharedOptional(std::optional<T>&& other) : ptr(other ? std::make_shared<T>(std::move(*other)) : nullptr) {}
+
+	SharedOptional& operator=(std::nullopt_t)		{ ptr.reset(); return *this;					}
+	SharedOptional& operator=(const T& other)		{ ptr = std::make_shared<T>(other); return *this;		}
+	SharedOptional& operator=(T&& other)			{ ptr = std::make_shared<T>(std::move(other)); return *this;	}
+	SharedOptional& operator=(const std::optional<T>& other){ return *this = SharedOptional(other);			}
+	SharedOptional& operator=(std::optional<T>&& other)	{ return *this = SharedOptional(std::move(other));	}
+
+	template <typename... Args>
+	T& emplace(Args&&... args)
+	{
+		ptr = std::make_shared<T>(std::forward<Args>(args)...);
+		return *ptr;
+	}
+	void reset()				{ ptr.reset();	}
+
+	bool has_value()		const	{ return (bool)ptr;	}
+	explicit operator bool()	const	{ return (bool)ptr;	}
+
+	const T& operator*()		const	{ return *ptr;		}
+	const T* operator->()		const	{ return ptr.get();	}
+	const T& value()		const	{ return *ptr;		}
+
+	//Get it for writing, it must have a value
+	T& modify()				{ return *Own();	}
+
+	//Copy as an inline optional
+	std::optional<T> get()		const	{ return ptr ? std::optional<T>(*ptr) : std::nullopt; }
+	operator std::optional<T>()	const	{ return get();		}
+
+	friend bool operator==(const SharedOptional& lhs, const SharedOptional& rhs)	{ return lhs.ptr==rhs.ptr || (lhs && rhs ? *lhs==*rhs : !lhs && !rhs);	}
+	friend bool operator!=(const SharedOptional& lhs, const SharedOptional& rhs)	{ return !(lhs==rhs);			}
+	friend bool operator==(const SharedOptional& lhs, const T& rhs)			{ return lhs && *lhs==rhs;		}
+	friend bool operator==(const T& lhs, const SharedOptional& rhs)			{ return rhs==lhs;			}
+private:
+	T* Own()
+	{
+		//If shared with any other copy, make it ours before modifying it
+		if (ptr && ptr.use_count()>1)
+			ptr = std::make_shared<T>(*ptr);
+		return ptr.get();
+	}
+private:
+	std::shared_ptr<T> ptr;
+};
+
+#endif /* SHAREDOPTIONAL_H */
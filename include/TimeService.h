@@ -6,6 +6,7 @@
 #include <string>
 #include <functional>
 #include <future>
+#include "InlineFunction.h"
 
 class Timer
 {
@@ -15,6 +16,8 @@ public:
 	virtual ~Timer() = default;
 	virtual void Cancel() = 0;
 	virtual void Again(const std::chrono::milliseconds& ms) = 0;
+	//Sub millisecond scheduling, rounded up to milliseconds if not supported by the time service
+	virtual void AgainMicroseconds(const std::chrono::microseconds& us) { Again(std::chrono::ceil<std::chrono::milliseconds>(us)); }
 	virtual bool IsScheduled() const = 0;
 	virtual void Repeat(const std::chrono::milliseconds& repeat) = 0;
 	virtual void Reschedule(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat) = 0;
@@ -28,6 +31,9 @@ private:
 	
 class TimeService
 {
+public:
+	//Move only task, posting it does not allocate unless its captures exceed the inline capacity
+	using Task = InlineFunction<void(std::chrono::milliseconds), 64>;
 public:
 	virtual ~TimeService() = default;
 	virtual const std::chrono::milliseconds GetNow() const = 0;
@@ -37,6 +43,22 @@ public:
 	virtual void Async(const std::function<void(std::chrono::milliseconds)>& func) = 0;
 	virtual void Async(const std::function<void(std::chrono::milliseconds)>& func, const std::function<void(std::chrono::milliseconds)>& callback) = 0;
 	virtual std::future<void> Future(const std::function<void(std::chrono::milliseconds)>& func) = 0;
+	virtual void Async(Task&& task)
+	{
+		//Wrap it so it is copiable
+		auto shared = std::make_shared<Task>(std::move(task));
+		//Run it
+		Async(std::function<void(std::chrono::milliseconds)>([shared](std::chrono::milliseconds now) { (*shared)(now); }));
+	}
+	template<typename Func, typename = std::enable_if_t<
+		!std::is_same_v<std::decay_t<Func>, Task> &&
+		!std::is_same_v<std::decay_t<Func>, std::function<void(std::chrono::milliseconds)>>
+	>>
+	inline void Async(Func&& func)
+	{
+		//Avoid std::function allocation
+		Async(Task(std::forward<Func>(func)));
+	}
 	inline void Sync(const std::function<void(std::chrono::milliseconds)>& func) 
 	{
 		//Run async and wait for future
@@ -0,0 +1,263 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdint.h>
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+/*
+ * Hierarchical timing wheel with O(1) insert and removal
+ *
+ * Each level has 64 slots, a slot on level n spans 64^n ticks. Entries are
+ * stored on the level of the highest bit in which their deadline differs from
+ * the current wheel time and cascaded to lower levels as time advances.
+ * Entries due after the current rotation of the top level are kept on an
+ * overflow list and linked again each time the top level wraps around.
+ * Entries are intrusive, so the wheel never allocates.
+ */
+class TimerWheel
+{
+public:
+	static constexpr uint64_t Never = std::numeric_limits<uint64_t>::max();
+
+	class Entry
+	{
+	public:
+		virtual ~Entry() = default;
+		bool	 IsLinked()	const { return linked;		}
+		uint64_t GetDeadline()	const { return deadline;	}
+	private:
+		friend class TimerWheel;
+		Entry*	 prev		= nullptr;
+		Entry*	 next		= nullptr;
+		uint64_t deadline	= 0;
+		uint8_t  level		= 0;
+		uint8_t  slot		= 0;
+		bool	 linked		= false;
+	};
+public:
+	TimerWheel(uint64_t now = 0) :
+		elapsed(now)
+	{
+	}
+
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel& operator=(const TimerWheel&) = delete;
+
+	uint64_t GetElapsed()	const { return elapsed;		}
+	size_t   size()		const { return count;		}
+	bool     empty()	const { return !count;		}
+
+	void Add(Entry* entry, uint64_t deadline)
+	{
+		//Remove from previous position
+		if (entry->linked)
+			Remove(entry);
+
+		//Store deadline
+		entry->deadline = deadline;
+
+		//Link it
+		Link(entry);
+
+		//One more
+		count++;
+	}
+
+	void Remove(Entry* entry)
+	{
+		//Check it is scheduled
+		if (!entry->linked)
+			return;
+
+		//Unlink it
+		Unlink(entry);
+
+		//One less
+		count--;
+	}
+
+	//Get the tick of the next slot to process, it may be earlier than the actual deadline of the entries on higher levels
+	uint64_t GetNextExpiration() const
+	{
+		uint8_t level, slot;
+		return NextExpiration(level, slot);
+	}
+
+	//Advance time up to now and get all the expired entries
+	void Expire(uint64_t now, std::vector<Entry*>& expired)
+	{
+		uint8_t level, slot;
+
+		//While we have slots to process before now
+		for (uint64_t next = NextExpiration(level, slot); next<=now; next = NextExpiration(level, slot))
+		{
+			//Move to the slot time
+			elapsed = std::max(elapsed, next);
+
+			//Take all entries on the slot
+			Entry* entry = Head(level, slot);
+			Head(level, slot) = nullptr;
+			if (level<Levels)
+				occupied[level] &= ~(1ull << slot);
+
+			//For each one
+			while (entry)
+			{
+				Entry* next = entry->next;
+				//Not linked anymore
+				entry->prev = entry->next = nullptr;
+				entry->linked = false;
+				//If it has expired
+				if (entry->deadline<=elapsed)
+				{
+					//Not in the wheel anymore
+					count--;
+					//Return it
+					expired.push_back(entry);
+				} else {
+					//Cascade it to a lower level, or back to overflow if still beyond the wheel
+					Link(entry);
+				}
+				entry = next;
+			}
+		}
+
+		//Nothing else to process until now
+		if (now>elapsed)
+			elapsed = now;
+	}
+
+	//Remove all entries from the wheel
+	void Clear(std::vector<Entry*>& removed)
+	{
+		for (uint8_t level = 0; level<Levels; ++level)
+		{
+			for (uint8_t slot = 0; slot<Slots; ++slot)
+			{
+				for (Entry* entry = slots[level][slot]; entry; )
+				{
+					Entry* next = entry->next;
+					entry->prev = entry->next = nullptr;
+					entry->linked = false;
+					removed.push_back(entry);
+					entry = next;
+				}
+				slots[level][slot] = nullptr;
+			}
+			occupied[level] = 0;
+		}
+		for (Entry* entry = overflow; entry; )
+		{
+			Entry* next = entry->next;
+			entry->prev = entry->next = nullptr;
+			entry->linked = false;
+			removed.push_back(entry);
+			entry = next;
+		}
+		overflow = nullptr;
+		count = 0;
+	}
+
+private:
+	static constexpr uint8_t  Bits	 = 6;
+	static constexpr uint8_t  Slots	 = 1 << Bits;
+	static constexpr uint8_t  Levels = 6;
+	static constexpr uint64_t Range	 = 1ull << (Bits * Levels);
+
+	void Link(Entry* entry)
+	{
+		//Entries already expired go to current slot
+		uint64_t when = std::max(entry->deadline, elapsed);
+
+		uint8_t level = Levels;
+		uint8_t slot = 0;
+		//If it is due within the current rotation of the top level
+		if ((when ^ elapsed) < Range)
+		{
+			//Get highest bit that differs from current time
+			uint64_t masked = (when ^ elapsed) | (Slots - 1);
+			uint8_t significant = 63 - __builtin_clzll(masked);
+			level = significant / Bits;
+			slot = (when >> (level * Bits)) & (Slots - 1);
+			occupied[level] |= 1ull << slot;
+		}
+
+		//Insert at head of slot list, or overflow list
+		Entry*& head = Head(level, slot);
+		entry->prev = nullptr;
+		entry->next = head;
+		if (head)
+			head->prev = entry;
+		head = entry;
+
+		//Store position
+		entry->level = level;
+		entry->slot = slot;
+		entry->linked = true;
+	}
+
+	void Unlink(Entry* entry)
+	{
+		//Remove from list
+		if (entry->prev)
+			entry->prev->next = entry->next;
+		else
+			Head(entry->level, entry->slot) = entry->next;
+		if (entry->next)
+			entry->next->prev = entry->prev;
+
+		//If slot is empty now
+		if (entry->level<Levels && !slots[entry->level][entry->slot])
+			occupied[entry->level] &= ~(1ull << entry->slot);
+
+		//Not linked anymore
+		entry->prev = entry->next = nullptr;
+		entry->linked = false;
+	}
+
+	uint64_t NextExpiration(uint8_t& level, uint8_t& slot) const
+	{
+		//Lower levels always expire before higher ones
+		for (level = 0; level<Levels; ++level)
+		{
+			//Skip empty levels
+			if (!occupied[level])
+				continue;
+
+			uint64_t slotRange = 1ull << (level * Bits);
+			uint64_t levelRange = slotRange << Bits;
+			uint8_t current = (elapsed >> (level * Bits)) & (Slots - 1);
+
+			//Find first occupied slot starting at the current one
+			uint64_t rotated = (occupied[level] >> current) | (current ? occupied[level] << (Slots - current) : 0);
+			slot = (current + __builtin_ctzll(rotated)) & (Slots - 1);
+
+			//Get slot start time, slots never wrap around as entries are always within the current rotation of their level
+			return (elapsed & ~(levelRange - 1)) + slot * slotRange;
+		}
+
+		//Entries on overflow are linked again when the top level wraps around
+		if (overflow)
+		{
+			slot = 0;
+			return (elapsed & ~(Range - 1)) + Range;
+		}
+		return Never;
+	}
+
+	Entry*& Head(uint8_t level, uint8_t slot)
+	{
+		return level<Levels ? slots[level][slot] : overflow;
+	}
+private:
+	Entry*	 slots[Levels][Slots] = {};
+	Entry*	 overflow = nullptr;
+	uint64_t occupied[Levels] = {};
+	uint64_t elapsed = 0;
+	size_t	 count = 0;
+};
+
+#endif /* TIMERWHEEL_H */
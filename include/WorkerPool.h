@@ -0,0 +1,42 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "InlineFunction.h"
+
+/*
+ * Fixed set of threads running blocking or cpu heavy tasks out of the
+ * event loops. Tasks are run in order of arrival, results must be posted
+ * back to the owner loop by the task itself.
+ */
+class WorkerPool
+{
+public:
+	using Task = InlineFunction<void()>;
+public:
+	WorkerPool(size_t workers, const std::string& name);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	void Post(Task&& task);
+
+	size_t GetSize() const		{ return threads.size();	}
+	size_t GetPending();
+private:
+	void Run();
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::deque<Task> tasks;
+	bool running = true;
+};
+
+#endif /* WORKERPOOL_H */
@@ -1,4 +1,4 @@
-/* 
+/*
  * File:   crc32.h
  * Author: Sergio
  *
@@ -10,44 +10,35 @@
 
 #include "config.h"
 
+/*
+ * CRC-32 (ISO-HDLC, reflected 0xEDB88320) as used by the STUN fingerprint
+ *
+ * The implementation is selected at runtime, carry-less multiplication
+ * folding when the cpu supports PCLMULQDQ and slicing-by-8 tables otherwise.
+ * The byte-at-a-time table engine is kept as reference.
+ */
 class CRC32Calc
 {
 public:
-	CRC32Calc()
+	enum Engine
 	{
-		//Check if inited globally
-		if (!inited)
-		{
-			for (DWORD i = 0; i < 256; ++i) {
-				DWORD c = i;
-				for (DWORD j = 0; j < 8; ++j) {
-					if (c & 1) {
-						c = 0xEDB88320 ^ (c >> 1);
-					} else {
-						c >>= 1;
-					}
-				}
-				table[i] = c;
-			}
-			//Initied
-			inited = true;
-		}
-
-		crc = 0;
-	}
-
-	DWORD Update(const BYTE *data, DWORD size)
+		Table,
+		SlicingBy8,
+		PCLMUL
+	};
+	static bool IsSupported(Engine engine);
+	static Engine GetDefaultEngine();
+	static const char* GetEngineName(Engine engine);
+public:
+	CRC32Calc(Engine engine = GetDefaultEngine()) :
+		engine(IsSupported(engine) ? engine : SlicingBy8)
 	{
-		DWORD c = crc ^ 0xFFFFFFFF;
-		for (DWORD i = 0; i < size; ++i) 
-			c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
-		crc =  c ^ 0xFFFFFFFF;
-		return crc;
 	}
+
+	DWORD Update(const BYTE *data, DWORD size);
+	DWORD GetValue() const	{ return crc;		}
 private:
-	static DWORD table[256];
-	static bool inited;
-private:
+	Engine engine;
 	DWORD crc = 0;
 };
 
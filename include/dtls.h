@@ -6,12 +6,15 @@
 #include <openssl/err.h>
 #include <openssl/bio.h>
 #include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <map>
 #include <vector>
 #include "config.h"
 #include "log.h"
 #include "Datachannels.h"
+#include "WorkerPool.h"
 
 class DTLSConnection
 {
@@ -32,6 +35,12 @@ public:
 		UNKNOWN_SUITE		= 0
 	};
 
+	enum KeyType
+	{
+		RSA_2048,
+		ECDSA_P256
+	};
+
 	enum Hash
 	{
 		SHA1,
@@ -58,9 +67,33 @@ public:
 
 public:
 	static void SetCertificate(const char* cert,const char* key);
+	//Key used when generating the certificate, must be called before Initialize
+	static void SetKeyType(KeyType type);
+	//Directory to store the generated certificate and reuse it on next runs, must be called before Initialize
+	static void SetCertificateCache(const char* directory);
+	//Number of threads running handshake crypto out of the event loops, 0 to run it inline. Must be called before Initialize
+	static void SetHandshakeWorkers(size_t workers);
 	static int Initialize();
 	static int Terminate();
 	static std::string GetCertificateFingerPrint(Hash hash);
+	static const char* GetKeyTypeName(KeyType type)
+	{
+		switch (type)
+		{
+			case RSA_2048:		return "rsa2048";
+			case ECDSA_P256:	return "ecdsa-p256";
+		}
+		return "unknown";
+	}
+	static int GetKeyTypeId(KeyType type)
+	{
+		switch (type)
+		{
+			case RSA_2048:		return EVP_PKEY_RSA;
+			case ECDSA_P256:	return EVP_PKEY_EC;
+		}
+		return EVP_PKEY_NONE;
+	}
 	static bool IsDTLS(const BYTE* buffer,const DWORD size)		{ return buffer[0]>=20 && buffer[0]<=64; }
 	static Suite SuiteFromName(const char* suite) 
 	{
@@ -98,8 +131,11 @@ public:
 	}
 
 private:
+	static EVP_PKEY* GenerateKey(KeyType type);
 	static int GenerateCertificate();
-	static int ReadCertificate();
+	static int ReadCertificate(const std::string& certfile,const std::string& pvtfile);
+	static int ReadCachedCertificate();
+	static int WriteCachedCertificate();
 	
 private:
 	typedef std::map<Hash, std::string> LocalFingerPrints;
@@ -108,12 +144,17 @@ private:
 	static std::string	certfile;		// Certificate file name
 	static std::string	pvtfile;		// Private key file name
 	static std::string	cipher;			// Cipher to use 
+	static std::string	ecdsaCipher;		// Cipher to use with EC keys
+	static std::string	cacheDir;		// Generated certificate cache directory
+	static KeyType		keyType;		// Generated key type
 	static SSL_CTX*		ssl_ctx;		// SSL context 
 	static X509*		certificate;		// SSL context 
 	static EVP_PKEY*	privateKey;		// SSL context 
 	static LocalFingerPrints localFingerPrints;
 	static AvailableHashes	availableHashes;
 	static bool		hasDTLS;
+	static size_t		handshakeWorkers;	// Number of handshake threads
+	static std::unique_ptr<WorkerPool> workers;	// Handshake threads
 
 public:
 	DTLSConnection(Listener& listener,TimeService& timeService,datachannels::Transport& sctp);
@@ -141,6 +182,10 @@ protected:
 	int  SetupSRTP();
 	void Shutdown();
 	void CheckPending();
+	int  Process();
+	int  Offload();
+	void OnOffloaded();
+	void CancelOffload();
 private:
 	Listener& listener;
 	TimeService& timeService;
@@ -154,6 +199,20 @@ private:
 	unsigned char remoteFingerprint[EVP_MAX_MD_SIZE] = {};	// Fingerprint of the peer certificate 
 	std::atomic<bool> inited;	// Set to true once the SSL stuff is set for this DTLS session 
 	std::string profiles;		// Overrriden list of srtp profiles
+	
+	//Max records kept while the handshake is running on a worker
+	static constexpr size_t MaxQueuedRecords = 64;
+	//Handshake running on a worker, shared so a queued task can detect the connection has ended
+	struct Offloaded
+	{
+		std::mutex mutex;
+		bool cancelled = false;
+	};
+	std::shared_ptr<Offloaded> offloaded;
+	bool handshaking	= false;	// Loop side, ssl is owned by a worker until it posts back
+	bool onWorker		= false;	// Worker side, defer events to the loop
+	bool handshakeDone	= false;	// Handshake finished on the worker
+	std::vector<std::vector<BYTE>> queued;	// Records received while the worker owns the ssl
 };
 
 #endif
@@ -118,6 +118,7 @@ struct DependencyDescriptor
 	void Dump() const;
 	
 	static std::optional<DependencyDescriptor> Parse(BitReader& reader, const std::optional<TemplateDependencyStructure>& templateDependencyStructure = std::nullopt);
+	static std::optional<DependencyDescriptor> Parse(BitReader& reader, const TemplateDependencyStructure* templateDependencyStructure);
 
 	friend bool operator==(const DependencyDescriptor& lhs, const DependencyDescriptor& rhs)
 	{
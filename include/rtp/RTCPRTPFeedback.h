@@ -267,8 +267,8 @@ public:
 		virtual DWORD Serialize(BYTE* data,DWORD size) const;
 		virtual void Dump() const;
 		
-		//Pair<seqnum,us> -> us = 0, not received
-		typedef std::map<DWORD,QWORD> Packets;
+		//Pair<seqnum,us> -> us = 0, not received, consecutive and in seqnum order
+		typedef std::vector<std::pair<DWORD,QWORD>> Packets;
 		
 		BYTE feedbackPacketCount;
 		QWORD referenceTime = 0;
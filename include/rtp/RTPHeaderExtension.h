@@ -6,6 +6,7 @@
 
 #include "config.h"
 #include "tools.h"
+#include "SharedOptional.h"
 #include "rtp/RTPMap.h"
 #include "rtp/DependencyDescriptor.h"
 #include "rtp/VideoLayersAllocation.h"
@@ -224,7 +225,7 @@ public:
 
 public:
 	DWORD Parse(const RTPMap &extMap,const BYTE* data,const DWORD size);
-	bool  ParseDependencyDescriptor(const std::optional<TemplateDependencyStructure>& templateDependencyStructure);
+	bool  ParseDependencyDescriptor(const SharedOptional<TemplateDependencyStructure>& templateDependencyStructure);
 	DWORD Serialize(const RTPMap &extMap,BYTE* data,const DWORD size) const;
 	void  Dump() const;
 public:
@@ -239,11 +240,11 @@ public:
 	std::string repairedId;
 	std::string mid;
 	BitReader dependencyDescryptorReader; 
-	std::optional<::DependencyDescriptor> dependencyDescryptor;
+	SharedOptional<::DependencyDescriptor> dependencyDescryptor;
 	struct AbsoluteCaptureTime absoluteCaptureTime;
 	struct PlayoutDelay playoutDelay;
-	std::optional<struct ColorSpace> colorSpace;
-	std::optional<struct VideoLayersAllocation> videoLayersAllocation;
+	SharedOptional<struct ColorSpace> colorSpace;
+	SharedOptional<struct VideoLayersAllocation> videoLayersAllocation;
 	
 	bool	hasAbsSentTime		= false;
 	bool	hasTimeOffset		= false;
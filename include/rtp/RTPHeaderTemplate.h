@@ -0,0 +1,69 @@
+#ifndef RTPHEADERTEMPLATE_H
+#define RTPHEADERTEMPLATE_H
+
+#include <array>
+#include <string>
+#include "config.h"
+#include "rtp/RTPPacket.h"
+#include "rtp/RTPMap.h"
+
+/*
+ * Serialized rtp header and extensions of the last packet sent on an
+ * outgoing source, used to send the next ones without serializing them again.
+ *
+ * A packet matches the template when it carries the same extensions, with
+ * the same ids, and the ones that are not patched have the same value. The
+ * header fields, transport wide seq num, abs send time and audio level are
+ * patched on a copy of the template and the payload appended after it, with
+ * the vp8 picture ids rewritten in the payload descriptor if needed, so the
+ * output is the same than RTPPacket::Serialize. Packets with extensions
+ * that change on every packet, like the dependency descriptor, don't match
+ * and must be serialized as usual.
+ */
+class RTPHeaderTemplate
+{
+public:
+	static constexpr DWORD MaxSize = 128;
+public:
+	//Check if the packet can be serialized from this template with the extension map
+	bool Matches(const RTPPacket& packet, const RTPMap& extMap) const;
+	//Store header and extensions of a packet serialized with RTPPacket::Serialize, returns false if it can't be used as template
+	bool Set(const RTPPacket& packet, const RTPMap& extMap, const BYTE* data, DWORD size);
+	//Serialize a matching packet, returns 0 if it does not fit
+	DWORD Serialize(const RTPPacket& packet, BYTE* data, DWORD size) const;
+	void Reset();
+
+	bool  IsEmpty()		const { return !headerSize;	}
+	DWORD GetHeaderSize()	const { return headerSize;	}
+
+	//Find the offsets of the one or two byte header extension values with the given ids and lengths. Returns the rtp header size including extensions or 0 if malformed
+	static DWORD FindExtensions(const BYTE* data, DWORD size, const BYTE* ids, const BYTE* lengths, WORD* offsets, DWORD num);
+private:
+	enum Extension
+	{
+		AudioLevel = 0,
+		AbsSentTime,
+		TransportWideCC,
+		MediaStreamId,
+		VideoOrientation,
+		PlayoutDelay,
+		Count
+	};
+	using Ids = std::array<BYTE,Extension::Count>;
+
+	static bool GetIds(const RTPPacket& packet, const RTPMap& extMap, Ids& ids);
+private:
+	std::array<BYTE,MaxSize> header;
+	WORD headerSize			= 0;
+	//Offset of the extension values that are patched, 0 if not present
+	WORD transportSeqNumOffset	= 0;
+	WORD absSentTimeOffset		= 0;
+	WORD audioLevelOffset		= 0;
+	//Values it was created with
+	Ids ids;
+	std::string mid;
+	BYTE cvo			= 0;
+	DWORD playoutDelay		= 0;
+};
+
+#endif /* RTPHEADERTEMPLATE_H */
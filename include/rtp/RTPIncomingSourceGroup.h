@@ -83,8 +83,8 @@ private:
 	RTPLostPackets	losts;
 	RTPBuffer	packets;
 	std::set<RTPIncomingMediaStream::Listener*>  listeners;
-	std::optional<std::vector<bool>> activeDecodeTargets;
-	std::optional<TemplateDependencyStructure> templateDependencyStructure;
+	SharedOptional<std::vector<bool>> activeDecodeTargets;
+	SharedOptional<TemplateDependencyStructure> templateDependencyStructure;
 	
 	bool  isRTXEnabled = true;
 	WORD  rttrtxSeq	 = 0 ;
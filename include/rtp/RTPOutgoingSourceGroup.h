@@ -4,10 +4,12 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "config.h"
 #include "rtp/RTPPacket.h"
 #include "rtp/RTPOutgoingSource.h"
+#include "rtp/RTPHeaderTemplate.h"
 #include "TimeService.h"
 #include "CircularBuffer.h"
 
@@ -15,6 +17,21 @@ struct RTPOutgoingSourceGroup
 {
 public:
 	using shared = std::shared_ptr<RTPOutgoingSourceGroup>;
+	
+	//Sent packet as serialized before encryption, so it can be retransmitted without serializing it again
+	struct SerializedPacket
+	{
+		const BYTE* data		= nullptr;
+		WORD  size			= 0;
+		//RTP header and extensions, payload starts after it
+		WORD  headerSize		= 0;
+		//Offset of the extension values to update on retransmission, 0 if not present
+		WORD  transportSeqNumOffset	= 0;
+		WORD  absSentTimeOffset		= 0;
+		DWORD extSeqNum			= 0;
+		DWORD mediaLength		= 0;
+		DWORD clockRate			= 0;
+	};
 public:
 	class Listener 
 	{
@@ -42,6 +59,10 @@ public:
 	//RTX packets
 	void AddPacket(const RTPPacket::shared& packet);
 	RTPPacket::shared GetPacket(WORD seq) const;
+	//Serialized RTX cache, disabled by default, it uses up to size*MTU bytes
+	void SetSerializedCacheSize(WORD size);
+	void AddSerializedPacket(const RTPPacket::shared& packet,const BYTE* data,DWORD size,BYTE transportWideCCId,BYTE absSentTimeId);
+	const SerializedPacket* GetSerializedPacket(WORD seq) const;
 
 	bool isRTXAllowed(WORD seq, QWORD now) const;
 	void SetRTXTime(WORD seq, QWORD time);
@@ -67,11 +88,16 @@ public:
 	MediaFrame::Type type;
 	RTPOutgoingSource media;
 	RTPOutgoingSource rtx;
+	//Header of last media packet sent, only used by the transport thread
+	RTPHeaderTemplate headerTemplate;
 	QWORD lastUpdated = 0;
 private:	
 	TimeService& timeService;
 	CircularBuffer<RTPPacket::shared, uint16_t, 512> packets;
 	CircularBuffer<QWORD, uint16_t, 512> rtxTimes;
+	//Serialized packets indexed by seq num modulo the cache size
+	std::vector<SerializedPacket> serialized;
+	std::vector<BYTE> serializedData;
 	std::set<Listener*> listeners;
 	std::optional<struct RTPHeaderExtension::PlayoutDelay> forcedPlayoutDelay;
 };
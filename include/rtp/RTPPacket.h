@@ -24,6 +24,8 @@ public:
 public:
 	static RTPPacket::shared Parse(const BYTE* data, DWORD size, const RTPMap& rtpMap, const RTPMap& extMap);
 	static RTPPacket::shared Parse(const BYTE* data, DWORD size, const RTPMap& rtpMap, const RTPMap& extMap, QWORD time);
+	//Parse the packet in place, the payload must contain the whole rtp packet and it will be owned by the packet
+	static RTPPacket::shared Parse(RTPPayload::shared&& payload, const RTPMap& rtpMap, const RTPMap& extMap, QWORD time);
 public:
 	RTPPacket(MediaFrame::Type media, BYTE codec);
 	RTPPacket(MediaFrame::Type media, BYTE codec, QWORD time);
@@ -42,6 +44,7 @@ public:
 	
 	bool RecoverOSN();
 	void SetOSN(DWORD extSeqNum);
+	bool HasOSN() const { return osn.has_value(); }
 
 	virtual void Dump() const;
 	
@@ -102,7 +105,7 @@ public:
 	void  SetColorSpace(const struct RTPHeaderExtension::ColorSpace& colorSpace)		{ header.extension = extension.hasColorSpace		= true; extension.colorSpace = colorSpace;				}
 	void  SetVideoLayersAllocation(const VideoLayersAllocation& videoLayersAllocation)	{ header.extension = extension.hasVideoLayersAllocation = true; extension.videoLayersAllocation = videoLayersAllocation;	}
 	
-	bool  ParseDependencyDescriptor(const std::optional<TemplateDependencyStructure>& templateDependencyStructure, std::optional<std::vector<bool>>& activeDecodeTargets);
+	bool  ParseDependencyDescriptor(const SharedOptional<TemplateDependencyStructure>& templateDependencyStructure, const SharedOptional<std::vector<bool>>& activeDecodeTargets);
 	
 	//Disable extensions
 	void  DisableAbsSentTime()		{ extension.hasAbsSentTime		= false; CheckExtensionMark(); }
@@ -129,13 +132,13 @@ public:
 	const std::string& GetMediaStreamId()	const	{ return extension.mid;				}
 	
 	const RTPHeaderExtension::FrameMarks&			GetFrameMarks()			 const { return extension.frameMarks;		}
-	const std::optional<DependencyDescriptor>&		GetDependencyDescriptor()	 const { return extension.dependencyDescryptor;	}
-	const std::optional<TemplateDependencyStructure>&	GetTemplateDependencyStructure() const { return templateDependencyStructure;	}
-	const std::optional<std::vector<bool>>&			GetActiveDecodeTargets()	 const { return activeDecodeTargets;		}
+	const SharedOptional<DependencyDescriptor>&		GetDependencyDescriptor()	 const { return extension.dependencyDescryptor;	}
+	const SharedOptional<TemplateDependencyStructure>&	GetTemplateDependencyStructure() const { return templateDependencyStructure;	}
+	const SharedOptional<std::vector<bool>>&		GetActiveDecodeTargets()	 const { return activeDecodeTargets;		}
 	const VideoOrientation&					GetVideoOrientation()		 const { return extension.cvo;			}
 	const struct RTPHeaderExtension::PlayoutDelay&		GetPlayoutDelay()		 const { return extension.playoutDelay;		}
-	const std::optional<struct RTPHeaderExtension::ColorSpace>&    GetColorSpace()		 const { return extension.colorSpace;		}
-	const std::optional<struct VideoLayersAllocation>&	GetVideoLayersAllocation()	 const { return extension.videoLayersAllocation;}
+	const SharedOptional<struct RTPHeaderExtension::ColorSpace>&   GetColorSpace()		 const { return extension.colorSpace;		}
+	const SharedOptional<struct VideoLayersAllocation>&	GetVideoLayersAllocation()	 const { return extension.videoLayersAllocation;}
 	
 	bool  HasAudioLevel()			const	{ return extension.hasAudioLevel;		}
 	bool  HasAbsSentTime()			const	{ return extension.hasAbsSentTime;		}
@@ -159,7 +162,7 @@ public:
 	void  OverrideActiveDecodeTargets(const std::optional<std::vector<bool>>& activeDecodeTargets) 
 	{
 		if (extension.dependencyDescryptor)
-			extension.dependencyDescryptor->activeDecodeTargets = activeDecodeTargets;
+			extension.dependencyDescryptor.modify().activeDecodeTargets = activeDecodeTargets;
 	}
 	void OverrideTemplateDependencyStructure(const std::optional<TemplateDependencyStructure>& templateDependencyStructure)
 	{
@@ -168,7 +171,7 @@ public:
 	void  OverrideFrameNumber(uint16_t frameNumber)
 	{
 		if (extension.dependencyDescryptor)
-			extension.dependencyDescryptor->frameNumber = frameNumber;
+			extension.dependencyDescryptor.modify().frameNumber = frameNumber;
 	}
 	
 	QWORD GetTime()				const	{ return time;				}
@@ -195,11 +198,11 @@ public:
 	//TODO:refactor a bit
 	std::optional<VP8PayloadDescriptor>	vp8PayloadDescriptor;
 	std::optional<VP8PayloadHeader>		vp8PayloadHeader;
-	std::optional<VP9PayloadDescription>	vp9PayloadDescriptor;
-	std::optional<H264SeqParameterSet>	h264SeqParameterSet;
-	std::optional<H264PictureParameterSet>	h264PictureParameterSet;
-	std::optional<std::vector<bool>>	activeDecodeTargets;
-	std::optional<TemplateDependencyStructure> templateDependencyStructure;
+	SharedOptional<VP9PayloadDescription>	vp9PayloadDescriptor;
+	SharedOptional<H264SeqParameterSet>	h264SeqParameterSet;
+	SharedOptional<H264PictureParameterSet>	h264PictureParameterSet;
+	SharedOptional<std::vector<bool>>	activeDecodeTargets;
+	SharedOptional<TemplateDependencyStructure> templateDependencyStructure;
 	Buffer::shared				config;
 
 	bool rewitePictureIds = false;
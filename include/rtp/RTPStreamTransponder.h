@@ -37,6 +37,7 @@ public:
 
 	// RTPIncomingMediaStream::Listener interface
 	virtual void onRTP(const RTPIncomingMediaStream* stream, const RTPPacket::shared& packet) override;
+	virtual void onRTP(const RTPIncomingMediaStream* stream, const std::vector<RTPPacket::shared>& packets) override;
 	virtual void onBye(const RTPIncomingMediaStream* stream) override;
 	virtual void onEnded(const RTPIncomingMediaStream* stream) override;
 
@@ -54,6 +55,7 @@ public:
 
 protected:
 	void RequestPLI();
+	void ForwardPacket(const RTPIncomingMediaStream* stream, const RTPPacket::shared& packet);
 
 private:
 	TimeService& timeService;
@@ -0,0 +1,47 @@
+#ifndef TRANSPORTWIDECCRECEIVESTATS_H
+#define TRANSPORTWIDECCRECEIVESTATS_H
+
+#include <array>
+#include "config.h"
+
+/*
+ * Receive times of the transport wide cc packets pending to be reported
+ *
+ * Times are stored in a ring indexed by the extended transport sequence
+ * number, zero meaning not received, and the feedback message is encoded
+ * straight from it without building the packet map of RTCPRTPFeedback.
+ * The pending window starts on the packet after the last reported one, so
+ * packets missing in between are reported as lost.
+ */
+class TransportWideCCReceiveStats
+{
+public:
+	static constexpr DWORD Size = 4096;
+public:
+	TransportWideCCReceiveStats();
+
+	//Time in us, relative to any fixed reference. Returns false if it could not be stored because the window is full or it was already reported
+	bool Add(DWORD extSeqNum, QWORD time);
+
+	//Encode the transport wide feedback message FCI for the pending packets and clear them, returns 0 if there was nothing to report
+	DWORD Serialize(BYTE feedbackPacketCount, BYTE* data, DWORD size);
+
+	void Reset();
+
+	bool  IsEmpty()		const { return !received;		}
+	DWORD GetReceived()	const { return received;		}
+	DWORD GetPending()	const { return end - begin;		}
+	//Arrival time of the first packet received since last feedback
+	QWORD GetFirstTime()	const { return firstTime;		}
+	//Highest extended seq num added so far, either pending or already reported
+	DWORD GetMaxExtSeqNum()	const { return end ? end - 1 : 0;	}
+private:
+	std::array<QWORD,Size> times = {};
+	DWORD begin	= 0;
+	DWORD end	= 0;
+	DWORD received	= 0;
+	QWORD firstTime	= 0;
+	bool  reported	= false;
+};
+
+#endif /* TRANSPORTWIDECCRECEIVESTATS_H */
@@ -9,6 +9,8 @@
 #define	STUNMESSAGE_H
 #include "config.h"
 #include "tools.h"
+#include <string>
+#include <string_view>
 #include <vector>
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +18,9 @@
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <openssl/sha.h>
+#include <openssl/evp.h>
+#include <memory>
 
 class STUNMessage
 {
@@ -98,14 +103,71 @@ public:
 		WORD size;
 		BYTE *attr;
 	};
+	
+	//HMAC-SHA1 key with the pads already hashed, so message integrity only hashes the message
+	class HMACKey
+	{
+	public:
+		static constexpr DWORD Size = SHA_DIGEST_LENGTH;
+	public:
+		HMACKey();
+		//Only recomputes the pads if the password has changed
+		void SetPassword(const char* pwd);
+		//Calculate the HMAC of the message using length as the value of the header length field, not thread safe
+		void Compute(const BYTE* data,DWORD size,WORD length,BYTE* mac) const;
+	private:
+		struct ContextDeleter
+		{
+			void operator()(EVP_MD_CTX* ctx) const { EVP_MD_CTX_free(ctx); }
+		};
+		using Context = std::unique_ptr<EVP_MD_CTX,ContextDeleter>;
+	private:
+		std::string pwd;
+		bool ready = false;
+		Context inner;
+		Context outer;
+		//Preallocated working context the pads are copied into for each message
+		Context ctx;
+	};
+	
+	//Message validated in place, attributes point to the received data so it must outlive the view
+	class View
+	{
+	public:
+		bool Parse(const BYTE* data,DWORD size);
+		bool CheckMessageIntegrity(const HMACKey& key) const;
+		
+		Type   GetType()			const { return type;				}
+		Method GetMethod()			const { return method;				}
+		const BYTE* GetTransactionId()		const { return data+8;				}
+		bool   HasUsername()			const { return username;			}
+		std::string_view GetUsername()		const { return {(const char*)data+username,usernameLength}; }
+		bool   HasPriority()			const { return priority;			}
+		DWORD  GetPriority()			const { return priority ? get4(data,priority) : 0; }
+		bool   HasUseCandidate()		const { return useCandidate;			}
+	private:
+		const BYTE* data	= nullptr;
+		DWORD size		= 0;
+		Type   type		= Request;
+		Method method		= Binding;
+		//Attribute value offsets, 0 if not present
+		DWORD username		= 0;
+		WORD  usernameLength	= 0;
+		DWORD priority		= 0;
+		DWORD integrity		= 0;
+		bool  useCandidate	= false;
+	};
 public:
 	static bool IsSTUN(const BYTE* data,DWORD size);
 	static STUNMessage* Parse(const BYTE* data,DWORD size);
+	//Serialize an authenticated binding success response with the xor mapped address of the request origin
+	static DWORD SerializeBindingResponse(const View& request,uint32_t ip,uint16_t port,const HMACKey& key,BYTE* data,DWORD size);
 public:
 	STUNMessage(Type type,Method method,const BYTE* transId);
 	~STUNMessage();
 	STUNMessage* CreateResponse();
 	DWORD AuthenticatedFingerPrint(BYTE* data,DWORD size,const char* pwd);
+	DWORD AuthenticatedFingerPrint(BYTE* data,DWORD size,const HMACKey& key);
 	DWORD NonAuthenticatedFingerPrint(BYTE* data,DWORD size);
 	bool CheckAuthenticatedFingerPrint(const BYTE* data,DWORD size,const char* pwd);
 	DWORD GetSize();
@@ -47,10 +47,11 @@ constexpr auto ProbingInterval			= 5ms;
 constexpr auto MaxRTXOverhead			= 0.70f;
 constexpr auto TransportWideCCMaxPackets	= 100;
 constexpr auto TransportWideCCMaxInterval	= 5E4;	//50ms
+constexpr DWORD SRTCPTrailerSize		= 4 + 16;	//SRTCP index and max auth tag
 constexpr auto MaxProbingHistorySize		= 50;
 constexpr auto RtxRttThresholdMs 		= 300;
 
-DTLSICETransport::DTLSICETransport(Sender *sender,TimeService& timeService, ObjectPool<Packet>& packetPool) :
+DTLSICETransport::DTLSICETransport(Sender *sender,TimeService& timeService, PacketPool& packetPool) :
 	sender(sender),
 	timeService(timeService),
 	packetPool(packetPool),
@@ -180,6 +181,133 @@ int DTLSICETransport::onData(const ICERemoteCandidate* candidate,const BYTE* dat
 	if (!packet)
 		//Error
 		return Warning("-DTLSICETransport::onData() | Could not parse rtp packet\n");
+	
+	//Process it
+	return onRTP(candidate,packet,data,len,size,now);
+}
+
+int DTLSICETransport::onData(const ICERemoteCandidate* candidate,RTPPayload::shared&& payload)
+{
+	BYTE* data = payload->GetMediaData();
+	DWORD size = payload->GetMediaLength();
+	
+	//DTLS and RTCP are not kept, process them on the received buffer
+	if (DTLSConnection::IsDTLS(data,size) || RTCPCompoundPacket::IsRTCP(data,size))
+		return onData(candidate,data,size);
+	
+	TRACE_EVENT("transport", "DTLSICETransport::onData", "size", size);
+
+	//Get current time
+	auto now = getTime();
+	
+	//Check session
+	if (!recv.IsSetup())
+		return Warning("-DTLSICETransport::onData() | Recv SRTPSession is not setup\n");
+	
+	//unprotect in place
+	size_t len = recv.UnprotectRTP(data,size);
+	//Check status
+	if (!len)
+		//Error
+		return Warning("-DTLSICETransport::onData() | Error unprotecting rtp packet [%s]\n",recv.GetLastError());
+	
+	//Remove srtp trailer
+	payload->SetMediaLength(len);
+	
+	//Parse rtp packet without copying it, payload will be owned by the packet
+	RTPPacket::shared packet = RTPPacket::Parse(std::move(payload),recvMaps.rtp,recvMaps.ext,now/1000);
+	
+	//Check
+	if (!packet)
+		//Error
+		return Warning("-DTLSICETransport::onData() | Could not parse rtp packet\n");
+	
+	//Process it
+	return onRTP(candidate,packet,data,len,size,now);
+}
+
+int DTLSICETransport::onData(const ICERemoteCandidate* candidate,RTPPayload::shared* payloads,size_t count)
+{
+	TRACE_EVENT("transport", "DTLSICETransport::onData", "count", count);
+	
+	//Get current time
+	auto now = getTime();
+	
+	//Max number of packets decrypted together
+	static constexpr size_t BatchSize = 32;
+	
+	int ret = 0;
+	size_t pending = 0;
+	RTPPayload::shared* rtp[BatchSize];
+	SRTPSession::Span spans[BatchSize];
+	
+	//Decrypt pending rtp packets at once and process them in order
+	auto flush = [&]() {
+		//Check session
+		if (!recv.IsSetup())
+		{
+			ret += Warning("-DTLSICETransport::onData() | Recv SRTPSession is not setup\n");
+			pending = 0;
+			return;
+		}
+		//unprotect all in place
+		if (recv.UnprotectRTP(spans,pending)<pending)
+			Warning("-DTLSICETransport::onData() | Error unprotecting rtp packets [%s]\n",recv.GetLastError());
+		for (size_t i = 0; i < pending; ++i)
+		{
+			auto& payload = *rtp[i];
+			BYTE* data = spans[i].data;
+			DWORD size = payload->GetMediaLength();
+			DWORD len = spans[i].size;
+			//Skip failed ones
+			if (!len)
+				continue;
+			//Remove srtp trailer
+			payload->SetMediaLength(len);
+			//Parse rtp packet without copying it, payload will be owned by the packet
+			RTPPacket::shared packet = RTPPacket::Parse(std::move(payload),recvMaps.rtp,recvMaps.ext,now/1000);
+			//Check
+			if (!packet)
+			{
+				Warning("-DTLSICETransport::onData() | Could not parse rtp packet\n");
+				continue;
+			}
+			//Process it
+			ret += onRTP(candidate,packet,data,len,size,now);
+		}
+		pending = 0;
+	};
+	
+	for (size_t i = 0; i < count; ++i)
+	{
+		BYTE* data = payloads[i]->GetMediaData();
+		DWORD size = payloads[i]->GetMediaLength();
+		
+		//DTLS and RTCP are not kept, process them on the received buffer keeping arrival order
+		if (DTLSConnection::IsDTLS(data,size) || RTCPCompoundPacket::IsRTCP(data,size))
+		{
+			flush();
+			ret += onData(candidate,data,size);
+			continue;
+		}
+		
+		//Queue it
+		rtp[pending] = &payloads[i];
+		spans[pending] = {data, size};
+		//If full
+		if (++pending==BatchSize)
+			flush();
+	}
+	
+	//Process remaining ones
+	if (pending)
+		flush();
+	
+	return ret;
+}
+
+int DTLSICETransport::onRTP(const ICERemoteCandidate* candidate,RTPPacket::shared& packet,const BYTE* data,DWORD len,DWORD size,QWORD now)
+{
 
 	TRACE_EVENT("rtp", "DTLSICETransport::onData::RTP",
 		"ssrc", packet->GetSSRC(),
@@ -209,8 +337,8 @@ int DTLSICETransport::onData(const ICERemoteCandidate* candidate,const BYTE* dat
 		// Get current seq mum
 		WORD transportSeqNum = packet->GetTransportSeqNum();
 
-		//Get max seq num so far, it is either last one if queue is empy or last one of the queue
-		DWORD maxFeedbackPacketExtSeqNum = transportWideReceivedPacketsStats.size() ? transportWideReceivedPacketsStats.rbegin()->first : lastFeedbackPacketExtSeqNum;
+		//Get max seq num so far, either pending or already reported
+		DWORD maxFeedbackPacketExtSeqNum = transportWideReceiveStats.GetMaxExtSeqNum();
 
 		//Check if we have a sequence wrap
 		if (transportSeqNum < 0x00FF && (maxFeedbackPacketExtSeqNum & 0xFFFF)>0xFF00)
@@ -226,15 +354,21 @@ int DTLSICETransport::onData(const ICERemoteCandidate* candidate,const BYTE* dat
 		//Get extended value
 		DWORD transportExtSeqNum = feedbackCycles << 16 | transportSeqNum;
 
-		//Add packets to the transport wide stats
-		transportWideReceivedPacketsStats[transportExtSeqNum] = PacketStats::Create(packet, size, now);
+		//Add packets to the transport wide stats, relative to transport start
+		if (!transportWideReceiveStats.Add(transportExtSeqNum, now - initTime) && transportExtSeqNum>maxFeedbackPacketExtSeqNum)
+		{
+			//Too far ahead of the pending ones, report them first
+			SendTransportWideFeedbackMessage(ssrc);
+			//Add it again
+			transportWideReceiveStats.Add(transportExtSeqNum, now - initTime);
+		}
 
 		//If we have enought or timeout 
-		if (packet->GetMark() || transportWideReceivedPacketsStats.size() > TransportWideCCMaxPackets || (now - transportWideReceivedPacketsStats.begin()->second.time) > TransportWideCCMaxInterval)
+		if (!transportWideReceiveStats.IsEmpty() && (packet->GetMark() || transportWideReceiveStats.GetReceived() > TransportWideCCMaxPackets || (now - initTime - transportWideReceiveStats.GetFirstTime()) > TransportWideCCMaxInterval))
 			//Send feedback message
 			SendTransportWideFeedbackMessage(ssrc);
 		//Schedule for later
-		if (transportWideReceivedPacketsStats.size())
+		if (!transportWideReceiveStats.IsEmpty())
 		{
 			//If timer is still valid and has not been scheduled already
 			if (sseTimer && !sseTimer->IsScheduled())
@@ -260,129 +394,8 @@ int DTLSICETransport::onData(const ICERemoteCandidate* candidate,const BYTE* dat
 
 	//If it doesn't have a group
 	if (!group)
-	{
-		//Get rid
-		auto mid = packet->GetMediaStreamId();
-		auto rid = packet->HasRepairedId() ? packet->GetRepairedId() : packet->GetRId();
-
-		Debug("-DTLSICETransport::onData() | Unknowing group for ssrc trying to retrieve by [ssrc:%u,rid:'%s']\n",ssrc,rid.c_str());
-
-		//If it is the repaidr stream or it has rid and it is rtx
-		if (!rid.empty() && (packet->GetCodec()==VideoCodec::RTX || packet->GetCodec() == AudioCodec::RTX))
-		{
-			//Try to find it on the rids and mids
-			auto it = rids.find(mid+"@"+rid);
-			//If found
-			if (it!=rids.end())
-			{
-				Log("-DTLSICETransport::onData() | Associating rtx stream to ssrc [ssrc:%u,mid:'%s',rid:'%s']\n",ssrc,mid.c_str(),rid.c_str());
-
-				//Got source
-				group = it->second;
-
-				//Check if there was a previous ssrc
-				if (group->rtx.ssrc)
-				{
-					//Remove previous one
-					incoming.erase(group->rtx.ssrc);
-					//Also from srtp session
-					recv.RemoveStream(group->rtx.ssrc);
-				}
-
-				//Set ssrc for next ones
-				group->rtx.ssrc = ssrc;
-
-				//Add it to the incoming list
-				incoming[ssrc] = group;
-				//And to the srtp session
-				recv.AddStream(ssrc);
-			}
-		} else if (packet->HasRId()) {
-			//Try to find it on the rids and mids
-			auto it = rids.find(mid+"@"+rid);
-			//If found
-			if (it!=rids.end())
-			{
-				Log("-DTLSICETransport::onData() | Associating rtp stream to ssrc [ssrc:%u,mid:'%s',rid:'%s']\n",ssrc,mid.c_str(),rid.c_str());
-
-				//Got source
-				group = it->second;
-
-				//Check if there was a previous ssrc
-				if (group->media.ssrc)
-				{
-					//Remove previous one
-					incoming.erase(group->media.ssrc);
-					//Also from srtp session
-					recv.RemoveStream(group->media.ssrc);
-				}
-
-				//Set ssrc for next ones
-				group->media.ssrc = ssrc;
-
-				//Add it to the incoming list
-				incoming[ssrc] = group;
-				//And to the srtp session
-				recv.AddStream(ssrc);
-			}
-		} else if (packet->HasMediaStreamId() && (packet->GetCodec()==VideoCodec::RTX || packet->GetCodec() == AudioCodec::RTX)) {
-			//Try to find it on the rids and mids
-			auto it = mids.find(mid);
-			//If found
-			if (it!=mids.end())
-			{
-				Log("-DTLSICETransport::onData() | Associating rtx stream id to ssrc [ssrc:%u,mid:'%s']\n",ssrc,mid.c_str());
-
-				//Get first source in set, if there was more it should have contained an rid
-				group = *it->second.begin();
-
-				//Check if there was a previous ssrc
-				if (group->rtx.ssrc)
-				{
-					//Remove previous one
-					incoming.erase(group->rtx.ssrc);
-					//Also from srtp session
-					recv.RemoveStream(group->rtx.ssrc);
-				}
-
-				//Set ssrc for next ones
-				group->rtx.ssrc = ssrc;
-
-				//Add it to the incoming list
-				incoming[ssrc] = group;
-				//And to the srtp session
-				recv.AddStream(ssrc);
-			}
-		} else if (packet->HasMediaStreamId()) {
-			//Try to find it on the rids and mids
-			auto it = mids.find(mid);
-			//If found
-			if (it!=mids.end())
-			{
-				Log("-DTLSICETransport::onData() | Associating rtp stream to ssrc [ssrc:%u,mid:'%s']\n",ssrc,mid.c_str());
-
-				//Get first source in set, if there was more it should have contained an rid
-				group = *it->second.begin();
-
-				//Check if there was a previous ssrc
-				if (group->media.ssrc)
-				{
-					//Remove previous one
-					incoming.erase(group->media.ssrc);
-					//Also from srtp session
-					recv.RemoveStream(group->media.ssrc);
-				}
-
-				//Set ssrc for next ones
-				group->media.ssrc = ssrc;
-
-				//Add it to the incoming list
-				incoming[ssrc] = group;
-				//And to the srtp session
-				recv.AddStream(ssrc);
-			}
-		}
-	}
+		//Try to find it by mid and rid
+		group = AssignIncomingSourceGroup(ssrc,packet);
 			
 	//Ensure it has a group
 	if (!group)	
@@ -716,11 +729,12 @@ DWORD DTLSICETransport::SendProbe(const RTPPacket::shared& original)
 				stats.timestamp = now.count();
 				//Add new stat
 				senderSideBandwidthEstimator->SentPacket(stats);
-			}
+			},
+			EventLoop::Priority::Probing
 		);
 	else
 		//Send packet
-		sender->Send(candidate, std::move(buffer));
+		sender->Send(candidate, std::move(buffer), std::nullopt, EventLoop::Priority::Probing);
 	
 	//Update current time after sending
 	now = getTime();
@@ -735,13 +749,21 @@ DWORD DTLSICETransport::SendProbe(const RTPPacket::shared& original)
 	return len;
 }
 
-DWORD DTLSICETransport::SendProbe(RTPOutgoingSourceGroup *group,BYTE padding)
+DWORD DTLSICETransport::SendProbe(RTPOutgoingSourceGroup *group,BYTE padding,BYTE count)
 {
+	//Max number of probes protected together
+	static constexpr BYTE MaxProbes = 32;
+	
 	//Check if we have an active DTLS connection yet
 	if (!send.IsSetup())
 		//Error
 		return Warning("-DTLSICETransport::SendProbe() | Send SRTPSession is not setup\n");
 	
+	//If we don't have an active candidate yet
+	if (!active)
+		//Error
+		return Debug("-DTLSICETransport::SendProbe() | We don't have an active candidate yet\n");
+	
 	//Overrride headers
 	RTPHeader		header;
 	RTPHeaderExtension	extension;
@@ -752,118 +774,285 @@ DWORD DTLSICETransport::SendProbe(RTPOutgoingSourceGroup *group,BYTE padding)
 	//Check which source are we using
 	RTPOutgoingSource& source = rtx ? group->rtx : group->media;
 	
-	//Get extended sequence number
-	DWORD extSeqNum;
-
-	//If it is using rtx (i.e. not firefox)
-	if (rtx)
-	{
-		//Update RTX headers
-		header.ssrc		= source.ssrc;
-		header.payloadType	= sendMaps.apt.GetFirstCodecType();
-		header.sequenceNumber	= extSeqNum = source.NextSeqNum();
-		header.timestamp	= source.lastTimestamp++;
-		//Padding
-		header.padding		= 1;
-	} else {
-		//Update normal headers
-		header.ssrc		= source.ssrc;
-		header.payloadType	= source.lastPayloadType;
-		header.sequenceNumber	= extSeqNum = source.AddGapSeqNum();
-		header.timestamp	= source.lastTimestamp;
-		//Padding
-		header.padding		= 1;
-	}
-	
 	//Get current time
 	auto now = getTime();
-
-	//Add transport wide cc on video
-	if (group->type == MediaFrame::Video && sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::TransportWideCC)!=RTPMap::NotFound)
-	{
-		//Add extension
-		header.extension = true;
-		//Add transport
-		extension.hasTransportWideCC = true;
-		extension.transportSeqNum = ++transportSeqNum;
-	}
 	
-	//If we are using abs send time for sending
-	if (sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::AbsoluteSendTime)!=RTPMap::NotFound)
-	{
-		//Use extension
-		header.extension = true;
-		//Set abs send time
-		extension.hasAbsSentTime = true;
-		extension.absSentTime = now/1000;
-	}
+	//Check extensions to add
+	bool twcc = group->type == MediaFrame::Video && sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::TransportWideCC)!=RTPMap::NotFound;
+	bool abs  = sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::AbsoluteSendTime)!=RTPMap::NotFound;
 	
-	//Pick one packet buffer from the pool
-	Packet buffer = packetPool.pick();
-	BYTE* 	data = buffer.GetData();
-	DWORD	size = buffer.GetCapacity();
-	int	len  = 0;
+	struct Probe
+	{
+		Packet	  buffer {0};
+		RTPHeader header;
+		DWORD	  extSeqNum = 0;
+		DWORD	  transportSeqNum = 0;
+	};
+	//Count is capped, so keep them on the stack, buffers are empty until picked from the pool
+	Probe probes[MaxProbes];
+	SRTPSession::Span spans[MaxProbes];
+	BYTE num = 0;
+	
+	//Serialize all probes first
+	for (BYTE i=0; i<count && i<MaxProbes; ++i)
+	{
+		//Get extended sequence number
+		DWORD extSeqNum;
 
-	//Serialize header
-	int n = header.Serialize(data,size);
+		//If it is using rtx (i.e. not firefox)
+		if (rtx)
+		{
+			//Update RTX headers
+			header.ssrc		= source.ssrc;
+			header.payloadType	= sendMaps.apt.GetFirstCodecType();
+			header.sequenceNumber	= extSeqNum = source.NextSeqNum();
+			header.timestamp	= source.lastTimestamp++;
+			//Padding
+			header.padding		= 1;
+		} else {
+			//Update normal headers
+			header.ssrc		= source.ssrc;
+			header.payloadType	= source.lastPayloadType;
+			header.sequenceNumber	= extSeqNum = source.AddGapSeqNum();
+			header.timestamp	= source.lastTimestamp;
+			//Padding
+			header.padding		= 1;
+		}
 
-	//Comprobamos que quepan
-	if (!n)
-	{
-		//Return packet to pool
-		packetPool.release(std::move(buffer));
-		//Error
-		return Error("-DTLSICETransport::SendProbe() | Error serializing rtp headers\n");
-	}
+		//Add transport wide cc on video
+		if (twcc)
+		{
+			//Add extension
+			header.extension = true;
+			//Add transport
+			extension.hasTransportWideCC = true;
+			extension.transportSeqNum = ++transportSeqNum;
+		}
+		
+		//If we are using abs send time for sending
+		if (abs)
+		{
+			//Use extension
+			header.extension = true;
+			//Set abs send time
+			extension.hasAbsSentTime = true;
+			extension.absSentTime = now/1000;
+		}
+		
+		//Pick one packet buffer from the pool
+		Packet buffer = packetPool.pick();
+		BYTE* 	data = buffer.GetData();
+		DWORD	size = buffer.GetCapacity();
+		int	len  = 0;
 
-	//Inc len
-	len += n;
+		//Serialize header
+		int n = header.Serialize(data,size);
 
-	//If we have extension
-	if (header.extension)
-	{
-		//Serialize
-		n = extension.Serialize(sendMaps.ext,data+len,size-len);
 		//Comprobamos que quepan
 		if (!n)
 		{
 			//Return packet to pool
 			packetPool.release(std::move(buffer));
 			//Error
-			return Error("-DTLSICETransport::SendProbe() | Error serializing rtp extension headers\n");
+			Error("-DTLSICETransport::SendProbe() | Error serializing rtp headers\n");
+			break;
 		}
+
 		//Inc len
 		len += n;
+
+		//If we have extension
+		if (header.extension)
+		{
+			//Serialize
+			n = extension.Serialize(sendMaps.ext,data+len,size-len);
+			//Comprobamos que quepan
+			if (!n)
+			{
+				//Return packet to pool
+				packetPool.release(std::move(buffer));
+				//Error
+				Error("-DTLSICETransport::SendProbe() | Error serializing rtp extension headers\n");
+				break;
+			}
+			//Inc len
+			len += n;
+		}
+
+		//Set 0 padding
+		memset(data+len,0,padding);
+		
+		//Set pateckt length
+		len += padding;
+		
+		//Set padding size in last byte of the padding
+		data[len-1] = padding;
+
+		//If dumping
+		if (dumper && dumpOutRTP)
+		{
+			//Get truncate size
+			DWORD truncate = dumpRTPHeadersOnly ? len - padding : 0;
+			//Write udp packet
+			dumper->WriteUDP(now/1000,0x7F000001,5004,active->GetIPAddress(),active->GetPort(),data,len,truncate);
+		}
+		
+		//Queue for encryption
+		spans[num] = {data, (size_t)len};
+		probes[num].buffer		= std::move(buffer);
+		probes[num].header		= header;
+		probes[num].extSeqNum		= extSeqNum;
+		probes[num].transportSeqNum	= extension.transportSeqNum;
+		num++;
 	}
 
-	//Set 0 padding
-	memset(data+len,0,padding);
+	//Encript all of them together
+	send.ProtectRTP(spans,num);
 	
-	//Set pateckt length
-	len += padding;
+	//Store candidate before unlocking
+	ICERemoteCandidate* candidate = active;
 	
-	//Set padding size in last byte of the padding
-	data[len-1] = padding;
+	DWORD sent = 0;
+	
+	for (BYTE i=0; i<num; ++i)
+	{
+		auto& probe = probes[i];
+		DWORD len = spans[i].size;
+		
+		//Check size
+		if (!len)
+		{
+			//Return packet to pool
+			packetPool.release(std::move(probe.buffer));
+			//Error
+			Error("-RTPTransport::SendProbe() | Error protecting RTP packet [ssrc:%u,%s]\n",source.ssrc,send.GetLastError());
+			continue;
+		}
+
+		//Set buffer size
+		probe.buffer.SetSize(len);
+
+		if(twcc && senderSideEstimationEnabled)
+			//Send packet and update stats in callback
+			sender->Send(candidate, std::move(probe.buffer),[
+				weak = std::weak_ptr<SendSideBandwidthEstimation>(senderSideBandwidthEstimator),
+				stats = PacketStats::CreateProbing(
+					probe.transportSeqNum,
+					probe.header.ssrc,
+					probe.extSeqNum,
+					len,
+					0,
+					probe.header.timestamp,
+					now,
+					false
+				)](std::chrono::milliseconds now) mutable {
+					//Get shared pointer from weak reference
+					auto senderSideBandwidthEstimator = weak.lock();
+					//If already gone
+					if (!senderSideBandwidthEstimator)
+						//Ignore
+						return;
+					//Update sent timestamp
+					stats.timestamp = now.count();
+					//Add new stat
+					senderSideBandwidthEstimator->SentPacket(stats);
+				},
+				EventLoop::Priority::Probing
+			);
+		else
+			//Send packet
+			sender->Send(candidate, std::move(probe.buffer), std::nullopt, EventLoop::Priority::Probing);
+		
+		//Update bitrate
+		outgoingBitrate.Update(now/1000,len);
+		
+		//Update last send time and stats
+		source.Update(now/1000, probe.header, len);
+		
+		sent += len;
+	}
+
+	return sent;
+}
 
+void DTLSICETransport::ReSendSerializedPacket(RTPOutgoingSourceGroup *group,WORD seq,const RTPOutgoingSourceGroup::SerializedPacket& serialized,QWORD now)
+{
 	//If we don't have an active candidate yet
 	if (!active)
+		//Error
+		return (void)Warning("-DTLSICETransport::ReSendSerializedPacket() | We don't have an active candidate yet\n");
+	
+	//Try to send it via rtx
+	BYTE apt = sendMaps.apt.GetTypeForCodec(serialized.data[1] & 0x7F);
+		
+	//Check if we ar using rtx or not
+	bool rtx = group->rtx.ssrc && apt!=RTPMap::NotFound;
+		
+	//Check which source are we using
+	RTPOutgoingSource& source = rtx ? group->rtx : group->media;
+	
+	//Pick one packet buffer from the pool
+	Packet buffer = packetPool.pick();
+	BYTE* 	data = buffer.GetData();
+	DWORD	len = serialized.size + (rtx ? 2 : 0);
+	
+	//Check size
+	if (len > buffer.GetCapacity())
 	{
 		//Return packet to pool
 		packetPool.release(std::move(buffer));
-		//Error
-		return Debug("-DTLSICETransport::SendProbe() | We don't have an active candidate yet\n");
+		//Log warnign and exit
+		return (void)Warning("-DTLSICETransport::ReSendSerializedPacket() | Packet too big\n");
 	}
-
+	
+	DWORD extSeqNum = serialized.extSeqNum;
+	
+	//If it is using rtx (i.e. not firefox)
+	if (rtx)
+	{
+		//Copy headers
+		memcpy(data,serialized.data,serialized.headerSize);
+		//Original seq num goes before payload
+		set2(data,serialized.headerSize,seq);
+		//Copy payload
+		memcpy(data+serialized.headerSize+2,serialized.data+serialized.headerSize,serialized.size-serialized.headerSize);
+		//Update RTX headers
+		extSeqNum = source.NextSeqNum();
+		data[1] = (data[1] & 0x80) | apt;
+		set2(data,2,extSeqNum);
+		set4(data,8,source.ssrc);
+	} else {
+		//Copy as it is
+		memcpy(data,serialized.data,serialized.size);
+	}
+	
+	//Update transport wide seq num
+	WORD transportWideSeqNum = 0;
+	if (serialized.transportSeqNumOffset)
+		set2(data,serialized.transportSeqNumOffset,transportWideSeqNum = ++transportSeqNum);
+	
+	//Set abs send time, same as RTPHeaderExtension::Serialize
+	if (serialized.absSentTimeOffset)
+		set3(data,serialized.absSentTimeOffset,(((now/1000) << 18) / 1000));
+	
+	//Get header values for stats
+	RTPHeader header;
+	header.mark		= data[1] & 0x80;
+	header.payloadType	= data[1] & 0x7F;
+	header.sequenceNumber	= get2(data,2);
+	header.timestamp	= get4(data,4);
+	header.ssrc		= source.ssrc;
+	
 	//If dumping
 	if (dumper && dumpOutRTP)
 	{
 		//Get truncate size
-		DWORD truncate = dumpRTPHeadersOnly ? len - padding : 0;
+		DWORD truncate = dumpRTPHeadersOnly ? len - serialized.mediaLength + 16 : 0;
 		//Write udp packet
 		dumper->WriteUDP(now/1000,0x7F000001,5004,active->GetIPAddress(),active->GetPort(),data,len,truncate);
 	}
-
-	//Encript
+	
+	//Encript, not batched as the rtx bitrate checks need the size of the previous retransmissions
 	len = send.ProtectRTP(data,len);
 		
 	//Check size
@@ -872,28 +1061,22 @@ DWORD DTLSICETransport::SendProbe(RTPOutgoingSourceGroup *group,BYTE padding)
 		//Return packet to pool
 		packetPool.release(std::move(buffer));
 		//Error
-		return Error("-RTPTransport::SendProbe() | Error protecting RTP packet [ssrc:%u,%s]\n",source.ssrc,send.GetLastError());
+		return (void)Error("-RTPTransport::ReSendSerializedPacket() | Error protecting RTP packet [ssrc:%u,%s]\n",source.ssrc,send.GetLastError());
 	}
-
+	
 	//Store candidate before unlocking
 	ICERemoteCandidate* candidate = active;
+
 	//Set buffer size
 	buffer.SetSize(len);
 
-	if(extension.hasTransportWideCC && senderSideEstimationEnabled)
+	//Check if we are using transport wide for this packet
+	if (serialized.transportSeqNumOffset && senderSideEstimationEnabled)
 		//Send packet and update stats in callback
-		sender->Send(candidate, std::move(buffer),[
+		sender->Send(candidate, std::move(buffer), [
 			weak = std::weak_ptr<SendSideBandwidthEstimation>(senderSideBandwidthEstimator),
-			stats = PacketStats::CreateProbing(
-				extension.transportSeqNum,
-				header.ssrc,
-				extSeqNum,
-				len,
-				0,
-				header.timestamp,
-				now,
-				false
-			)](std::chrono::milliseconds now) mutable {
+				stats = PacketStats::CreateRTX(transportWideSeqNum, source.ssrc, extSeqNum, len, serialized.mediaLength, header.timestamp, now, header.mark)
+				](std::chrono::milliseconds now) mutable {
 				//Get shared pointer from weak reference
 				auto senderSideBandwidthEstimator = weak.lock();
 				//If already gone
@@ -904,21 +1087,25 @@ DWORD DTLSICETransport::SendProbe(RTPOutgoingSourceGroup *group,BYTE padding)
 				stats.timestamp = now.count();
 				//Add new stat
 				senderSideBandwidthEstimator->SentPacket(stats);
-			}
+			},
+			EventLoop::Priority::Retransmission
 		);
 	else
 		//Send packet
-		sender->Send(candidate,std::move(buffer));
-	
-	//Update now
+		sender->Send(candidate, std::move(buffer), std::nullopt, EventLoop::Priority::Retransmission);
+
+	//Update current time after sending
 	now = getTime();
 	//Update bitrate
 	outgoingBitrate.Update(now/1000,len);
+	rtxBitrate.Update(now/1000,len);
 	
-	//Update last send time and stats
+	//Update stats
+	source.clockrate = serialized.clockRate;
 	source.Update(now/1000, header, len);
 
-	return len;
+	//Update rtx time
+	group->SetRTXTime(seq, now/1000);
 }
 
 void DTLSICETransport::ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq)
@@ -964,6 +1151,17 @@ void DTLSICETransport::ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq)
 		//Debug
 		return (void)UltraDebug("-DTLSICETransport::ReSendPacket() | rtx not allowed for packet [seq:%d,ssrc:%u,rtx:%u]\n", seq, group->media.ssrc, group->rtx.ssrc);
 	
+	//If we have the serialized packet
+	if (auto serialized = group->GetSerializedPacket(seq))
+	{
+		//Check the extensions to update are the same ones than when it was sent
+		bool transportWideCC = group->type == MediaFrame::Video && sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::TransportWideCC)!=RTPMap::NotFound;
+		bool absSentTime = sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::AbsoluteSendTime)!=RTPMap::NotFound;
+		//Resend it without serializing the packet again
+		if (transportWideCC==(bool)serialized->transportSeqNumOffset && absSentTime==(bool)serialized->absSentTimeOffset)
+			return ReSendSerializedPacket(group,seq,*serialized,now);
+	}
+	
 	//Find packet to retransmit
 	auto original = group->GetPacket(seq);
 
@@ -1061,7 +1259,7 @@ void DTLSICETransport::ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq)
 		dumper->WriteUDP(now/1000,0x7F000001,5004,active->GetIPAddress(),active->GetPort(),data,len,truncate);
 	}
 		
-	//Encript
+	//Encript, not batched as the rtx bitrate checks need the size of the previous retransmissions
 	len = send.ProtectRTP(data,len);
 		
 	//Check size
@@ -1096,11 +1294,12 @@ void DTLSICETransport::ReSendPacket(RTPOutgoingSourceGroup *group,WORD seq)
 				stats.timestamp = now.count();
 				//Add new stat
 				senderSideBandwidthEstimator->SentPacket(stats);
-			}
+			},
+			EventLoop::Priority::Retransmission
 		);
 	else
 		//Send packet
-		sender->Send(candidate, std::move(buffer));
+		sender->Send(candidate, std::move(buffer), std::nullopt, EventLoop::Priority::Retransmission);
 
 	
 	//Update current time after sending
@@ -1654,6 +1853,10 @@ bool DTLSICETransport::AddOutgoingSourceGroup(const RTPOutgoingSourceGroup::shar
 	//Log
 	Log("-DTLSICETransport::AddOutgoingSourceGroup() [group:%p,ssrc:%u,rtx:%u]\n",group.get(), group->media.ssrc, group->rtx.ssrc);
 	
+	//Enable serialized rtx cache if configured
+	if (rtxSerializedCacheSize)
+		group->SetSerializedCacheSize(rtxSerializedCacheSize);
+	
 	//Dispatch to the event loop thread
 	timeService.Async([=](auto now){
 
@@ -1663,14 +1866,14 @@ bool DTLSICETransport::AddOutgoingSourceGroup(const RTPOutgoingSourceGroup::shar
 
 		//TODO: pass a callback for confirming creation
 		//Check they are not already assigned
-		if (media && outgoing.find(media) != outgoing.end())
+		if (media && outgoing.find(media))
 		{
 			//Error
 			Error("-DTLSICETransport::AddOutgoingSourceGroup() | media ssrc already assigned");
 			return;
 		}
 
-		if (rtx && outgoing.find(rtx) != outgoing.end())
+		if (rtx && outgoing.find(rtx))
 		{
 			//Error
 			Error("-DTLSICETransport::AddOutgoingSourceGroup() | rtx ssrc already assigned");
@@ -1739,10 +1942,13 @@ bool DTLSICETransport::RemoveOutgoingSourceGroup(const RTPOutgoingSourceGroup::s
 			history.clear();
 		}
 		
+		//Drop paced packets not sent yet
+		pacer.Remove(media);
+		
 		//If it was our main ssrc
 		if (mainSSRC==group->media.ssrc)
 			//Set first
-			mainSSRC = outgoing.begin()!=outgoing.end() ? outgoing.begin()->second->media.ssrc : 1;
+			mainSSRC = !outgoing.empty() ? outgoing.begin()->second->media.ssrc : 1;
 		
 		//Send BYE
 		Send(RTCPCompoundPacket::Create(RTCPBye::Create(ssrcs,"terminated")));
@@ -1780,7 +1986,7 @@ bool DTLSICETransport::AddIncomingSourceGroup(const RTPIncomingSourceGroup::shar
 		const auto rtx   = group->rtx.ssrc;
 		
 		//Check they are not already assigned
-		if (media && incoming.find(media)!=incoming.end())
+		if (media && incoming.find(media))
 		{
 			//Error
 			Warning("-DTLSICETransport::AddIncomingSourceGroup() media ssrc already assigned\n");
@@ -1788,7 +1994,7 @@ bool DTLSICETransport::AddIncomingSourceGroup(const RTPIncomingSourceGroup::shar
 		}
 		
 			
-		if (rtx && incoming.find(rtx)!=incoming.end())
+		if (rtx && incoming.find(rtx))
 		{
 			//Error
 			Warning("-DTLSICETransport::AddIncomingSourceGroup() rtx ssrc already assigned\n");
@@ -1797,7 +2003,7 @@ bool DTLSICETransport::AddIncomingSourceGroup(const RTPIncomingSourceGroup::shar
 
 		//Add rid if any
 		if (!group->rid.empty())
-			rids[group->mid + "@" + group->rid] = group.get();
+			rids[{group->mid,group->rid}] = group.get();
 
 		//Add mid if any
 		if (!group->mid.empty())
@@ -1849,7 +2055,7 @@ bool DTLSICETransport::RemoveIncomingSourceGroup(const RTPIncomingSourceGroup::s
 
 		//Remove rid if any
 		if (!group->rid.empty())
-			rids.erase(group->mid + "@" + group->rid);
+			rids.erase({group->mid,group->rid});
 
 		//Find mid 
 		auto it = mids.find(group->mid);
@@ -1926,6 +2132,24 @@ int DTLSICETransport::Send(const RTCPCompoundPacket::shared &rtcp)
 		//Error
 		return Error("-DTLSICETransport::Send() | Error serializing RTCP packet [len:%d,size:%d]\n",len,size);
 	}
+
+	//Send serialized packet
+	return Send(std::move(buffer), len);
+}
+
+int DTLSICETransport::Send(Packet&& buffer, DWORD len)
+{
+	//Check if we have an active DTLS connection yet
+	if (!send.IsSetup())
+	{
+		//Return packet to pool
+		packetPool.release(std::move(buffer));
+		//Log 
+		return Debug("-DTLSICETransport::Send() | We don't have an DTLS setup yet\n");
+	}
+
+	//Get data
+	BYTE* data = buffer.GetData();
 	
 	//If we don't have an active candidate yet
 	if (!active)
@@ -2135,8 +2359,21 @@ int DTLSICETransport::Send(const RTPPacket::shared& packet)
 	BYTE* 	data = buffer.GetData();
 	DWORD	size = buffer.GetCapacity();
 	
-	//Serialize data
-	int len = packet->Serialize(data,size,sendMaps.ext);
+	int len = 0;
+	
+	//If it has the same header than the previous one sent on the group
+	if (headerTemplatesEnabled && group->headerTemplate.Matches(*packet,sendMaps.ext))
+	{
+		//Patch the header and copy payload
+		len = group->headerTemplate.Serialize(*packet,data,size);
+	} else {
+		//Serialize data
+		len = packet->Serialize(data,size,sendMaps.ext);
+		
+		//Keep header for next ones
+		if (headerTemplatesEnabled && len)
+			group->headerTemplate.Set(*packet,sendMaps.ext,data,len);
+	}
 	
 	//IF failed
 	if (!len)
@@ -2150,6 +2387,9 @@ int DTLSICETransport::Send(const RTPPacket::shared& packet)
 	//Add packet for RTX
 	group->AddPacket(packet);
 	
+	//Keep serialized copy too, if enabled on the group
+	group->AddSerializedPacket(packet,data,len,sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::TransportWideCC),sendMaps.ext.GetTypeForCodec(RTPHeaderExtension::AbsoluteSendTime));
+	
 	//If we don't have an active candidate yet
 	if (!active)
 	{
@@ -2168,7 +2408,7 @@ int DTLSICETransport::Send(const RTPPacket::shared& packet)
 		dumper->WriteUDP(now/1000,0x7F000001,5004,active->GetIPAddress(),active->GetPort(),data,len,truncate);
 	}
 
-	//Encript
+	//Encript, not batched like probes as the SR and inline probes sent after this packet take seq nums that must go before the next one
 	len = send.ProtectRTP(data,len);
 	
 	//Check error
@@ -2186,6 +2426,9 @@ int DTLSICETransport::Send(const RTPPacket::shared& packet)
 	//Set buffer size
 	buffer.SetSize(len);
 
+	//Audio goes ahead of video when sending queue is congested
+	EventLoop::Priority priority = packet->GetMediaType()==MediaFrame::Audio ? EventLoop::Priority::Audio : EventLoop::Priority::Video;
+
 	//Check if we are using transport wide for this packet
 	if (packet->HasTransportWideCC() && senderSideEstimationEnabled)
 		//Send packet and update stats in callback
@@ -2203,11 +2446,12 @@ int DTLSICETransport::Send(const RTPPacket::shared& packet)
 				stats.timestamp = now.count();
 				//Add new stat
 				senderSideBandwidthEstimator->SentPacket(stats);
-			}
+			},
+			priority
 		);
 	else
 		//Send packet
-		sender->Send(candidate, std::move(buffer));
+		sender->Send(candidate, std::move(buffer), std::nullopt, priority);
 
 	//Get time
 	now = getTime();
@@ -2246,10 +2490,8 @@ int DTLSICETransport::Send(const RTPPacket::shared& packet)
 
 		//UltraDebug("-DTLSICETransport::Run() | Sending inband probing packets [at:%u,estimated:%u,bitrate:%u,probing:%u,max:%u,num:%d]\n", packet->GetSeqNum(), estimated, bitrate,probingBitrate,maxProbingBitrate, num, sleep);
 
-		//Set all the probes
-		for (BYTE i=0;i<num;++i)
-			//Send probe packet
-			SendProbe(group,size);
+		//Send all the probes at once
+		SendProbe(group,size,num);
 	}
 	
 	//If packets supports rtx
@@ -2581,12 +2823,12 @@ RTPIncomingSourceGroup* DTLSICETransport::GetIncomingSourceGroup(DWORD ssrc)
 	auto it = incoming.find(ssrc);
 				
 	//If not found
-	if (it==incoming.end())
+	if (!it)
 		//Not found
 		return NULL;
 	
 	//Get source froup
-	return it->second;
+	return *it;
 }
 
 RTPIncomingSource* DTLSICETransport::GetIncomingSource(DWORD ssrc)
@@ -2595,12 +2837,12 @@ RTPIncomingSource* DTLSICETransport::GetIncomingSource(DWORD ssrc)
 	auto it = incoming.find(ssrc);
 				
 	//If not found
-	if (it==incoming.end())
+	if (!it)
 		//Not found
 		return NULL;
 	
 	//Get source
-	return it->second->GetSource(ssrc);
+	return (*it)->GetSource(ssrc);
 
 }
 
@@ -2610,12 +2852,12 @@ RTPOutgoingSourceGroup* DTLSICETransport::GetOutgoingSourceGroup(DWORD ssrc)
 	auto it = outgoing.find(ssrc);
 				
 	//If not found
-	if (it==outgoing.end())
+	if (!it)
 		//Not found
 		return NULL;
 	
 	//Get source froup
-	return it->second;
+	return *it;
 
 }
 
@@ -2625,12 +2867,74 @@ RTPOutgoingSource* DTLSICETransport::GetOutgoingSource(DWORD ssrc)
 	auto it = outgoing.find(ssrc);
 				
 	//If not found
-	if (it==outgoing.end())
+	if (!it)
 		//Not found
 		return NULL;
 	
 	//Get source
-	return it->second->GetSource(ssrc);
+	return (*it)->GetSource(ssrc);
+}
+
+RTPIncomingSourceGroup* DTLSICETransport::AssignIncomingSourceGroup(DWORD ssrc,const RTPPacket::shared& packet)
+{
+	//Get mid and rid
+	auto mid = packet->GetMediaStreamId();
+	auto rid = packet->HasRepairedId() ? packet->GetRepairedId() : packet->GetRId();
+	//Check if it is the repair stream
+	bool rtx = packet->GetCodec()==VideoCodec::RTX || packet->GetCodec()==AudioCodec::RTX;
+
+	Debug("-DTLSICETransport::AssignIncomingSourceGroup() | Unknowing group for ssrc trying to retrieve by [ssrc:%u,rid:'%s']\n",ssrc,rid.c_str());
+
+	RTPIncomingSourceGroup* group = nullptr;
+
+	//If it has rid and it is rtx or it is the media stream with rid
+	if ((!rid.empty() && rtx) || packet->HasRId())
+	{
+		//Media stream is only identified by its rid
+		rtx = rtx && !rid.empty();
+		//Try to find it on the rids
+		auto it = rids.find({mid,rid});
+		//If found
+		if (it!=rids.end())
+			//Got source
+			group = it->second;
+	} else if (packet->HasMediaStreamId()) {
+		//Try to find it on the mids
+		auto it = mids.find(mid);
+		//If found
+		if (it!=mids.end())
+			//Get first source in set, if there was more it should have contained an rid
+			group = *it->second.begin();
+	}
+
+	//If not found
+	if (!group)
+		//Nothing to assign
+		return nullptr;
+
+	Log("-DTLSICETransport::AssignIncomingSourceGroup() | Associating %s stream to ssrc [ssrc:%u,mid:'%s',rid:'%s']\n",rtx ? "rtx" : "rtp",ssrc,mid.c_str(),rid.c_str());
+
+	//Get source for the ssrc
+	RTPIncomingSource& source = rtx ? group->rtx : group->media;
+
+	//Check if there was a previous ssrc
+	if (source.ssrc)
+	{
+		//Remove previous one
+		incoming.erase(source.ssrc);
+		//Also from srtp session
+		recv.RemoveStream(source.ssrc);
+	}
+
+	//Set ssrc for next ones
+	source.ssrc = ssrc;
+
+	//Add it to the incoming list
+	incoming[ssrc] = group;
+	//And to the srtp session
+	recv.AddStream(ssrc);
+
+	return group;
 }
 
 void DTLSICETransport::SetRTT(DWORD rtt, QWORD now)
@@ -2653,43 +2957,41 @@ void DTLSICETransport::SendTransportWideFeedbackMessage(DWORD ssrc)
 {
 	//Debug
 	//UltraDebug("-DTLSICETransport::SendTransportWideFeedbackMessage() [ssrc:%d]\n", ssrc);
-	//RTCP packet
-	auto rtcp = RTCPCompoundPacket::Create();
 
-	//Create rtcp transport wide feedback
-	auto feedback = rtcp->CreatePacket<RTCPRTPFeedback>(RTCPRTPFeedback::TransportWideFeedbackMessage,mainSSRC,ssrc);
+	//Until all pending packets are reported, usually only once
+	while (!transportWideReceiveStats.IsEmpty())
+	{
+		//Pick one packet buffer from the pool
+		Packet buffer = packetPool.pick();
+		BYTE* 	data = buffer.GetData();
+		DWORD	size = buffer.GetCapacity();
+
+		//Encode feedback after rtcp header and ssrcs, keeping room for the srtcp trailer
+		DWORD len = transportWideReceiveStats.Serialize(++feedbackPacketCount, data + 12, size - 12 - SRTCPTrailerSize);
 
-	//Create trnasport field
-	auto field = feedback->CreateField<RTCPRTPFeedback::TransportWideFeedbackMessageField>(++feedbackPacketCount);
+		//Check result
+		if (!len)
+		{
+			//Return packet to pool
+			packetPool.release(std::move(buffer));
+			//Error
+			return (void)Error("-DTLSICETransport::SendTransportWideFeedbackMessage() | Error serializing transport wide feedback\n");
+		}
 
-	//Proccess and delete all elements
-	for (auto it =transportWideReceivedPacketsStats.cbegin();
-		  it!=transportWideReceivedPacketsStats.cend();
-		  it = transportWideReceivedPacketsStats.erase(it))
-	{
-		//Get stat
-		auto& stats = it->second;
-		//Get transport seq
-		DWORD transportExtSeqNum = it->first;
-		//Get relative time
-		QWORD time = stats.time - initTime;
-
-		//if not first and not out of order
-		if (lastFeedbackPacketExtSeqNum && transportExtSeqNum>lastFeedbackPacketExtSeqNum)
-			//For each lost
-			for (DWORD i = lastFeedbackPacketExtSeqNum+1; i<transportExtSeqNum; ++i)
-				//Add it
-				field->packets.insert(std::make_pair(i,0));
-
-		//Store last
-		lastFeedbackPacketExtSeqNum = transportExtSeqNum;
-
-		//Add this one
-		field->packets.insert(std::make_pair(transportExtSeqNum,time));
-	}
+		//RTCP transport wide feedback header
+		RTCPCommonHeader header;
+		header.count	  = RTCPRTPFeedback::TransportWideFeedbackMessage;
+		header.packetType = RTCPPacket::RTPFeedback;
+		header.padding	  = 0;
+		header.length	  = len + 12;
+		header.Serialize(data, size);
+		//Set ssrcs
+		set4(data, 4, mainSSRC);
+		set4(data, 8, ssrc);
 
-	//Send packet
-	Send(rtcp);
+		//Send packet
+		Send(std::move(buffer), len + 12);
+	}
 }
 
 void DTLSICETransport::Start()
@@ -2730,6 +3032,13 @@ void DTLSICETransport::Start()
 	});
 	//Set name for debug
 	sseTimer->SetName("DTLSICETransport - twcc feedback");
+	//Create pacer timer
+	pacerTimer = timeService.CreateTimer([this](std::chrono::milliseconds ms) {
+		//Send queued packets, with microsecond precision
+		Pace(getTime());
+	});
+	//Set name for debug
+	pacerTimer->SetName("DTLSICETransport - pacer");
 	//Start
 	endpoint.Init(dcOptions);
 	//Started
@@ -2762,6 +3071,17 @@ void DTLSICETransport::Stop()
 		//Remove timer
 		sseTimer.reset();
 	}
+
+	//Check pacer timer
+	if (pacerTimer)
+	{
+		//Stop pacing
+		pacerTimer->Cancel();
+		//Remove timer
+		pacerTimer.reset();
+	}
+	//Drop queued packets
+	pacer.Clear();
 	
 	//Check ice timeout timer
 	if (iceTimeoutTimer)
@@ -2794,6 +3114,17 @@ int DTLSICETransport::Enqueue(const RTPPacket::shared& packet)
 		"ssrc", packet->GetSSRC(),
 		"seqNum", packet->GetSeqNum());
 
+	//If pacing
+	if (pacingEnabled && pacerTimer)
+	{
+		//Get time
+		QWORD now = getTime();
+		//Queue it on the group and send what the budget allows
+		pacer.Enqueue(packet->GetSSRC(), packet, now);
+		Pace(now);
+		return 1;
+	}
+
 	//TODO: check if we are actuall sending from a different thread ocasionally
 	//Send async
 	//timeService.Async([=](auto now){
@@ -2804,6 +3135,23 @@ int DTLSICETransport::Enqueue(const RTPPacket::shared& packet)
 	return 1;
 }
 
+void DTLSICETransport::Pace(QWORD now)
+{
+	TRACE_EVENT("transport", "DTLSICETransport::Pace", "now", now);
+
+	//Pace at the bwe target if enabled, otherwise just keep the queue order
+	pacer.SetTargetBitrate(senderSideEstimationEnabled ? senderSideBandwidthEstimator->GetTargetBitrate() : 0);
+
+	//Send all packets allowed by the budget
+	while (auto packet = pacer.Dequeue(now))
+		Send(packet);
+
+	//If there are still packets queued
+	if (!pacer.IsEmpty() && pacerTimer)
+		//Wake up when next one can be sent
+		pacerTimer->AgainMicroseconds(std::chrono::microseconds(pacer.GetNextSendTime(now) - now));
+}
+
 void DTLSICETransport::Probe(QWORD now)
 {
 	TRACE_EVENT("transport", "DTLSICETransport::Probe", "now", now);
@@ -2976,6 +3324,61 @@ void DTLSICETransport::DisableREMB(bool disabled)
 	Debug("-DTLSICETransport::DisableREMB() [disabled:%d]\n", disabled);
 	this->disableREMB = disabled;
 }
+void DTLSICETransport::SetRTXSerializedCacheSize(WORD size)
+{
+	//Log
+	Debug("-DTLSICETransport::SetRTXSerializedCacheSize() [size:%u]\n", size);
+	this->rtxSerializedCacheSize = size;
+}
+void DTLSICETransport::EnableHeaderTemplates(bool enabled)
+{
+	//Log
+	Debug("-DTLSICETransport::EnableHeaderTemplates() [enabled:%d]\n", enabled);
+
+	//Dispatch to the event loop thread
+	timeService.Async([=](auto now) {
+		//If disabling
+		if (!enabled)
+			//Drop current templates
+			for (auto& [ssrc, group] : outgoing)
+				group->headerTemplate.Reset();
+		//Set it
+		headerTemplatesEnabled = enabled;
+	});
+}
+void DTLSICETransport::EnablePacing(bool enabled)
+{
+	//Log
+	Debug("-DTLSICETransport::EnablePacing() [enabled:%d]\n", enabled);
+
+	//Dispatch to the event loop thread
+	timeService.Async([=](auto now) {
+		//Update flag
+		pacingEnabled = enabled;
+		//If disabled, flush everything still queued
+		if (!enabled)
+		{
+			//Stop timer
+			if (pacerTimer)
+				pacerTimer->Cancel();
+			//Send all pending packets unpaced
+			pacer.SetTargetBitrate(0);
+			while (auto packet = pacer.Dequeue(getTime()))
+				Send(packet);
+		}
+	});
+}
+
+Pacer::Stats DTLSICETransport::GetPacerStats()
+{
+	Pacer::Stats stats;
+	//Get them from the event loop thread
+	timeService.Sync([&](auto now) {
+		stats = pacer.GetStats(getTime());
+	});
+	return stats;
+}
+
 void DTLSICETransport::SetMaxProbingBitrate(DWORD bitrate)
 {
 	//Log
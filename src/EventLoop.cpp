@@ -3,6 +3,7 @@
 
 #include <sys/socket.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/poll.h>
@@ -14,11 +15,34 @@
 #include <sched.h>
 #include <pthread.h>
 #include <cmath>
+#include <algorithm>
+#include <limits>
 
 #include "log.h"
+#include "rtp/RTPPacket.h"
 
 const size_t EventLoop::MaxSendingQueueSize = 64*1024;
+const size_t EventLoop::MaxFlowSendingQueueSize = 4*1024;
+const size_t EventLoop::SendingQuantum = 16*1024;
 const size_t EventLoop::PacketPoolSize = 1024;
+const size_t EventLoop::MaxSegmentationOffloadSegments = 64;
+const size_t EventLoop::MaxSegmentationOffloadSize = 65507;
+const size_t EventLoop::MaxReceiveBatchSize = 1024;
+const size_t EventLoop::MaxReceiveOffloadSize = 65535;
+
+static std::chrono::microseconds GetClockNow()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch());
+}
+
+static inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#endif
+}
 
 
 #if __APPLE__
@@ -51,6 +75,7 @@ struct mmsghdr
 #else
 #include <linux/errqueue.h>
 #include <sys/eventfd.h>
+#include <sys/epoll.h>
 
 const size_t EventLoop::MaxMultipleSendingMessages = 128;
 const size_t EventLoop::MaxMultipleReceivingMessages = 128;
@@ -76,8 +101,195 @@ void free_cpu_set(cpu_set_t* s) {
 }
 #endif
 
+class EventLoop::PollPoller : public EventLoop::Poller
+{
+public:
+	virtual bool Add(int fd) override
+	{
+		//Check it is not already there
+		if (Find(fd)!=ufds.end())
+			return false;
+		//Wait for read events by default
+		ufds.push_back({fd, POLLIN | POLLERR | POLLHUP, 0});
+		return true;
+	}
+
+	virtual bool SetWritable(int fd, bool writable) override
+	{
+		auto it = Find(fd);
+		//If not found
+		if (it==ufds.end())
+			return false;
+		//Set to wait also for write events
+		it->events = writable ? POLLIN | POLLOUT | POLLERR | POLLHUP : POLLIN | POLLERR | POLLHUP;
+		return true;
+	}
+
+	virtual bool Remove(int fd) override
+	{
+		auto it = Find(fd);
+		//If not found
+		if (it==ufds.end())
+			return false;
+		//Remove it
+		ufds.erase(it);
+		return true;
+	}
+
+	virtual int Wait(const std::chrono::microseconds& timeout, std::vector<Ready>& ready) override
+	{
+		//Clear previous events
+		ready.clear();
+
+		//Wait for events
+#ifdef __linux__
+		timespec ts = { (time_t)(timeout.count() / 1000000), (long)(timeout.count() % 1000000) * 1000 };
+		int num = ppoll(ufds.data(), ufds.size(), &ts, nullptr);
+#else
+		int num = poll(ufds.data(), ufds.size(), std::chrono::ceil<std::chrono::milliseconds>(timeout).count());
+#endif
+
+		//For each fd
+		for (auto it = ufds.begin(); num>0 && it!=ufds.end(); ++it)
+		{
+			//Skip if nothing happened
+			if (!it->revents)
+				continue;
+			//Convert events
+			uint32_t events = 0;
+			if (it->revents & POLLIN)			events |= Readable;
+			if (it->revents & POLLOUT)			events |= Writable;
+			if (it->revents & (POLLERR | POLLHUP | POLLNVAL))	events |= Error;
+			//Add it
+			ready.push_back({it->fd, events});
+			//Clear readed events
+			it->revents = 0;
+		}
+		return num;
+	}
+private:
+	std::vector<pollfd>::iterator Find(int fd)
+	{
+		return std::find_if(ufds.begin(), ufds.end(), [fd](const pollfd& ufd) { return ufd.fd==fd; });
+	}
+private:
+	std::vector<pollfd> ufds;
+};
+
+#ifdef __linux__
+class EventLoop::EpollPoller : public EventLoop::Poller
+{
+public:
+	EpollPoller() :
+		epfd(epoll_create1(EPOLL_CLOEXEC))
+	{
+	}
+
+	virtual ~EpollPoller()
+	{
+		if (epfd!=FD_INVALID)
+			close(epfd);
+	}
+
+	bool IsValid() const { return epfd!=FD_INVALID; }
+
+	virtual bool Add(int fd) override
+	{
+		epoll_event event = {};
+		//Wait for read events by default, errors and hangups are always reported
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		return !epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event);
+	}
+
+	virtual bool SetWritable(int fd, bool writable) override
+	{
+		epoll_event event = {};
+		//Set to wait also for write events
+		event.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+		event.data.fd = fd;
+		return !epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &event);
+	}
+
+	virtual bool Remove(int fd) override
+	{
+		return !epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+
+	virtual int Wait(const std::chrono::microseconds& timeout, std::vector<Ready>& ready) override
+	{
+		//Clear previous events
+		ready.clear();
+
+		//Wait for events
+		int num = -1;
+#if defined(__GLIBC_PREREQ) && __GLIBC_PREREQ(2,35)
+		//Use precise timeout if kernel supports it
+		if (precise)
+		{
+			timespec ts = { (time_t)(timeout.count() / 1000000), (long)(timeout.count() % 1000000) * 1000 };
+			num = epoll_pwait2(epfd, events, MaxEvents, &ts, nullptr);
+			//Not supported by kernel
+			if (num==-1 && errno==ENOSYS)
+				precise = false;
+		}
+		if (!precise)
+#endif
+			num = epoll_wait(epfd, events, MaxEvents, std::chrono::ceil<std::chrono::milliseconds>(timeout).count());
+
+		//For each event
+		for (int i = 0; i < num; ++i)
+		{
+			//Convert events
+			uint32_t flags = 0;
+			if (events[i].events & EPOLLIN)			flags |= Readable;
+			if (events[i].events & EPOLLOUT)		flags |= Writable;
+			if (events[i].events & (EPOLLERR | EPOLLHUP))	flags |= Error;
+			//Add it
+			ready.push_back({events[i].data.fd, flags});
+		}
+		return num;
+	}
+private:
+	static constexpr int MaxEvents = 256;
+	int epfd;
+	bool precise = true;
+	epoll_event events[MaxEvents];
+};
+#endif
+
+struct EventLoop::ReceiveBuffers
+{
+	ReceiveBuffers(size_t batchSize, bool offload) :
+		batchSize(batchSize),
+		offload(offload),
+		bufferSize(offload ? MaxReceiveOffloadSize : MTU),
+		//Not initialized so untouched pages are not commited, only used when receiving coalesced datagrams
+		datas(offload ? new uint8_t[batchSize * bufferSize] : nullptr),
+		datagrams(offload ? 0 : batchSize),
+		messages(batchSize),
+		froms(batchSize),
+		iovs(batchSize),
+		controls(offload ? batchSize : 0)
+	{
+	}
+	
+	//Each buffer has enought room for a coalesced datagram when using offload
+	size_t batchSize;
+	bool offload;
+	size_t bufferSize;
+	std::unique_ptr<uint8_t[]> datas;
+	//Otherwise read directly into pooled payloads that can be handed over to the listener
+	std::vector<Datagram> datagrams;
+	std::vector<mmsghdr> messages;
+	std::vector<sockaddr_in> froms;
+	std::vector<iovec> iovs;
+	std::vector<ReceiveControl> controls;
+};
+
 EventLoop::EventLoop(Listener *listener, uint32_t packetPoolSize) :
 	listener(listener),
+	timers(GetClockNow().count()),
 	packetPool(packetPoolSize ? packetPoolSize : PacketPoolSize)
 {
 	Debug("-EventLoop::EventLoop() [this:%p,packetPoolSize:%lu]\n", this, packetPool.size());
@@ -89,6 +301,16 @@ EventLoop::~EventLoop()
 	Debug("-EventLoop::~EventLoop() [this:%p]\n", this);
 	if (running)
 		Stop();
+	
+	//Release pending timers
+	std::vector<TimerWheel::Entry*> pending;
+	timers.Clear(pending);
+	for (auto entry : pending)
+	{
+		auto timer = static_cast<TimerImpl*>(entry);
+		timer->next = 0ms;
+		timer->self.reset();
+	}
 }
 
 bool EventLoop::SetThreadName(std::thread::native_handle_type thread, const std::string& name)
@@ -188,6 +410,199 @@ void EventLoop::ClearRawTx()
 	rawTx.reset();
 }
 
+void EventLoop::SetSegmentationOffload(bool enabled)
+{
+	//Run on loop thread if running so it doesn't change in the middle of a send
+	if (running)
+		Async([=](auto now){ gso = enabled; });
+	else
+		gso = enabled;
+}
+
+bool EventLoop::SetReceiveBatchSize(size_t size)
+{
+	//Can't change it while running
+	if (running)
+		return Error("-EventLoop::SetReceiveBatchSize() | Already running\n");
+	//Check size
+	if (!size || size>MaxReceiveBatchSize)
+		return Error("-EventLoop::SetReceiveBatchSize() | Wrong size [size:%zu,max:%zu]\n",size,MaxReceiveBatchSize);
+	//Store it
+	receiveBatchSize = size;
+	//Done
+	return true;
+}
+
+bool EventLoop::SetReceiveOffload(bool enabled)
+{
+	//Can't change it while running
+	if (running)
+		return Error("-EventLoop::SetReceiveOffload() | Already running\n");
+#ifndef UDP_GRO
+	//Not available
+	if (enabled)
+		return Error("-EventLoop::SetReceiveOffload() | UDP_GRO not supported\n");
+#endif
+	//Store it
+	gro = enabled;
+	//Done
+	return true;
+}
+
+bool EventLoop::SetSpin(const std::chrono::microseconds& spin)
+{
+	//Can't change it while running
+	if (running)
+		return Error("-EventLoop::SetSpin() | Already running\n");
+	//Check value
+	if (spin.count()<0)
+		return Error("-EventLoop::SetSpin() | Wrong value [spin:%lld]\n",spin.count());
+	//Store it
+	this->spin = spin;
+	//Done
+	return true;
+}
+
+bool EventLoop::SetSocketBusyPoll(const std::chrono::microseconds& busyPoll)
+{
+	//Can't change it while running
+	if (running)
+		return Error("-EventLoop::SetSocketBusyPoll() | Already running\n");
+#ifndef SO_BUSY_POLL
+	//Not available
+	if (busyPoll.count())
+		return Error("-EventLoop::SetSocketBusyPoll() | SO_BUSY_POLL not supported\n");
+#endif
+	//Check value
+	if (busyPoll.count()<0 || busyPoll.count()>std::numeric_limits<int>::max())
+		return Error("-EventLoop::SetSocketBusyPoll() | Wrong value [busyPoll:%lld]\n",busyPoll.count());
+	//Store it
+	socketBusyPoll = busyPoll;
+	//Done
+	return true;
+}
+
+void EventLoop::EnableBusyPoll(int fd)
+{
+#ifdef SO_BUSY_POLL
+	int usecs = socketBusyPoll.count();
+	//Ask kernel to poll the device queue when there is no data, values above net.core.busy_read require CAP_NET_ADMIN
+	if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof(usecs))==-1)
+		Warning("-EventLoop::EnableBusyPoll() | Could not enable SO_BUSY_POLL [fd:%d,usecs:%d,errno:%d]\n",fd,usecs,errno);
+#endif
+}
+
+void EventLoop::EnableReceiveOffload(int fd)
+{
+#ifdef UDP_GRO
+	int on = 1;
+	//Ask kernel to coalesce datagrams, if not supported we will just get them one by one
+	if (setsockopt(fd, SOL_UDP, UDP_GRO, &on, sizeof(on))==-1)
+		Warning("-EventLoop::EnableReceiveOffload() | Could not enable UDP_GRO [fd:%d,errno:%d]\n",fd,errno);
+#endif
+}
+
+bool EventLoop::SetBackend(Backend backend)
+{
+	//Can't change it while running
+	if (running)
+		return Error("-EventLoop::SetBackend() | Already running\n");
+#ifndef __linux__
+	//Only poll available
+	if (backend!=Backend::Poll)
+		return Error("-EventLoop::SetBackend() | Backend not supported [backend:%d]\n",backend);
+#endif
+	//Store it
+	this->backend = backend;
+	//Done
+	return true;
+}
+
+bool EventLoop::CreatePoller()
+{
+	//Remove previous one
+	poller.reset();
+	
+#ifdef __linux__
+	//If using epoll
+	if (backend==Backend::Epoll)
+	{
+		//Create epoll instance
+		auto epoll = std::make_unique<EpollPoller>();
+		//Check it is valid
+		if (epoll->IsValid())
+			//Use it
+			poller = std::move(epoll);
+		else
+			//Fallback to poll
+			Warning("-EventLoop::CreatePoller() | could not create epoll, falling back to poll [errno:%d]\n",errno);
+	}
+#endif
+	//If not created yet
+	if (!poller)
+		//Use poll
+		poller = std::make_unique<PollPoller>();
+	
+	//Add signaling pipe
+	if (!poller->Add(pipe[0]))
+		//Error
+		return Error("-EventLoop::CreatePoller() | could not add signaling pipe [errno:%d]\n",errno);
+	
+	//Add main socket if any
+	if (fd!=FD_INVALID && !poller->Add(fd))
+		//Error
+		return Error("-EventLoop::CreatePoller() | could not add socket [fd:%d,errno:%d]\n",fd,errno);
+	
+	//Done
+	return true;
+}
+
+void EventLoop::AddSocket(int fd, Listener* listener)
+{
+	Debug("-EventLoop::AddSocket() [fd:%d,listener:%p]\n",fd,listener);
+	
+	//Run on loop thread
+	Async([=](auto now){
+		//Check params
+		if (fd==FD_INVALID || !listener || !poller)
+			return (void)Error("-EventLoop::AddSocket() | Wrong socket or loop not started [fd:%d]\n",fd);
+		//Check it is not already registered
+		if (fd==this->fd || !sockets.emplace(fd, listener).second)
+			return (void)Warning("-EventLoop::AddSocket() | Socket already registered [fd:%d]\n",fd);
+		//Set non blocking
+		(void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+		//Enable receive offload
+		if (gro)
+			EnableReceiveOffload(fd);
+		//Enable socket busy polling
+		if (socketBusyPoll.count())
+			EnableBusyPoll(fd);
+		//Add to poller
+		if (!poller->Add(fd))
+		{
+			//Remove it
+			sockets.erase(fd);
+			//Error
+			Error("-EventLoop::AddSocket() | Could not add socket [fd:%d,errno:%d]\n",fd,errno);
+		}
+	});
+}
+
+void EventLoop::RemoveSocket(int fd)
+{
+	Debug("-EventLoop::RemoveSocket() [fd:%d]\n",fd);
+	
+	//Run on loop thread
+	Async([=](auto now){
+		//Remove from registered sockets
+		if (!sockets.erase(fd))
+			return (void)Warning("-EventLoop::RemoveSocket() | Socket not registered [fd:%d]\n",fd);
+		//Remove from poller
+		if (poller)
+			poller->Remove(fd);
+	});
+}
+
 bool EventLoop::Start(std::function<void(void)> loop)
 {
 	//If already started
@@ -220,6 +635,11 @@ bool EventLoop::Start(std::function<void(void)> loop)
 	//Store socket
 	this->fd = FD_INVALID;
 	
+	//Create readiness backend
+	if (!CreatePoller())
+		//Error
+		return Error("-EventLoop::Start() | could not create poller\n");
+	
 	//Running
 	running = true;
 
@@ -265,6 +685,23 @@ bool EventLoop::Start(int fd)
 	//Store socket
 	this->fd = fd;
 	
+	//Check if the socket supports UDP segmentation offload
+	gsoSupported = false;
+#ifdef UDP_SEGMENT
+	if (fd!=FD_INVALID)
+	{
+		int segment = 0;
+		socklen_t size = sizeof(segment);
+		gsoSupported = getsockopt(fd, SOL_UDP, UDP_SEGMENT, &segment, &size)==0;
+	}
+#endif
+	Debug("-EventLoop::Start() | UDP segmentation offload [supported:%d,enabled:%d]\n",gsoSupported,gso);
+	
+	//Create readiness backend
+	if (!CreatePoller())
+		//Error
+		return Error("-EventLoop::Start() | could not create poller\n");
+	
 	//Running
 	running = true;
 
@@ -309,6 +746,10 @@ bool EventLoop::Stop()
 	//Empyt pipe
 	pipe[0] = pipe[1] = FD_INVALID;
 	
+	//Remove poller and registered sockets
+	poller.reset();
+	sockets.clear();
+	
 	//Log
 	Debug("<EventLoop::Stop() [fd:%d]\n",fd);
 	
@@ -317,40 +758,34 @@ bool EventLoop::Stop()
 	
 }
 
-void EventLoop::Send(const uint32_t ipAddr, const uint16_t port, Packet&& packet, const std::optional<PacketHeader::FlowRoutingInfo>& rawTxData, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback)
+void EventLoop::Send(const uint32_t ipAddr, const uint16_t port, Packet&& packet, const std::optional<PacketHeader::FlowRoutingInfo>& rawTxData, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback, Priority priority)
 {
 	TRACE_EVENT("eventloop", "EventLoop::Send", "packet_size", packet.GetSize());
 
-	//Get approximate queued size
-	auto aprox = sending.size_approx();
-	
-	//Check if there is too much in the queue already
-	if (aprox>MaxSendingQueueSize)
+	//Check if the loop is not even able to pick the packets
+	if (sending.size_approx()>MaxSendingQueueSize)
 	{
-		//Check state
-		if (state!=State::Overflown)
-		{
-			//We are overflowing
-			state = State::Overflown;
-			//Log
-			Error("-EventLoop::Send() | sending queue overflown [aprox:%lu]\n",aprox);
-		}
+		//Update state
+		SetSendingState(State::Overflown);
+		//Drop it
+		packetPool.release(std::move(packet));
+		dropped[priority]++;
 		//Do not enqueue more
 		return;
-	} else if (aprox>MaxSendingQueueSize/2 && state==State::Normal) {
-		//We are lagging behind
-		state = State::Lagging;
-		//Log
-		Error("-EventLoop::Send() | sending queue lagging behind [aprox:%lu]\n",aprox);
-	} else if (aprox<MaxSendingQueueSize/4 && state!=State::Normal)  {
-		//We are normal again
-		state = State::Normal;
-		//Log
-		Log("-EventLoop::Send() | sending queue back to normal [aprox:%lu]\n",aprox);
+	}
+	
+	//While lagging behind, probing would only make it worse
+	if (priority==Priority::Probing && state!=State::Normal)
+	{
+		//Drop it
+		packetPool.release(std::move(packet));
+		dropped[priority]++;
+		//Done
+		return;
 	}
 	
 	//Create send packet
-	SendBuffer send = {ipAddr, port, rawTxData, std::move(packet), callback};
+	SendBuffer send = {ipAddr, port, rawTxData, std::move(packet), callback, priority};
 	
 	//Move it back to sending queue
 	sending.enqueue(std::move(send));
@@ -359,39 +794,85 @@ void EventLoop::Send(const uint32_t ipAddr, const uint16_t port, Packet&& packet
 	Signal();
 }
 
-void EventLoop::Async(const std::function<void(std::chrono::milliseconds)>& func)
+EventLoop::SendingStats EventLoop::GetSendingStats() const
 {
-	//UltraDebug(">EventLoop::Async()\n");
+	SendingStats stats;
+	
+	//Get values
+	stats.state	= state;
+	stats.queued	= scheduler.GetQueued() + sending.size_approx();
+	stats.lagging	= laggingCount;
+	stats.overflown	= overflownCount;
+	for (size_t i = 0; i<NumPriorities; ++i)
+		stats.dropped[i] = dropped[i];
+	
+	//Only accurate from the loop thread
+	if (IsLoopThread())
+		stats.flows = scheduler.GetFlows();
+	
+	return stats;
+}
 
-	//If not in the same thread
-	if (std::this_thread::get_id() != thread.get_id())
+void EventLoop::SetSendingState(State state)
+{
+	//Swap state
+	State prev = this->state.exchange(state);
+	
+	//If not changed
+	if (prev==state)
+		//Nothing to do
+		return;
+	
+	//Log
+	switch (state)
 	{
-		//Create task
-		auto task = std::make_pair(func,std::nullopt);
-
-		//Add to pending taks
-		tasks.enqueue(std::move(task));
-
-		//Signal the thread this will cause the poll call to exit
-		Signal();
-	} else {
-		//Call now otherwise
-		func(GetNow());
+		case State::Overflown:
+			overflownCount++;
+			Error("-EventLoop::SetSendingState() | sending queue overflown [queued:%zu]\n",scheduler.GetQueued());
+			break;
+		case State::Lagging:
+			laggingCount++;
+			Error("-EventLoop::SetSendingState() | sending queue lagging behind [queued:%zu]\n",scheduler.GetQueued());
+			break;
+		case State::Normal:
+			Log("-EventLoop::SetSendingState() | sending queue back to normal [queued:%zu]\n",scheduler.GetQueued());
+			break;
 	}
+}
 
-	//UltraDebug("<EventLoop::Async()\n");
+void EventLoop::EnqueueFlow(SendBuffer&& item)
+{
+	//Get destination
+	uint64_t key = (uint64_t)item.ipAddr<<16 | item.port;
+	Priority priority = item.priority;
+	
+	//Queue it, dropping lower priority packets if full
+	auto result = scheduler.Enqueue(key, priority, std::move(item), [this](SendBuffer&& buffer, uint8_t priority) {
+		packetPool.release(std::move(buffer.packet));
+		dropped[priority]++;
+	});
+	
+	//If it was queued
+	if (result==SendScheduler::Queued)
+		//Done
+		return;
+	
+	//If there were no lower priority packets to drop on any destination
+	if (result==SendScheduler::Overflown)
+		SetSendingState(State::Overflown);
+	
+	//Drop new one
+	packetPool.release(std::move(item.packet));
+	dropped[priority]++;
 }
 
-void EventLoop::Async(const std::function<void(std::chrono::milliseconds)>& func, const std::function<void(std::chrono::milliseconds)>& callback)
+void EventLoop::Async(Task&& task)
 {
 	//UltraDebug(">EventLoop::Async()\n");
 
 	//If not in the same thread
 	if (std::this_thread::get_id() != thread.get_id())
 	{
-		//Create task
-		auto task = std::make_pair(func, callback);
-
 		//Add to pending taks
 		tasks.enqueue(std::move(task));
 
@@ -399,31 +880,46 @@ void EventLoop::Async(const std::function<void(std::chrono::milliseconds)>& func
 		Signal();
 	} else {
 		//Call now otherwise
-		func(GetNow());
-		//Call callback
-		callback(GetNow());
+		task(GetNow());
 	}
+
 	//UltraDebug("<EventLoop::Async()\n");
 }
 
+void EventLoop::Async(const std::function<void(std::chrono::milliseconds)>& func)
+{
+	//Store function inline
+	Async(Task(func));
+}
+
+void EventLoop::Async(const std::function<void(std::chrono::milliseconds)>& func, const std::function<void(std::chrono::milliseconds)>& callback)
+{
+	//Run callback just after the function
+	Async(Task([func, callback](std::chrono::milliseconds now) {
+		func(now);
+		callback(now);
+	}));
+}
+
 
 std::future<void> EventLoop::Future(const std::function<void(std::chrono::milliseconds)>& func)
 {
 	//UltraDebug(">EventLoop::Future()\n");
 	
-	//As std::functions only allow copiable objets, we have to wrap the promise inside a shared_ptr
-	auto promise = std::make_shared<std::promise<void>>();
+	//Tasks are move only, so the promise can be stored in it
+	std::promise<void> promise;
+	auto future = promise.get_future();
 
-	//Add an async with callback
-	Async(func, [=](std::chrono::milliseconds) {
-		//Resolve promise on callbak
-		promise->set_value();
-	});
+	//Resolve promise after running the function
+	Async(Task([func, promise = std::move(promise)](std::chrono::milliseconds now) mutable {
+		func(now);
+		promise.set_value();
+	}));
 
 	//UltraDebug("<EventLoop::Future()\n");
 	
 	//Return the future for the promise
-	return promise->get_future();;
+	return future;
 }
 
 Timer::shared EventLoop::CreateTimer(const std::function<void(std::chrono::milliseconds)>& callback)
@@ -448,16 +944,18 @@ Timer::shared EventLoop::CreateTimer(const std::chrono::milliseconds& ms, const
 	auto timer = std::make_shared<TimerImpl>(*this,repeat,callback);
 	
 	//Get next
-	auto next = this->Now() + ms;
+	auto next = GetClockNow() + ms;
 	
-	//Add it async
-	Async([this,timer,next](auto now){
-		//Set next tick
-		timer->next = next;
-
-		//Add to timer list
-		timers.emplace(next, timer);
-	});
+	//If we are on the loop thread
+	if (IsLoopThread())
+		//Add to timer wheel now
+		ScheduleTimer(timer, next);
+	else
+		//Add it async
+		Async([this,timer,next](auto now){
+			//Add to timer wheel
+			ScheduleTimer(timer, next);
+		});
 	
 	//Done
 	return std::static_pointer_cast<Timer>(timer);
@@ -465,6 +963,11 @@ Timer::shared EventLoop::CreateTimer(const std::chrono::milliseconds& ms, const
 
 void EventLoop::TimerImpl::Cancel()
 {
+	//If we are on the loop thread
+	if (loop.IsLoopThread())
+		//Remove us now
+		return loop.CancelTimer(shared_from_this());
+	
 	//Add it async
 	loop.Async([timer = shared_from_this()](auto now){
 		//Remove us
@@ -474,21 +977,31 @@ void EventLoop::TimerImpl::Cancel()
 
 void EventLoop::TimerImpl::Again(const std::chrono::milliseconds& ms)
 {
-	//UltraDebug(">EventLoop::Again() | Again triggered in %u\n",ms.count());
+	AgainMicroseconds(ms);
+}
+
+void EventLoop::TimerImpl::AgainMicroseconds(const std::chrono::microseconds& us)
+{
+	//UltraDebug(">EventLoop::Again() | Again triggered in %u\n",us.count());
 	
 	//Get next
-	auto next = loop.Now() + ms;
+	auto next = GetClockNow() + us;
+	
+	//If we are on the loop thread
+	if (loop.IsLoopThread())
+	{
+		//Remove us
+		loop.CancelTimer(shared_from_this());
+		//Schedule again
+		return loop.ScheduleTimer(shared_from_this(), next);
+	}
 	
 	//Reschedule it async
 	loop.Async([timer = shared_from_this(),next](auto now){
 		//Remove us
 		timer->loop.CancelTimer(timer);
-
-		//Set next tick
-		timer->next = next;
-		
-		//Add to timer list
-		timer->loop.timers.emplace(next, timer);
+		//Schedule again
+		timer->loop.ScheduleTimer(timer, next);
 	});
 	
 	//UltraDebug("<EventLoop::Again() | timer triggered at %llu\n",next.count());
@@ -504,23 +1017,40 @@ void EventLoop::TimerImpl::Reschedule(const std::chrono::milliseconds& ms, const
 	//UltraDebug(">EventLoop::TimerImpl::Reschedule() | in %u repeat %u\n", ms.count(), repeat.count());
 
 	//Get next
-	auto next = loop.Now() + ms;
+	auto next = GetClockNow() + ms;
+	
+	//If we are on the loop thread
+	if (loop.IsLoopThread())
+	{
+		//Remove us
+		loop.CancelTimer(shared_from_this());
+		//Update repeat interval
+		this->repeat = repeat;
+		//Schedule again
+		return loop.ScheduleTimer(shared_from_this(), next);
+	}
 
 	//Reschedule it async
 	loop.Async([timer = shared_from_this(), next, repeat](auto now){
 		//Remove us
 		timer->loop.CancelTimer(timer);
-
-		//Set next tick
-		timer->next = next;
 		//Update repeat interval
 		timer->repeat = repeat;
-		
-		//Add to timer list
-		timer->loop.timers.emplace(next, timer);
+		//Schedule again
+		timer->loop.ScheduleTimer(timer, next);
 	});
 }
 
+void EventLoop::ScheduleTimer(const TimerImpl::shared& timer, const std::chrono::microseconds& deadline)
+{
+	//Set next tick
+	timer->next = std::chrono::ceil<std::chrono::milliseconds>(deadline);
+	//Keep it alive while on the wheel
+	timer->self = timer;
+	//Add to timer wheel
+	timers.Add(timer.get(), deadline.count());
+}
+
 void EventLoop::CancelTimer(TimerImpl::shared timer)
 {
 
@@ -529,36 +1059,23 @@ void EventLoop::CancelTimer(TimerImpl::shared timer)
 	//We don't have to repeat this
 	timer->repeat = 0ms;
 	
-	//If not scheduled
-	if (!timer->next.count())
-		//Nothing
-		return;
-	
-	//Get all timers at that tick
-	auto result = timers.equal_range(timer->next);
-	
 	//Reset next tick
 	timer->next = 0ms;
-
-	// Iterate over the range
-	for (auto it = result.first; it != result.second; ++it)
-	{
-		//If it is the same impl
-		if (it->second.get()==timer.get())
-		{
-			//Remove this one
-			timers.erase(it);
-			//Found
-			break;
-		}
-	}
+	
+	//Remove from wheel
+	timers.Remove(timer.get());
+	
+	//Not owned by the wheel anymore
+	timer->self.reset();
+	
 	//UltraDebug("<EventLoop::CancelTimer() \n");
 }
 
 const std::chrono::milliseconds EventLoop::Now()
 {
 	//Get new now and store in cache
-	return now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+	preciseNow = GetClockNow();
+	return now = std::chrono::duration_cast<std::chrono::milliseconds>(preciseNow);
 }
 
 void EventLoop::Signal()
@@ -585,29 +1102,38 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 {
 	//Log(">EventLoop::Run() | [%p,running:%d,duration:%llu]\n",this,running,duration.count());
 	
-	//Recv data
-// Ignore coverity error: Local variable "datas" uses 192000 bytes of stack space, which exceeds the maximum single use of 20000 bytes.
-// coverity[stack_use_local_overflow]
-	uint8_t datas[MaxMultipleReceivingMessages][MTU] ZEROALIGNEDTO32;
-	size_t  size = MTU;
+	//Check we have been started
+	if (!poller)
+		//Error
+		return (void)Error("-EventLoop::Run() | Not started\n");
 	
-	//UDP send flags
-	uint32_t flags = MSG_DONTWAIT;
+	//Create receive buffers if not done yet or settings have changed
+	if (!receiveBuffers || receiveBuffers->batchSize!=receiveBatchSize || receiveBuffers->offload!=gro)
+		receiveBuffers = std::make_unique<ReceiveBuffers>(receiveBatchSize, gro);
 	
 	//Pending data
 	std::vector<SendBuffer> items;
 	
-	//Set values for polling
-	ufds[0].fd = fd;
-	ufds[1].fd = pipe[0];
-	//Set to wait also for write events on pipe for signaling
-	ufds[1].events = POLLIN | POLLERR | POLLHUP;
-
-	//Set non blocking so we can get an error when we are closed by end
-	int fsflags = fcntl(fd,F_GETFL,0);
-	fsflags |= O_NONBLOCK;
-	(void)fcntl(fd,F_SETFL,fsflags);
+	//Ready events
+	std::vector<Poller::Ready> ready;
+	
+	//If we are waiting for write events on socket
+	bool writable = false;
 
+	//If got socket
+	if (fd!=FD_INVALID)
+	{
+		//Set non blocking so we can get an error when we are closed by end
+		int fsflags = fcntl(fd,F_GETFL,0);
+		fsflags |= O_NONBLOCK;
+		(void)fcntl(fd,F_SETFL,fsflags);
+		//Enable receive offload
+		if (gro)
+			EnableReceiveOffload(fd);
+		//Enable socket busy polling
+		if (socketBusyPoll.count())
+			EnableBusyPoll(fd);
+	}
 
 	//Catch all IO errors and do nothing
 	signal(SIGIO,[](int){});
@@ -623,20 +1149,24 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 	{
 		//TRACE_EVENT("eventloop", "EventLoop::Run::Iteration");
 		//If we have anything to send set to wait also for write events
-		ufds[0].events = sending.size_approx() ? POLLIN | POLLOUT | POLLERR | POLLHUP : POLLIN | POLLERR | POLLHUP;
-		//Clear readed events
-		ufds[0].revents = 0;
-		ufds[1].revents = 0;
+		bool pending = sending.size_approx() || !items.empty() || scheduler.GetQueued();
+		
+		//Only update poller if it has changed
+		if (fd!=FD_INVALID && pending!=writable)
+			//Update write events
+			writable = poller->SetWritable(fd, pending) ? pending : writable;
 		
 		//Until signaled or one each 10 seconds to prevent deadlocks
-		int timeout = GetNextTimeout(10E3, until);
+		auto timeout = GetNextTimeout(10s, until);
 
-		//UltraDebug(">EventLoop::Run() | poll timeout:%d timers:%d tasks:%d size:%d\n",timeout,timers.size(),tasks.size_approx(), sizeof(ufds) / sizeof(pollfd));
+		//UltraDebug(">EventLoop::Run() | poll timeout:%d timers:%d tasks:%d\n",timeout,timers.size(),tasks.size_approx());
 		
 		//Wait for events
 		{
 			//TRACE_EVENT("eventloop", "poll", "timeout", timeout);
-			(void)poll(ufds,sizeof(ufds)/sizeof(pollfd),timeout);
+			//Busy wait first if enabled, it reduces the timeout by the spinning time
+			if (!spin.count() || !timeout.count() || !Spin(timeout, ready))
+				(void)poller->Wait(timeout, ready);
 		}
 		
 		//Update now
@@ -644,170 +1174,79 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 		
 		//UltraDebug("<EventLoop::Run() | poll timeout:%d timers:%d tasks:%d\n",timeout,timers.size(),tasks.size_approx());
 
-		//Check for cancel
-		if ((ufds[0].revents & POLLHUP) || (ufds[0].revents & POLLERR) || (ufds[1].revents & POLLHUP) || (ufds[1].revents & POLLERR))
-		{
-			//Error
-			Log("-EventLoop::Run() | Pool error event [revents:%d,errno:%d]\n",ufds[0].revents,errno);
-			//Exit
-			break;
-		}
+		//If we have been signaled
+		bool pendingSignal = false;
+		//If we have to exit the loop
+		bool exit = false;
 		
-		//Read first
-		if (ufds[0].revents & POLLIN)
+		//For each ready fd
+		for (const auto& event : ready)
 		{
-			struct sockaddr_in froms[MaxMultipleReceivingMessages] = {};
-			struct mmsghdr messages[MaxMultipleReceivingMessages] = {};
-			struct iovec iovs[MaxMultipleReceivingMessages][1] = {{}};
-
-			TRACE_EVENT("eventloop", "EventLoop::Run::ProcessIn");
-			//UltraDebug("-EventLoop::Run() | ufds[0].revents & POLLIN\n");
-
-			//Reserve space
-			items.reserve(MaxMultipleSendingMessages);
-
-			//For each msg
-			for (size_t i = 0; i < MaxMultipleReceivingMessages; i++)
-			{	
-				//IO buffer
-				auto& iov = iovs[i];
-				iov[0].iov_base = datas[i];
-				iov[0].iov_len = size;
-
-				//Recv address
-				sockaddr_in& from = froms[i];
-
-				//Message
-				auto& message = messages[i].msg_hdr;
-				message.msg_name = (sockaddr*)&from;
-				message.msg_namelen = sizeof(from);
-				message.msg_iov = iov;
-				message.msg_iovlen = 1;
-				message.msg_control = 0;
-				message.msg_controllen = 0;
-			}
-
-			//Read from socket
-			int len = recvmmsg(fd, messages, MaxMultipleReceivingMessages, flags, nullptr);
-
-			//If we got listener
-			if (listener)
-				//for each one
-				for (int i = 0; i < len && i < MaxMultipleReceivingMessages; i++)
-					//double check
-					if (messages[i].msg_len)
-						//Run callback
-						listener->OnRead(ufds[0].fd, datas[i], messages[i].msg_len, ntohl(froms[i].sin_addr.s_addr), ntohs(froms[i].sin_port));
-		}
-		
-		//Check read is possible
-		if (ufds[0].revents & POLLOUT)
-		{
-			//Multiple messages struct
-			struct mmsghdr messages[MaxMultipleSendingMessages] = {};
-			struct sockaddr_in tos[MaxMultipleSendingMessages] = {};
-			struct iovec iovs[MaxMultipleSendingMessages][1] = {{}};
-
-			TRACE_EVENT("eventloop", "EventLoop::Run::ProcessOut");
-			//UltraDebug("-EventLoop::Run() | ufds[0].revents & POLLOUT\n");
-
-			
-			//Now send all that we can
-			while (items.size()<MaxMultipleSendingMessages)
+			//If it is the signaling pipe or the main socket
+			if (event.fd==pipe[0] || event.fd==fd)
 			{
-				//Get current item
-				SendBuffer item;
-				
-				//Get next item
-				if (!sending.try_dequeue(item))
+				//Check for cancel
+				if (event.events & Poller::Error)
+				{
+					//Error
+					Log("-EventLoop::Run() | Pool error event [fd:%d,events:%d,errno:%d]\n",event.fd,event.events,errno);
+					//Exit
+					exit = true;
 					break;
-				
-				//Move
-				items.emplace_back(std::move(item));
-			}
-			
-			//actual messages dequeued
-			uint32_t len = 0;
-			
-			//For each item
-			for (auto& item : items)
-			{
-				//IO buffer
-				auto& iov		= iovs[len];
-
-				//Message
-				msghdr& message		= messages[len].msg_hdr;
-				message.msg_name	= nullptr;
-				message.msg_namelen	= 0;
-				message.msg_iov		= iov;
-				message.msg_iovlen	= 1;
-				message.msg_control	= 0;
-				message.msg_controllen	= 0;
-
-				if (!this->rawTx) {
-					//Send address
-					sockaddr_in& to		= tos[len];
-					to.sin_family		= AF_INET;
-					to.sin_addr.s_addr	= htonl(item.ipAddr);
-					to.sin_port		= htons(item.port);
-
-					message.msg_name	= (sockaddr*) & to;
-					message.msg_namelen	= sizeof (to);
-				} else {
-					//Packet header
-					auto& candidateData = item.rawTxData ? *item.rawTxData : this->rawTx->defaultRoute;
-					PacketHeader::PrepareHeader(this->rawTx->header, item.ipAddr, item.port, candidateData, item.packet);
-					item.packet.PrefixData((uint8_t*) &this->rawTx->header, sizeof(this->rawTx->header));
 				}
-
-				//Set packet data
-				iov[0].iov_base		= item.packet.GetData();
-				iov[0].iov_len		= item.packet.GetSize();
-				
-				//Reset message len
-				messages[len].msg_len	= 0;
-				
+				//If it is the signaling pipe
+				if (event.fd==pipe[0])
+				{
+					//Clear it later
+					pendingSignal = event.events & Poller::Readable;
+					//Next
+					continue;
+				}
+				//Read first
+				if (event.events & Poller::Readable)
+					//Read and dispatch
+					ProcessIn(fd, listener);
+				//Check write is possible
+				if (event.events & Poller::Writable)
+					//Send all we can
+					ProcessOut(items);
 				//Next
-				len++;
+				continue;
 			}
 			
-			//Send them
-			int sendFd = this->rawTx ? this->rawTx->fd : fd;
-			{
-				TRACE_EVENT("eventloop", "sendmmsg", "fd", fd, "vlen", len);
-				sendmmsg(sendFd, messages, len, flags);
-			}
+			//Find registered socket, it could have been removed in a previous callback
+			auto it = sockets.find(event.fd);
+			//If not found
+			if (it==sockets.end())
+				//Skip
+				continue;
 			
-			//Update now
-			now = Now();
-
-			//First
-			auto it = items.begin();
-			//Retry
-			std::vector<SendBuffer> retry;
-			//check each mesasge
-			for (uint32_t i = 0; i<len && it!=items.end(); ++i, ++it)
+			//If there was an error on the socket
+			if (event.events & Poller::Error)
 			{
-				//If we are in normal state and we can retry a failed message
-				if (!messages[i].msg_len && state==State::Normal && (errno==EAGAIN || errno==EWOULDBLOCK))
-				{
-					//Retry it
-					retry.emplace_back(std::move(*it));
-				} else {
-					//Move packet buffer back to the pool
-					packetPool.release(std::move(it->packet));
-					//If we had a callback
-					if (it->callback)
-						//Set sending time
-						it->callback.value()(now);
-				}
+				//Error
+				Warning("-EventLoop::Run() | Error event on registered socket, removing it [fd:%d,events:%d,errno:%d]\n",event.fd,event.events,errno);
+				//Remove from poller
+				poller->Remove(event.fd);
+				//Unregister
+				sockets.erase(it);
+				//Next
+				continue;
 			}
-			//Clear items
-			items.clear();
-			//Copy elements to retry
-			std::move(retry.begin(), retry.end(), std::back_inserter(items));
+			
+			//Read and dispatch
+			if (event.events & Poller::Readable)
+				ProcessIn(event.fd, it->second);
 		}
 		
+		//Check if we have to exit
+		if (exit)
+			break;
+		
+		//Update now after I/O
+		if (!ready.empty())
+			now = Now();
+		
 		//Process pendint tasks
 		ProcessTasks(now);
 
@@ -815,7 +1254,7 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 		ProcessTriggers(now);
 		
 		//Read first from signal pipe
-		if (ufds[1].revents & POLLIN)
+		if (pendingSignal)
 			//Clear signal flag
 			ClearSignal();
 		
@@ -829,29 +1268,380 @@ void EventLoop::Run(const std::chrono::milliseconds &duration)
 	//Log("<EventLoop::Run()\n");
 }
 
-int EventLoop::GetNextTimeout(int defaultTimeout, const std::chrono::milliseconds& until) const
+bool EventLoop::Spin(std::chrono::microseconds& timeout, std::vector<Poller::Ready>& ready)
+{
+	TRACE_EVENT("eventloop", "EventLoop::Spin");
+	
+	//Producers don't need to write to the pipe while we are spinning
+	signaled.test_and_set();
+	
+	//Do not spin past next timer
+	auto duration = std::min(timeout, spin);
+	auto ini = std::chrono::steady_clock::now();
+	
+	while (true)
+	{
+		//If there is any task or packet queued
+		if (tasks.size_approx() || sending.size_approx())
+		{
+			//Process them without blocking
+			timeout = 0us;
+			return false;
+		}
+		//Check sockets without blocking
+		if (poller->Wait(0us, ready)>0)
+			//Process them
+			return true;
+		//Get spinning time
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - ini);
+		//If done
+		if (elapsed>=duration)
+		{
+			//Block only for the rest
+			timeout = std::max(timeout - elapsed, 0us);
+			break;
+		}
+		//Let the sibling hyperthread run
+		CpuRelax();
+	}
+	
+	//Producers must signal us again before blocking
+	signaled.clear();
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	
+	//Check nothing was queued while clearing the flag
+	if (tasks.size_approx() || sending.size_approx())
+		timeout = 0us;
+	
+	//Block
+	return false;
+}
+
+void EventLoop::ProcessIn(int fd, Listener* listener)
 {
-	int timeout = defaultTimeout;
+	auto& buffers = *receiveBuffers;
+	auto messages = buffers.messages.data();
+	auto froms = buffers.froms.data();
+	auto iovs = buffers.iovs.data();
+
+	TRACE_EVENT("eventloop", "EventLoop::Run::ProcessIn", "fd", fd);
+	//UltraDebug("-EventLoop::ProcessIn() [fd:%d]\n",fd);
+
+	//For each msg
+	for (size_t i = 0; i < buffers.batchSize; i++)
+	{	
+		//IO buffer
+		auto& iov = iovs[i];
+		
+		//If reading into payloads
+		if (!buffers.offload)
+		{
+			auto& payload = buffers.datagrams[i].payload;
+			//If it has been kept by the listener, get a new one
+			if (!payload || payload.use_count()>1)
+				payload = RTPPacket::PayloadPool.allocate();
+			else
+				//Reuse it
+				payload->Reset();
+			iov.iov_base = payload->GetMediaData();
+			iov.iov_len = std::min<size_t>(payload->GetMaxMediaLength(), buffers.bufferSize);
+		} else {
+			iov.iov_base = buffers.datas.get() + i * buffers.bufferSize;
+			iov.iov_len = buffers.bufferSize;
+		}
+
+		//Recv address
+		sockaddr_in& from = froms[i];
+
+		//Message
+		auto& message = messages[i].msg_hdr;
+		message.msg_name = (sockaddr*)&from;
+		message.msg_namelen = sizeof(from);
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = buffers.offload ? buffers.controls[i].buf : nullptr;
+		message.msg_controllen = buffers.offload ? sizeof(buffers.controls[i].buf) : 0;
+		message.msg_flags = 0;
+		messages[i].msg_len = 0;
+	}
+
+	//Read from socket
+	int len = recvmmsg(fd, messages, buffers.batchSize, MSG_DONTWAIT, nullptr);
+
+	//If read into payloads
+	if (listener && !buffers.offload)
+	{
+		size_t count = 0;
+		//for each one
+		for (int i = 0; i < len && (size_t)i < buffers.batchSize; i++)
+		{
+			//Get size
+			size_t size = messages[i].msg_len;
+			//double check
+			if (!size)
+				continue;
+			//Keep them contiguous
+			auto& datagram = buffers.datagrams[count];
+			if (count != (size_t)i)
+				std::swap(datagram.payload, buffers.datagrams[i].payload);
+			//Set received length and origin
+			datagram.payload->SetMediaLength(size);
+			datagram.ipAddr = ntohl(froms[i].sin_addr.s_addr);
+			datagram.port = ntohs(froms[i].sin_port);
+			count++;
+		}
+		//Hand them over without copying
+		if (count)
+			listener->OnReadPayloads(fd, buffers.datagrams.data(), count);
+	//If we got listener
+	} else if (listener)
+		//for each one
+		for (int i = 0; i < len && (size_t)i < buffers.batchSize; i++)
+		{
+			//Get data and size
+			auto data = (const uint8_t*)iovs[i].iov_base;
+			size_t size = messages[i].msg_len;
+			//double check
+			if (!size)
+				continue;
+			//Get origin
+			uint32_t ipAddr = ntohl(froms[i].sin_addr.s_addr);
+			uint16_t port = ntohs(froms[i].sin_port);
+			//By default it is a single datagram
+			size_t segmentSize = size;
+#ifdef UDP_GRO
+			//Check if kernel has coalesced several datagrams
+			if (buffers.offload)
+			{
+				for (cmsghdr* cmsg = CMSG_FIRSTHDR(&messages[i].msg_hdr); cmsg; cmsg = CMSG_NXTHDR(&messages[i].msg_hdr, cmsg))
+				{
+					//Get segment size
+					if (cmsg->cmsg_level==SOL_UDP && cmsg->cmsg_type==UDP_GRO)
+					{
+						int gsoSize = 0;
+						memcpy(&gsoSize, CMSG_DATA(cmsg), sizeof(gsoSize));
+						if (gsoSize>0)
+							segmentSize = gsoSize;
+					}
+				}
+			}
+#endif
+			//Split and dispatch each original datagram
+			for (size_t offset = 0; offset < size; offset += segmentSize)
+				//Run callback
+				listener->OnRead(fd, data + offset, std::min(segmentSize, size - offset), ipAddr, port);
+		}
+}
+
+void EventLoop::ProcessOut(std::vector<SendBuffer>& items)
+{
+	//Multiple messages struct
+	struct mmsghdr messages[MaxMultipleSendingMessages] = {};
+	struct sockaddr_in tos[MaxMultipleSendingMessages] = {};
+	struct iovec iovs[MaxMultipleSendingMessages] = {};
+	//Number of items in each message, more than one when segmented
+	uint32_t segments[MaxMultipleSendingMessages] = {};
+#ifdef UDP_SEGMENT
+	//Control data for segmentation offload
+	union {
+		char buf[CMSG_SPACE(sizeof(uint16_t))];
+		struct cmsghdr align;
+	} controls[MaxMultipleSendingMessages] = {};
+#endif
+
+	TRACE_EVENT("eventloop", "EventLoop::Run::ProcessOut");
+	//UltraDebug("-EventLoop::ProcessOut()\n");
+
+	//Reserve space
+	items.reserve(MaxMultipleSendingMessages);
+	
+	//Move all queued packets to their destination flow
+	SendBuffer pending;
+	while (sending.try_dequeue(pending))
+		EnqueueFlow(std::move(pending));
+	
+	//Deficit round robin across destinations, higher priority first within each one
+	scheduler.Dequeue(items, MaxMultipleSendingMessages, [](const SendBuffer& item) { return item.packet.GetSize(); });
+	
+	//Get queued packets
+	size_t queued = scheduler.GetQueued();
+	
+	//Update state
+	if (queued>MaxSendingQueueSize/2 && state==State::Normal)
+		SetSendingState(State::Lagging);
+	else if (queued<MaxSendingQueueSize/4 && state!=State::Normal)
+		SetSendingState(State::Normal);
+	
+	//Check if we can coalesce packets, not possible when sending raw packets as they carry their own headers
+	bool segmentation = gso && gsoSupported && !this->rawTx;
+
+	//actual messages dequeued
+	uint32_t len = 0;
+	
+	//For each item
+	for (size_t i = 0; i<items.size(); )
+	{
+		//Get item
+		auto& item = items[i];
+		//Message
+		msghdr& message		= messages[len].msg_hdr;
+		message.msg_name	= nullptr;
+		message.msg_namelen	= 0;
+		message.msg_iov		= &iovs[i];
+		message.msg_iovlen	= 1;
+		message.msg_control	= 0;
+		message.msg_controllen	= 0;
+
+		if (!this->rawTx) {
+			//Send address
+			sockaddr_in& to		= tos[len];
+			to.sin_family		= AF_INET;
+			to.sin_addr.s_addr	= htonl(item.ipAddr);
+			to.sin_port		= htons(item.port);
+
+			message.msg_name	= (sockaddr*) & to;
+			message.msg_namelen	= sizeof (to);
+		} else {
+			//Packet header
+			auto& candidateData = item.rawTxData ? *item.rawTxData : this->rawTx->defaultRoute;
+			PacketHeader::PrepareHeader(this->rawTx->header, item.ipAddr, item.port, candidateData, item.packet);
+			item.packet.PrefixData((uint8_t*) &this->rawTx->header, sizeof(this->rawTx->header));
+		}
+
+		//Set packet data
+		iovs[i].iov_base	= item.packet.GetData();
+		iovs[i].iov_len		= item.packet.GetSize();
+		
+		//Segment size and total payload
+		size_t segmentSize = item.packet.GetSize();
+		size_t total = segmentSize;
+		//One item so far
+		segments[len] = 1;
+		
+		//Coalesce following packets to same destination with same size, last one can be smaller
+		while (segmentation && i + segments[len] < items.size() && segments[len] < MaxSegmentationOffloadSegments)
+		{
+			//Get candidate
+			auto& next = items[i + segments[len]];
+			//Get size
+			size_t size = next.packet.GetSize();
+			//Check it can be appended to the segmented send
+			if (next.ipAddr!=item.ipAddr || next.port!=item.port || !size || size>segmentSize || total+size>MaxSegmentationOffloadSize)
+				break;
+			//Append data
+			iovs[i + segments[len]].iov_base	= next.packet.GetData();
+			iovs[i + segments[len]].iov_len		= size;
+			//One more
+			segments[len]++;
+			total += size;
+			//If it was smaller it must be the last one
+			if (size<segmentSize)
+				break;
+		}
+#ifdef UDP_SEGMENT
+		//If we have coalesced more than one packet
+		if (segments[len]>1)
+		{
+			//Set io vectors
+			message.msg_iovlen	= segments[len];
+			//Set segment size on control message
+			message.msg_control	= controls[len].buf;
+			message.msg_controllen	= sizeof(controls[len].buf);
+			cmsghdr* cmsg		= CMSG_FIRSTHDR(&message);
+			cmsg->cmsg_level	= SOL_UDP;
+			cmsg->cmsg_type		= UDP_SEGMENT;
+			cmsg->cmsg_len		= CMSG_LEN(sizeof(uint16_t));
+			*(uint16_t*)CMSG_DATA(cmsg) = segmentSize;
+		}
+#endif
+		//Reset message len
+		messages[len].msg_len	= 0;
+		
+		//Next
+		i += segments[len];
+		len++;
+	}
+	
+	//Send them
+	int sendFd = this->rawTx ? this->rawTx->fd : fd;
+	int ret = 0;
+	{
+		TRACE_EVENT("eventloop", "sendmmsg", "fd", fd, "vlen", len);
+		ret = sendmmsg(sendFd, messages, len, MSG_DONTWAIT);
+	}
+	
+	//If the first message was segmented and the kernel or the device does not support it
+	if (ret<0 && len && segments[0]>1 && (errno==EIO || errno==EINVAL || errno==ENOPROTOOPT))
+	{
+		Warning("-EventLoop::ProcessOut() | UDP segmentation offload failed, disabling it [errno:%d]\n", errno);
+		//Disable it
+		gsoSupported = false;
+		//Retry all of them on next iteration
+		return;
+	}
+	
+	//Update now
+	auto now = Now();
+
+	//First
+	auto it = items.begin();
+	//Retry
+	std::vector<SendBuffer> retry;
+	//check each mesasge
+	for (uint32_t i = 0; i<len && it!=items.end(); ++i)
+	{
+		//Check if message has been sent
+		bool sent = messages[i].msg_len;
+		//For each item in message
+		for (uint32_t j = 0; j<segments[i] && it!=items.end(); ++j, ++it)
+		{
+			//If we are in normal state and we can retry a failed message
+			if (!sent && state==State::Normal && (errno==EAGAIN || errno==EWOULDBLOCK))
+			{
+				//Retry it
+				retry.emplace_back(std::move(*it));
+			} else {
+				//Move packet buffer back to the pool
+				packetPool.release(std::move(it->packet));
+				//If we had a callback
+				if (it->callback)
+					//Set sending time
+					it->callback.value()(now);
+			}
+		}
+	}
+	//Clear items
+	items.clear();
+	//Copy elements to retry
+	std::move(retry.begin(), retry.end(), std::back_inserter(items));
+}
+
+std::chrono::microseconds EventLoop::GetNextTimeout(const std::chrono::microseconds& defaultTimeout, const std::chrono::milliseconds& until) const
+{
+	auto timeout = defaultTimeout;
+	
+	//Get max duration with enought precission
+	auto end = until != std::chrono::milliseconds::max() ? std::chrono::duration_cast<std::chrono::microseconds>(until) : std::chrono::microseconds::max();
 
 	//Check if we have any pending task to wait or exit poll inmediatelly
 	if (tasks.size_approx())
 	{
 		//No wait
-		timeout = 0;
+		timeout = 0us;
 	}
 	//If we have any timer or a timeout
-	else if (timers.size())
+	else if (!timers.empty())
 	{
-		//Get first timer in  queue
-		auto next = std::min(timers.cbegin()->first, until);
+		//Get first timer in wheel
+		auto next = std::min(std::chrono::microseconds(timers.GetNextExpiration()), end);
 		//Override timeout
-		timeout = next > now ? std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count() : 0;
+		timeout = next > preciseNow ? next - preciseNow : 0us;
 	}
 	//If we have a maximum duration
-	else if (until != std::chrono::milliseconds::max())
+	else if (end != std::chrono::microseconds::max())
 	{
 		//Override timeout
-		timeout = until > now ? std::chrono::duration_cast<std::chrono::milliseconds>(until - now).count() : 0;
+		timeout = end > preciseNow ? end - preciseNow : 0us;
 	}
 
 	return std::min(timeout, defaultTimeout);
@@ -873,17 +1663,15 @@ void EventLoop::ProcessTasks(const std::chrono::milliseconds& now)
 {
 	//Run queued task
 	TRACE_EVENT_BEGIN("eventloop", "EventLoop::ProcessTasks");
-	std::pair<std::function<void(std::chrono::milliseconds)>,std::optional<std::function<void(std::chrono::milliseconds)>>> task;
+	Task task;
 	//Get all pending taks
 	while (tasks.try_dequeue(task))
 	{
 		//UltraDebug(">EventLoop::Run() | task pending\n");
 		//Execute it
-		task.first(now);
-		//If we had a callback
-		if (task.second.has_value())
-			//Run now
-			task.second.value()(now);
+		task(now);
+		//Release captures now
+		task.Reset();
 		//UltraDebug("<EventLoop::Run() | task run\n");
 	}
 	TRACE_EVENT_END("eventloop");
@@ -894,24 +1682,21 @@ void EventLoop::ProcessTriggers(const std::chrono::milliseconds& now)
 	//Run triggered timers
 	TRACE_EVENT_BEGIN("eventloop", "EventLoop::ProcessTimers");
 	std::vector<TimerImpl::shared> triggered;
-	//Get all timers to process in this lop
-	for (auto it = timers.begin(); it != timers.end(); )
-	{
-		//Check it we are still on the time
-		if (it->first > now)
-			//It is yet to come
-			break;
-		//Get timer
-		triggered.push_back(std::move(it->second));
-		//Remove from the list
-		it = timers.erase(it);
-	}
+	
+	//Get all timers to process in this loop
+	expired.clear();
+	timers.Expire(preciseNow.count(), expired);
+	
+	//Take ownership of them
+	triggered.reserve(expired.size());
+	for (auto entry : expired)
+		triggered.push_back(std::move(static_cast<TimerImpl*>(entry)->self));
 
 	//Now process all timers triggered
-	for (auto timer : triggered)
+	for (auto& timer : triggered)
 	{
 		//Get scheduled time
-		auto scheduled = timer->next;
+		auto scheduled = std::chrono::microseconds(timer->GetDeadline());
 
 		//UltraDebug(">EventLoop::Run() | timer [%s] triggered at ll%u scheduled at %lld\n",timer->GetName().c_str(),now.count(),scheduled.count());
 	
@@ -932,13 +1717,13 @@ void EventLoop::ProcessTriggers(const std::chrono::milliseconds& now)
 		{
 			//UltraDebug("-EventLoop::Run() | timer rescheduled\n");
 			//Set next
-			timer->next = scheduled + timer->repeat;
+			auto next = scheduled + timer->repeat;
 			//If the event loop has frozen and the next one is still in the past
-			if (timer->next<now)
+			if (next<preciseNow)
 				//Set it to the next one in the future
-				timer->next = timer->next + std::chrono::duration_cast<std::chrono::milliseconds>(std::ceil((now - timer->next) / timer->repeat) * timer->repeat);
+				next += ((preciseNow - next) / timer->repeat + 1) * timer->repeat;
 			//Schedule
-			timers.emplace(timer->next, timer);
+			ScheduleTimer(timer, next);
 		}
 		//UltraDebug("<EventLoop::Run() | timer run \n");
 	}
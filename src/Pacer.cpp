@@ -0,0 +1,186 @@
+#include "Pacer.h"
+#include "log.h"
+
+#include <algorithm>
+#include <limits>
+
+//IP + UDP + RTP fixed header, extensions and SRTP auth tag are close to this too
+constexpr DWORD PacketOverhead = 28 + 12 + 16;
+
+Pacer::Pacer() :
+	delays(1000)
+{
+}
+
+DWORD Pacer::GetPacketSize(const RTPPacket::shared& packet)
+{
+	return packet->GetMediaLength() + PacketOverhead;
+}
+
+void Pacer::SetTargetBitrate(DWORD bitrate)
+{
+	//Update pacing rate, budget is kept
+	pacingBitrate = static_cast<DWORD>(bitrate * pacingFactor);
+}
+
+void Pacer::Enqueue(DWORD ssrc, const RTPPacket::shared& packet, QWORD now)
+{
+	//Get queue for the group
+	auto& queue = queues[ssrc];
+
+	//Audio packets skip ahead of video ones
+	if (packet->GetMediaType()==MediaFrame::Audio && !queue.audio)
+	{
+		queue.audio = true;
+		queuedAudio += queue.packets.size();
+	}
+
+	//Queue it
+	queue.packets.push_back({packet, now});
+
+	//Update counters
+	queuedPackets++;
+	queuedBytes += GetPacketSize(packet);
+	if (queue.audio)
+		queuedAudio++;
+}
+
+void Pacer::Refill(QWORD now)
+{
+	//First time
+	if (!last || now<last)
+		last = now;
+
+	//Add budget for the elapsed time
+	budget += static_cast<int64_t>((now - last) * pacingBitrate / 1000000);
+	last = now;
+
+	//Don't accumulate more than a short burst while idle
+	budget = std::min<int64_t>(budget, static_cast<int64_t>(MaxBurst * pacingBitrate / 1000000));
+}
+
+std::map<DWORD,Pacer::Queue>::iterator Pacer::Next()
+{
+	//Audio first
+	if (queuedAudio)
+		for (auto it = queues.begin(); it!=queues.end(); ++it)
+			if (it->second.audio && !it->second.packets.empty())
+				return it;
+
+	//Round robin on the rest, starting after last served group
+	auto start = queues.upper_bound(lastServed);
+	for (auto it = start; it!=queues.end(); ++it)
+		if (!it->second.packets.empty())
+			return it;
+	for (auto it = queues.begin(); it!=start; ++it)
+		if (!it->second.packets.empty())
+			return it;
+
+	return queues.end();
+}
+
+RTPPacket::shared Pacer::Dequeue(QWORD now)
+{
+	//Nothing to send
+	if (IsEmpty())
+		return nullptr;
+
+	//Update budget
+	Refill(now);
+
+	//Check if we can send now, unpaced if no bitrate or packets have been waiting for too long
+	if (pacingBitrate && budget<0 && now<GetOldestEnqueued()+maxQueueDelay)
+		return nullptr;
+
+	//Get next queue to serve
+	auto it = Next();
+	auto& [ssrc, queue] = *it;
+
+	//Get first packet
+	Entry entry = std::move(queue.packets.front());
+	queue.packets.pop_front();
+	lastServed = ssrc;
+
+	//Update counters
+	DWORD size = GetPacketSize(entry.packet);
+	queuedPackets--;
+	queuedBytes -= size;
+	if (queue.audio)
+		queuedAudio--;
+
+	//Consume budget
+	if (pacingBitrate)
+		budget -= size * 8;
+
+	//Update delay stats
+	delays.Update(now/1000, now - entry.enqueued);
+
+	return entry.packet;
+}
+
+void Pacer::Remove(DWORD ssrc)
+{
+	//Find queue
+	auto it = queues.find(ssrc);
+	if (it==queues.end())
+		return;
+
+	//Update counters
+	for (const auto& entry : it->second.packets)
+		queuedBytes -= GetPacketSize(entry.packet);
+	queuedPackets -= it->second.packets.size();
+	if (it->second.audio)
+		queuedAudio -= it->second.packets.size();
+
+	//Remove it
+	queues.erase(it);
+}
+
+void Pacer::Clear()
+{
+	queues.clear();
+	queuedPackets = 0;
+	queuedBytes = 0;
+	queuedAudio = 0;
+	budget = 0;
+}
+
+QWORD Pacer::GetOldestEnqueued() const
+{
+	QWORD oldest = std::numeric_limits<QWORD>::max();
+	for (const auto& [ssrc, queue] : queues)
+		if (!queue.packets.empty())
+			oldest = std::min(oldest, queue.packets.front().enqueued);
+	return oldest;
+}
+
+QWORD Pacer::GetNextSendTime(QWORD now) const
+{
+	//If we can send right now
+	if (!pacingBitrate || budget>=0)
+		return now;
+
+	//Time to pay the debt, rounded up, or the time the oldest packet expires
+	QWORD wait = (static_cast<QWORD>(-budget) * 1000000 + pacingBitrate - 1) / pacingBitrate;
+	QWORD next = last + wait;
+	QWORD expire = GetOldestEnqueued() + maxQueueDelay;
+
+	return std::max(now, std::min(next, expire));
+}
+
+Pacer::Stats Pacer::GetStats(QWORD now)
+{
+	Stats stats;
+
+	//Roll delay window
+	delays.Update(now/1000);
+
+	stats.queuedPackets	= queuedPackets;
+	stats.queuedBytes	= queuedBytes;
+	stats.queueDelay	= queuedPackets ? now - std::min(now, GetOldestEnqueued()) : 0;
+	stats.avgQueueDelay	= static_cast<QWORD>(delays.GetInstantMedia());
+	stats.maxQueueDelay	= delays.GetMaxValueInWindow();
+	stats.pacingBitrate	= pacingBitrate;
+
+	return stats;
+}
@@ -161,6 +161,17 @@ RTPBundleTransport::Connection::shared RTPBundleTransport::AddICETransport(const
 	//If we need to disable it
 	if (disableREMB) transport->DisableREMB(disableREMB);
 	
+	//Serialized rtx cache per outgoing group, disabled by default
+	transport->SetRTXSerializedCacheSize(properties.GetProperty("rtx.serializedCacheSize", 0));
+
+	//Pace outgoing media on the transport event loop, disabled by default
+	if (properties.GetProperty("pacer.enabled", false))
+		transport->EnablePacing(true);
+
+	//Send media from per group header templates, disabled by default
+	if (properties.GetProperty("rtp.headerTemplates", false))
+		transport->EnableHeaderTemplates(true);
+	
 	
 	//Set remote DTLS 
 	transport->SetRemoteCryptoDTLS(dtls.GetProperty("setup"),dtls.GetProperty("hash"),dtls.GetProperty("fingerprint"));
@@ -174,6 +185,9 @@ RTPBundleTransport::Connection::shared RTPBundleTransport::AddICETransport(const
 		connections[username] = connection;
 		//Start it
 		transport->Start();
+		//Start sending keepalives
+		if (!connection->disableSTUNKeepAlive)
+			ScheduleKeepAlive(connection);
 	});
 	
 	//OK
@@ -206,6 +220,10 @@ int RTPBundleTransport::RemoveICETransport(const std::string &username)
 		//Stop transport first, to prevent using active candidate after it is deleted afterwards
 		connection->transport->Stop();
 
+		//No more keepalives
+		if (connection->keepAliveTimer)
+			connection->keepAliveTimer->Cancel();
+
 		//REmove connection
 		connections.erase(connectionIterator);
 
@@ -214,8 +232,11 @@ int RTPBundleTransport::RemoveICETransport(const std::string &username)
 		{
 			//Get candidate object
 			ICERemoteCandidate* candidate = *candidatesIterator;
+			//Notify router
+			if (router)
+				router->OnCandidateRemoved(this, candidate->GetIPAddress(), candidate->GetPort());
 			//Remove from all candidates list
-			candidates.erase(candidate->GetRemoteAddress());
+			candidates.erase(candidate->GetRemoteKey());
 		}
 	});
 
@@ -306,6 +327,13 @@ int RTPBundleTransport::Init()
 
 		//Create new sockets
 		socket = ::socket(PF_INET,SOCK_DGRAM,0);
+		//If sharing port with other transports
+		if (reusePort)
+		{
+			int reuse = 1;
+			//Allow binding other sockets to same port
+			(void)setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+		}
 		//Get random
 		port = (RTPTransport::GetMinPort()+(RTPTransport::GetMaxPort()-RTPTransport::GetMinPort())*double(rand()/double(RAND_MAX)));
 		//Try to bind to port
@@ -393,6 +421,13 @@ int RTPBundleTransport::Init(int port)
 
 	//Create new sockets
 	socket = ::socket(PF_INET,SOCK_DGRAM,0);
+	//If sharing port with other transports
+	if (reusePort)
+	{
+		int reuse = 1;
+		//Allow binding other sockets to same port
+		(void)setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+	}
 	//Try to bind to port
 	recAddr.sin_port = htons(port);
 	//Bind the rtp socket
@@ -469,9 +504,9 @@ int RTPBundleTransport::End()
 	return 1;
 }
 
-int RTPBundleTransport::Send(const ICERemoteCandidate* candidate, Packet&& buffer, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback)
+int RTPBundleTransport::Send(const ICERemoteCandidate* candidate, Packet&& buffer, const std::optional<std::function<void(std::chrono::milliseconds)>>& callback, EventLoop::Priority priority)
 {
-	loop.Send(candidate->GetIPAddress(),candidate->GetPort(),std::move(buffer),candidate->GetRawTxData(), callback);
+	loop.Send(candidate->GetIPAddress(),candidate->GetPort(),std::move(buffer),candidate->GetRawTxData(), callback, priority);
 	return 1;
 }
 
@@ -479,10 +514,10 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 {
 	TRACE_EVENT("transport", "RTPBundleTransport::OnRead", "ip", ip, "port", port, "size", size);
 
-	//Get remote ip:port address
-	std::string remote = ICERemoteCandidate::GetRemoteAddress(ip,port);
+	//Get remote ip:port key
+	uint64_t remote = ICERemoteCandidate::GetRemoteKey(ip,port);
 	
-	//UltraDebug("-RTPBundleTransport::OnRead() | [remote:%s,size:%u]\n",remote.c_str(),size);
+	//UltraDebug("-RTPBundleTransport::OnRead() | [remote:%s,size:%u]\n",ICERemoteCandidate::GetRemoteAddress(ip,port).c_str(),size);
 			
 	//Check if it looks like a STUN message
 	if (STUNMessage::IsSTUN(data,size))
@@ -491,11 +526,11 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 
 		//UltraDebug("-RTPBundleTransport::OnRead() | stun\n");
 		
-		//Parse it
-		auto stun = std::unique_ptr<STUNMessage>(STUNMessage::Parse(data,size));
+		//Validate it in place
+		STUNMessage::View stun;
 
 		//It was not a valid STUN message
-		if (!stun)
+		if (!stun.Parse(data,size))
 		{
 			//Error
 			Error("-RTPBundleTransport::Read() | failed to parse STUN message\n");
@@ -503,8 +538,8 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 			return;
 		}
 
-		STUNMessage::Type type = stun->GetType();
-		STUNMessage::Method method = stun->GetMethod();
+		STUNMessage::Type type = stun.GetType();
+		STUNMessage::Method method = stun.GetMethod();
 
 		//If it is a request
 		if (type==STUNMessage::Request && method==STUNMessage::Binding)
@@ -512,7 +547,7 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 			//UltraDebug("-RTPBundleTransport::OnRead() | Binding request\n");
 			
 			//Check if it has the prio attribute
-			if (!stun->HasAttribute(STUNMessage::Attribute::Username))
+			if (!stun.HasUsername())
 			{
 				//Error
 				Debug("-RTPBundleTransport::Read() | STUN Message without username attribute\n");
@@ -520,11 +555,8 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 				return;
 			}
 			
-			//Get username
-			STUNMessage::Attribute* attr = stun->GetAttribute(STUNMessage::Attribute::Username);
-			
-			//Copy username string
-			std::string username((char*)attr->attr,attr->size);
+			//Get username, without copying it
+			std::string_view username = stun.GetUsername();
 			
 			//Check if we have an ICE transport for that username
 			auto it = connections.find(username);
@@ -532,9 +564,13 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 			//If not found
 			if (it==connections.end())
 			{
+				//Check if it belongs to another transport sharing the port
+				if (Route(username,data,size,ip,port))
+					//Done
+					return;
 				//TODO: Reject
 				//Error
-				Debug("-RTPBundleTransport::Read() | ICE username not found [%s}\n",username.c_str());
+				Debug("-RTPBundleTransport::Read() | ICE username not found [%.*s}\n",(int)username.size(),username.data());
 				//Done
 				return;
 			}
@@ -543,8 +579,11 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 			auto connection = it->second;
 			auto transport = connection->transport;
 			
+			//Update cached key, only recomputed on ice restarts
+			connection->localKey.SetPassword(transport->GetLocalPwd());
+			
 			//Authenticate request with remote username
-			if (!stun->CheckAuthenticatedFingerPrint(data,size,transport->GetLocalPwd()))
+			if (!stun.CheckMessageIntegrity(connection->localKey))
 			{
 				//Error
 				Error("-RTPBundleTransport::Read() | STUN Message request failed authentication [pwd:%s]\n",transport->GetLocalPwd());
@@ -556,7 +595,7 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 			connection->iceRequestsReceived++;
 
 			//Check if it has the prio attribute
-			if (!stun->HasAttribute(STUNMessage::Attribute::Priority))
+			if (!stun.HasPriority())
 			{
 				//Error
 				Debug("-RTPBundleTransport::Read() | STUN Message without priority attribute\n");
@@ -564,42 +603,41 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 				return;
 			}
 			
-			//Get attribute
-			STUNMessage::Attribute* priority = stun->GetAttribute(STUNMessage::Attribute::Priority);
-			
 			//Get prio
-			DWORD prio = priority ? get4(priority->attr,0) : 0;
+			DWORD prio = stun.GetPriority();
 			
 			//Find candidate or try to create one if not present
-			auto [itc, inserted] = candidates.try_emplace(remote,ip,port,transport);
+			auto [itc, inserted] = candidates.try_emplace(remote);
+			
+			//If it was not present
+			if (inserted)
+				//Create it
+				*itc = std::make_unique<ICERemoteCandidate>(ip,port,transport);
 			
 			//Get candidate
-			ICERemoteCandidate* candidate = &itc->second;
+			ICERemoteCandidate* candidate = itc->get();
 			
 			//Check if it is not already present
 			if (inserted)
 			{
-				Log("-RTPBundleTransport::Read() | Got new remote ICE candidate [remote:%s]\n",remote.c_str());
+				Log("-RTPBundleTransport::Read() | Got new remote ICE candidate [remote:%s]\n",candidate->GetRemoteAddress().c_str());
 				//Add it to the connection
 				connection->candidates.insert(candidate);
+				//Notify router
+				if (router)
+					router->OnCandidateAdded(this,ip,port);
 				//Send back an ice request
 				SendBindingRequest(connection, candidate);
 			}
 			
 			//Set it active
-			transport->ActivateRemoteCandidate(candidate,stun->HasAttribute(STUNMessage::Attribute::UseCandidate),prio);
-			
-			//Create response
-			auto resp = std::unique_ptr<STUNMessage>(stun->CreateResponse());
-			
-			//Add received xor mapped addres
-			resp->AddXorAddressAttribute(htonl(ip),htons(port));
+			transport->ActivateRemoteCandidate(candidate,stun.HasUseCandidate(),prio);
 			
 			//Create new mesage
 			Packet buffer = loop.GetPacketPool().pick();
 		
-			//Serialize and autenticate
-			size_t len = resp->AuthenticatedFingerPrint(buffer.GetData(),buffer.GetCapacity(),transport->GetLocalPwd());
+			//Serialize and autenticate response with the received xor mapped address
+			size_t len = STUNMessage::SerializeBindingResponse(stun,ip,port,connection->localKey,buffer.GetData(),buffer.GetCapacity());
 			
 			//resize
 			buffer.SetSize(len);
@@ -613,8 +651,8 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 		} else if (type==STUNMessage::Response && method==STUNMessage::Binding) {
 			
 			//Get ts and id
-			uint32_t id = get4(stun->GetTransactionId(),0);
-			uint64_t ts = get8(stun->GetTransactionId(),4);
+			uint32_t id = get4(stun.GetTransactionId(),0);
+			uint64_t ts = get8(stun.GetTransactionId(),4);
 
 			//UltraDebug("-RTPBundleTransport::OnRead() | Binding response [id:%u,ts:%llu]\n", id, ts);
 			
@@ -624,6 +662,10 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 			//If not found
 			if (transactionIterator==transactions.end())
 			{
+				//Check if it belongs to another transport sharing the port
+				if (Route({},data,size,ip,port))
+					//Done
+					return;
 				//Error
 				Debug("-RTPBundleTransport::Read() | transaction not found [id:%u,ts:%llu]",id,ts);
 				//Done
@@ -655,18 +697,21 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 			auto candidateIterator = candidates.find(remote);
 			
 			//Check we have it
-			if (candidateIterator==candidates.end())
+			if (!candidateIterator)
 			{
 				//Error
-				Debug("-RTPBundleTransport::Read() | remote candidate not found for response [remote:%s]}\n",remote.c_str());
+				Debug("-RTPBundleTransport::Read() | remote candidate not found for response [remote:%s]}\n",ICERemoteCandidate::GetRemoteAddress(ip,port).c_str());
 				return;
 			}
 		
 			//Get it
-			ICERemoteCandidate* candidate = &candidateIterator->second;
+			ICERemoteCandidate* candidate = candidateIterator->get();
+			
+			//Update cached key, only recomputed on ice restarts
+			connection->remoteKey.SetPassword(transport->GetRemotePwd());
 			
 			//Authenticate request with remote username
-			if (!stun->CheckAuthenticatedFingerPrint(data,size,transport->GetRemotePwd()))
+			if (!stun.CheckMessageIntegrity(connection->remoteKey))
 			{
 				//Error
 				Error("-RTPBundleTransport::Read() | STUN Message response failed authentication [pwd:%s]\n",transport->GetRemotePwd());
@@ -674,14 +719,11 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 				return;
 			}
 
-			//Get attribute
-			STUNMessage::Attribute* priority = stun->GetAttribute(STUNMessage::Attribute::Priority);
-
 			//Get prio
-			DWORD prio = priority ? get4(priority->attr,0) : 0;
+			DWORD prio = stun.GetPriority();
 
 			//Set it active
-			transport->ActivateRemoteCandidate(candidate,stun->HasAttribute(STUNMessage::Attribute::UseCandidate),prio);
+			transport->ActivateRemoteCandidate(candidate,stun.HasUseCandidate(),prio);
 			
 			//Set state
 			candidate->SetState(ICERemoteCandidate::Connected);
@@ -699,16 +741,123 @@ void RTPBundleTransport::OnRead(const int fd, const uint8_t* data, const size_t
 	auto it = candidates.find(remote);
 	
 	//Check if it was not registered
-	if (it==candidates.end())
+	if (!it)
 	{
+		//Check if it belongs to another transport sharing the port
+		if (Route({},data,size,ip,port))
+			//Done
+			return;
 		//Error
-		Debug("-RTPBundleTransport::Read() | No registered ICE candidate for [%s]\n",remote.c_str());
+		Debug("-RTPBundleTransport::Read() | No registered ICE candidate for [%s]\n",ICERemoteCandidate::GetRemoteAddress(ip,port).c_str());
 		//DOne
 		return;
 	}
 	
 	//Send data on ice transport
-	it->second.onData(data,size);
+	(*it)->onData(data,size);
+}
+
+void RTPBundleTransport::OnReadPayload(const int fd, RTPPayload::shared&& payload, const uint32_t ip, const uint16_t port)
+{
+	//STUN messages are not kept, handle them on the normal path
+	if (STUNMessage::IsSTUN(payload->GetMediaData(),payload->GetMediaLength()))
+		return OnRead(fd,payload->GetMediaData(),payload->GetMediaLength(),ip,port);
+	
+	TRACE_EVENT("transport", "RTPBundleTransport::OnReadPayload", "ip", ip, "port", port, "size", payload->GetMediaLength());
+	
+	//Find candidate
+	auto it = candidates.find(ICERemoteCandidate::GetRemoteKey(ip,port));
+	
+	//Check if it was not registered
+	if (!it)
+	{
+		//Check if it belongs to another transport sharing the port
+		if (auto owner = router ? router->OnUnknown(this,{},ip,port) : nullptr)
+		{
+			//Hand it over without copying it
+			owner->Deliver(std::move(payload),ip,port);
+			//Done
+			return;
+		}
+		//Error
+		Debug("-RTPBundleTransport::Read() | No registered ICE candidate for [%s]\n",ICERemoteCandidate::GetRemoteAddress(ip,port).c_str());
+		//DOne
+		return;
+	}
+	
+	//Send payload to ice transport without copying it
+	(*it)->onData(std::move(payload));
+}
+
+void RTPBundleTransport::OnReadPayloads(const int fd, EventLoop::Datagram* datagrams, const size_t count)
+{
+	TRACE_EVENT("transport", "RTPBundleTransport::OnReadPayloads", "count", count);
+	
+	for (size_t i = 0; i < count; )
+	{
+		auto& datagram = datagrams[i];
+		
+		//Find candidate, STUN and unknown ones are handled one by one
+		auto it = !STUNMessage::IsSTUN(datagram.payload->GetMediaData(),datagram.payload->GetMediaLength())
+			? candidates.find(ICERemoteCandidate::GetRemoteKey(datagram.ipAddr,datagram.port))
+			: nullptr;
+		if (!it)
+		{
+			OnReadPayload(fd,std::move(datagram.payload),datagram.ipAddr,datagram.port);
+			i++;
+			continue;
+		}
+		
+		//Get consecutive datagrams from same remote
+		size_t run = 0;
+		for (size_t j = i; j < count && run < batch.size(); ++j, ++run)
+		{
+			auto& next = datagrams[j];
+			if (next.ipAddr!=datagram.ipAddr || next.port!=datagram.port || STUNMessage::IsSTUN(next.payload->GetMediaData(),next.payload->GetMediaLength()))
+				break;
+			batch[run] = std::move(next.payload);
+		}
+		
+		//Send them to ice transport together
+		(*it)->onData(batch.data(),run);
+		
+		//Return the ones not kept so they can be reused for reading
+		for (size_t j = 0; j < run; ++j)
+			datagrams[i + j].payload = std::move(batch[j]);
+		
+		i += run;
+	}
+}
+
+void RTPBundleTransport::Deliver(RTPPayload::shared&& payload, const uint32_t ip, const uint16_t port)
+{
+	//Move payload to our loop, it is returned to the pool once processed
+	loop.Async([=,payload = std::move(payload)](auto now) mutable {
+		//Process it as if it was received on our socket
+		OnReadPayload(socket,std::move(payload),ip,port);
+	});
+}
+
+bool RTPBundleTransport::Route(std::string_view username, const uint8_t* data, const size_t size, const uint32_t ip, const uint16_t port)
+{
+	//Find the transport sharing the port that owns it
+	auto owner = router ? router->OnUnknown(this,username,ip,port) : nullptr;
+	
+	//Check
+	if (!owner)
+		return false;
+	
+	//Data is only valid while reading, copy it to a pooled payload
+	auto payload = RTPPacket::PayloadPool.allocate();
+	
+	//Check size
+	if (!payload->SetPayload(data,size))
+		return false;
+	
+	//Hand it over
+	owner->Deliver(std::move(payload),ip,port);
+	
+	return true;
 }
 
 void RTPBundleTransport::SetCandidateRawTxData(const std::string& ip, uint16_t port, uint32_t selfAddr, const std::string& dstLladdr)
@@ -717,15 +866,15 @@ void RTPBundleTransport::SetCandidateRawTxData(const std::string& ip, uint16_t p
 	loop.Async([=](auto now){
 		std::string remote = ip + ":" + std::to_string(port);
 
-		auto it = candidates.find(remote);
-		if (it == candidates.end())
+		auto it = candidates.find(ICERemoteCandidate::GetRemoteKey(ntohl(inet_addr(ip.c_str())),port));
+		if (!it)
 		{
 			Error("-RTPBundleTransport::SetCandidateRawTxData() | candidate not found [remote:%s}\n", remote.c_str());
 			return;
 		}
 
 		printf("setting candidate %s data\n", remote.c_str());
-		it->second.SetRawTxData(rawTxData);
+		(*it)->SetRawTxData(rawTxData);
 	});
 }
 
@@ -755,19 +904,29 @@ int RTPBundleTransport::AddRemoteCandidate(const std::string& username,const cha
 		auto connection = it->second;
 		auto transport = connection->transport;
 		
-		//Get remote ip:port address
-		std::string remote = ip + ":" + std::to_string(port);
+		//Get remote ip:port key
+		uint64_t remote = ICERemoteCandidate::GetRemoteKey(ntohl(inet_addr(ip.c_str())),port);
 		
 		//Create new candidate if it is not already present
-		auto [itc, inserted] = candidates.try_emplace(remote,ip,port,transport);
+		auto [itc, inserted] = candidates.try_emplace(remote);
+		
+		//If it was not present
+		if (inserted)
+			//Create it
+			*itc = std::make_unique<ICERemoteCandidate>(ip,port,transport);
 		
 		//Get candidate
-		ICERemoteCandidate* candidate = &itc->second;
+		ICERemoteCandidate* candidate = itc->get();
 	
 		//If it was new
 		if (inserted)
+		{
 			//Add candidate and add it to the connection
 			connection->candidates.insert(candidate);
+			//Notify router
+			if (router)
+				router->OnCandidateAdded(this,candidate->GetIPAddress(),candidate->GetPort());
+		}
 
 		//Send binding request in any case
 		SendBindingRequest(connection,candidate);
@@ -807,7 +966,7 @@ void RTPBundleTransport::SendBindingRequest(Connection::shared connection,ICERem
 	set8(transId,4,ts);
 	
 	//Add to outgoing transactions
-	transactions[{ts,id}] = {connection->username,candidate->GetRemoteAddress()};
+	transactions[{ts,id}] = {connection->username,candidate->GetRemoteKey()};
 				
 	//Create binding request to send back
 	auto request = std::make_unique<STUNMessage>(STUNMessage::Request,STUNMessage::Binding,transId);
@@ -821,8 +980,11 @@ void RTPBundleTransport::SendBindingRequest(Connection::shared connection,ICERem
 	//Create new mesage
 	Packet buffer = loop.GetPacketPool().pick();
 
+	//Update cached key, only recomputed on ice restarts
+	connection->remoteKey.SetPassword(transport->GetRemotePwd());
+
 	//Serialize and autenticate
-	size_t len = request->AuthenticatedFingerPrint(buffer.GetData(),buffer.GetCapacity(),transport->GetRemotePwd());
+	size_t len = request->AuthenticatedFingerPrint(buffer.GetData(),buffer.GetCapacity(),connection->remoteKey);
 
 	//resize
 	buffer.SetSize(len);
@@ -882,35 +1044,55 @@ void RTPBundleTransport::onTimer(std::chrono::milliseconds now)
 		auto candidateIterator = candidates.find(remote);
 			
 		//Check we have it
-		if (candidateIterator==candidates.end())
+		if (!candidateIterator)
 			continue;
 		
 		//Get it
-		ICERemoteCandidate* candidate = &candidateIterator->second;
+		ICERemoteCandidate* candidate = candidateIterator->get();
 		
 		//Check again
 		SendBindingRequest(connection,candidate);
 	}
+}
 
-
-	//Keepalive all the connections 
-	for (auto& [username, connection] : connections)
+void RTPBundleTransport::ScheduleKeepAlive(const Connection::shared& connection)
+{
+	//Create timer on first use, it must not keep the connection alive
+	if (!connection->keepAliveTimer)
 	{
-		//If it is disabled
-		if (connection->disableSTUNKeepAlive)
-			//Skip
-			continue;
+		connection->keepAliveTimer = loop.CreateTimer([this,weak = std::weak_ptr<Connection>(connection)](std::chrono::milliseconds now){
+			//If connection still alive
+			if (auto connection = weak.lock())
+				this->onKeepAlive(connection);
+		});
+		//Set name for debug
+		connection->keepAliveTimer->SetName("RTPBundleTransport - keepalive");
+	}
 
-		//If there is an outgoing transaction already
-		if (connection->lastKeepAliveRequestSent>connection->lastKeepAliveRequestReceived)
-			//Skip
-			continue;
-		//Get active candidate
-		auto active = connection->transport->GetActiveRemoteCandidate();
+	//Randomize interval between 0.8 and 1.2 of the ice timeout so connections created together do not send keepalives in bursts
+	auto interval = std::chrono::milliseconds((uint64_t)(iceTimeout.count() * (0.8 + 0.4 * rand() / (double)RAND_MAX)));
 
-		//If we have an active remote candidate
-		if (active)
-			//Keep alive
-			SendBindingRequest(connection, active);
-	}
+	//Schedule next one
+	connection->keepAliveTimer->Again(interval);
+}
+
+void RTPBundleTransport::onKeepAlive(const Connection::shared& connection)
+{
+	TRACE_EVENT("transport", "RTPBundleTransport::onKeepAlive");
+
+	//Schedule next one first
+	ScheduleKeepAlive(connection);
+
+	//If there is an outgoing transaction already
+	if (connection->lastKeepAliveRequestSent>connection->lastKeepAliveRequestReceived)
+		//Skip
+		return;
+
+	//Get active candidate
+	auto active = connection->transport->GetActiveRemoteCandidate();
+
+	//If we have an active remote candidate
+	if (active)
+		//Keep alive
+		SendBindingRequest(connection, active);
 }
@@ -180,4 +180,50 @@ size_t SRTPSession::UnprotectRTCP(uint8_t* data, size_t size)
 	return err == Status::OK && len > 0 ? static_cast<size_t>(len) : 0;
 }
 
+size_t SRTPSession::ProtectRTP(Span* packets, size_t count)
+{
+	TRACE_EVENT("srtp", "SRTPSession::ProtectRTP", "count", count);
+	size_t processed = 0;
+	Status status = Status::OK;
+	//Encrypt all of them while the session keys are hot on cache
+	for (size_t i = 0; i < count; ++i)
+	{
+		int len = packets[i].size;
+		err = (Status)srtp_protect(srtp,packets[i].data,&len);
+		//Keep first error
+		if (err!=Status::OK && status==Status::OK)
+			status = err;
+		//Set new size
+		packets[i].size = err==Status::OK && len>0 ? static_cast<size_t>(len) : 0;
+		//Count ok ones
+		if (packets[i].size)
+			processed++;
+	}
+	//Report first error
+	err = status;
+	return processed;
+}
 
+size_t SRTPSession::UnprotectRTP(Span* packets, size_t count)
+{
+	TRACE_EVENT("srtp", "SRTPSession::UnprotectRTP", "count", count);
+	size_t processed = 0;
+	Status status = Status::OK;
+	//Decrypt all of them back to back
+	for (size_t i = 0; i < count; ++i)
+	{
+		int len = packets[i].size;
+		err = (Status)srtp_unprotect(srtp,packets[i].data,&len);
+		//Keep first error
+		if (err!=Status::OK && status==Status::OK)
+			status = err;
+		//Set new size
+		packets[i].size = err==Status::OK && len>0 ? static_cast<size_t>(len) : 0;
+		//Count ok ones
+		if (packets[i].size)
+			processed++;
+	}
+	//Report first error
+	err = status;
+	return processed;
+}
@@ -1,6 +1,7 @@
 #include <sys/stat.h> 
 #include <fcntl.h>
 #include <cmath>
+#include <algorithm>
 #include "SendSideBandwidthEstimation.h"
 
 constexpr uint64_t kInitialDuration		= 500E3;	// 500ms
@@ -69,12 +70,13 @@ void SendSideBandwidthEstimation::SentPacket(const PacketStats& stat)
 		mediaSentAcumulator.Update(stat.time,stat.size);
 	}
 	
-	//Add to history map
-	if (!transportWideSentPacketsStats.Set(stat.transportWideSeqNum, SendSideBandwidthEstimation::Stats{stat.time, stat.size, stat.mark, stat.rtx, stat.probing}))
-		Warning("-SendSideBandwidthEstimation::SentPacket() Could not store stats for packet %u\n", stat.transportWideSeqNum);
+	//Add to history, overwriting the one sent HistorySize packets ago
+	uint16_t transportSeqNum = stat.transportWideSeqNum;
+	transportWideSentPacketsStats[transportSeqNum % HistorySize] = Stats{stat.time, static_cast<uint16_t>(std::min<uint32_t>(stat.size, 0xFFFF)), transportSeqNum, stat.mark, stat.rtx, stat.probing};
+	lastSentTransportSeqNum = transportSeqNum;
 }
 
-void SendSideBandwidthEstimation::ReceivedFeedback(uint8_t feedbackNum, const std::map<uint32_t,uint64_t>& packets, uint64_t when)
+void SendSideBandwidthEstimation::ReceivedFeedback(uint8_t feedbackNum, const ReceivedPacket* packets, size_t count, uint64_t when)
 {
 	//Extend seq num
 	feedbackNumExtender.Extend(feedbackNum);
@@ -97,14 +99,14 @@ void SendSideBandwidthEstimation::ReceivedFeedback(uint8_t feedbackNum, const st
 	lastFeedbackDelta = 0;
 
 	//Check we have packets
-	if (packets.empty())
+	if (!count)
 		//Skip
 		return;
 	
 	//Get last packets stats
-	auto last = transportWideSentPacketsStats.Get(packets.rbegin()->first);
+	auto last = GetSentPacket(packets[count-1].first);
 	//We can use the difference between the last send packet time and the reception of the fb packet as proxy of the rtt min 
-	if (last.has_value())
+	if (last)
 	{
 		//Get sent time
 		const auto sentTime = last->time;
@@ -120,18 +122,19 @@ void SendSideBandwidthEstimation::ReceivedFeedback(uint8_t feedbackNum, const st
 	}
 
 	//For each packet
-	for (const auto& feedback : packets)
+	for (size_t i = 0; i<count; ++i)
 	{
+		const auto& feedback = packets[i];
 		//We need to wrap the sequence number as the rtcp reports calculates it as base+counter
 		// which is required to be able to retrieve the packets in increasing order her
 		uint16_t transportSeqNum	= static_cast<uint16_t>(feedback.first);
 		uint64_t receivedTime		= feedback.second; 
 
 		//Get packet
-		auto stat = transportWideSentPacketsStats.Get(transportSeqNum);
+		auto stat = GetSentPacket(transportSeqNum);
 		
 		//If found
-		if (stat.has_value())
+		if (stat)
 		{
 			//Get sent time
 			const auto sentTime = stat->time;
@@ -213,7 +216,7 @@ void SendSideBandwidthEstimation::ReceivedFeedback(uint8_t feedbackNum, const st
 			}
 		} else {
 			//Log
-			Warning("-SendSideBandwidthEstimation::ReceivedFeedback() | Packet not found [transportSeqNum:%u,receivedTime:%llu,first:%u,last:%u]\n", transportSeqNum, receivedTime, transportWideSentPacketsStats.GetFirstSeq(), transportWideSentPacketsStats.GetLastSeq());
+			Warning("-SendSideBandwidthEstimation::ReceivedFeedback() | Packet not found [transportSeqNum:%u,receivedTime:%llu,last:%u]\n", transportSeqNum, receivedTime, lastSentTransportSeqNum);
 		}
 	}
 
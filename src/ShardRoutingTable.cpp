@@ -0,0 +1,200 @@
+#include <algorithm>
+#include "ShardRoutingTable.h"
+#include "ICERemoteCandidate.h"
+
+ShardRoutingTable::ShardRoutingTable(uint32_t shards) :
+	load(std::max(shards,1u),0),
+	snapshots(std::max(shards,1u))
+{
+	//Start empty
+	routes.owners	= std::make_shared<const Owners>();
+	routes.remotes	= std::make_shared<const Remotes>();
+}
+
+uint32_t ShardRoutingTable::AddOwner(const std::string& username)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//Get least loaded shard
+	uint32_t shard = std::min_element(load.begin(), load.end()) - load.begin();
+
+	//Set owner
+	auto owners = std::make_shared<Owners>(*routes.owners);
+	(*owners)[username] = shard;
+	routes.owners = std::move(owners);
+	load[shard]++;
+
+	//Make it visible to shards
+	Publish();
+
+	return shard;
+}
+
+std::optional<uint32_t> ShardRoutingTable::RestartOwner(const std::string& username, const std::string& restarted)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//Find owner
+	auto it = routes.owners->find(username);
+
+	//Check
+	if (it==routes.owners->end())
+		return std::nullopt;
+
+	//Get shard
+	uint32_t shard = it->second;
+
+	//Move to new username
+	auto owners = std::make_shared<Owners>(*routes.owners);
+	owners->erase(username);
+	(*owners)[restarted] = shard;
+	routes.owners = std::move(owners);
+
+	//Make it visible to shards
+	Publish();
+
+	return shard;
+}
+
+std::optional<uint32_t> ShardRoutingTable::RemoveOwner(const std::string& username)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//Find owner
+	auto it = routes.owners->find(username);
+
+	//Check
+	if (it==routes.owners->end())
+		return std::nullopt;
+
+	//Get shard
+	uint32_t shard = it->second;
+
+	//Remove it
+	auto owners = std::make_shared<Owners>(*routes.owners);
+	owners->erase(username);
+	routes.owners = std::move(owners);
+	load[shard]--;
+
+	//Make it visible to shards
+	Publish();
+
+	return shard;
+}
+
+std::optional<uint32_t> ShardRoutingTable::GetOwner(const std::string& username)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//Find owner
+	auto it = routes.owners->find(username);
+
+	//Check
+	if (it==routes.owners->end())
+		return std::nullopt;
+
+	return it->second;
+}
+
+size_t ShardRoutingTable::GetLoad(uint32_t shard)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return shard<load.size() ? load[shard] : 0;
+}
+
+void ShardRoutingTable::AddRemote(uint32_t shard, uint32_t ip, uint16_t port)
+{
+	uint64_t key = ICERemoteCandidate::GetRemoteKey(ip,port);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//Nothing to do if already owned by it
+	auto owner = routes.remotes->find(key);
+	if (owner && *owner==shard)
+		return;
+
+	//Set owner
+	auto remotes = std::make_shared<Remotes>(*routes.remotes);
+	(*remotes)[key] = shard;
+	routes.remotes = std::move(remotes);
+
+	//Make it visible to shards
+	Publish();
+}
+
+bool ShardRoutingTable::RemoveRemote(uint32_t shard, uint32_t ip, uint16_t port)
+{
+	uint64_t key = ICERemoteCandidate::GetRemoteKey(ip,port);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//Only if it was still owned by this shard
+	auto owner = routes.remotes->find(key);
+	if (!owner || *owner!=shard)
+		return false;
+
+	//Remove it
+	auto remotes = std::make_shared<Remotes>(*routes.remotes);
+	remotes->erase(key);
+	routes.remotes = std::move(remotes);
+
+	//Make it visible to shards
+	Publish();
+
+	return true;
+}
+
+std::optional<uint32_t> ShardRoutingTable::Lookup(uint32_t shard, std::string_view username)
+{
+	//Check
+	if (shard>=snapshots.size())
+		return std::nullopt;
+
+	const auto& owners = *GetRoutes(shard).owners;
+
+	//Find connection owner
+	auto it = owners.find(username);
+
+	//Check
+	if (it==owners.end())
+		return std::nullopt;
+
+	return it->second;
+}
+
+std::optional<uint32_t> ShardRoutingTable::Lookup(uint32_t shard, uint32_t ip, uint16_t port)
+{
+	//Check
+	if (shard>=snapshots.size())
+		return std::nullopt;
+
+	//Find remote address owner
+	auto owner = GetRoutes(shard).remotes->find(ICERemoteCandidate::GetRemoteKey(ip,port));
+
+	//Check
+	if (!owner)
+		return std::nullopt;
+
+	return *owner;
+}
+
+const ShardRoutingTable::Routes& ShardRoutingTable::GetRoutes(uint32_t shard)
+{
+	auto& snapshot = snapshots[shard];
+
+	//Refresh it only if there have been changes since last time
+	if (snapshot.version!=version.load(std::memory_order_acquire))
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		snapshot.routes  = routes;
+		snapshot.version = version.load(std::memory_order_relaxed);
+	}
+
+	return snapshot.routes;
+}
+
+void ShardRoutingTable::Publish()
+{
+	//Must be called with the lock held after replacing the tables
+	version.fetch_add(1, std::memory_order_release);
+}
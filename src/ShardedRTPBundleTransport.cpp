@@ -0,0 +1,392 @@
+#include "tracing.h"
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
+#include "log.h"
+#include "ShardedRTPBundleTransport.h"
+
+static void Reset(FileDescriptor& fd, int value)
+{
+	FileDescriptor other(value);
+	swap(fd, other);
+}
+
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_EBPF)
+#include <stddef.h>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+
+static constexpr uint32_t MaxSteeringRoutes = 65536;
+
+//Remote address in network order, as read by the BPF program
+struct RouteKey
+{
+	uint32_t ip;
+	uint16_t port;
+	uint16_t padding;
+};
+
+static int bpf(int cmd, union bpf_attr* attr)
+{
+	return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+static constexpr bpf_insn Instruction(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm)
+{
+	return bpf_insn{code, dst, src, off, imm};
+}
+
+bool ShardedRTPBundleTransport::AttachSteering()
+{
+	union bpf_attr attr;
+
+	//Create socket array with one entry per shard
+	memset(&attr, 0, sizeof(attr));
+	attr.map_type		= BPF_MAP_TYPE_REUSEPORT_SOCKARRAY;
+	attr.key_size		= sizeof(uint32_t);
+	attr.value_size		= sizeof(uint64_t);
+	attr.max_entries	= shards.size();
+	Reset(sockets, bpf(BPF_MAP_CREATE, &attr));
+	if (!sockets.isValid())
+		return Warning("-ShardedRTPBundleTransport::AttachSteering() | could not create socket map [error:%s]\n", strerror(errno));
+
+	//Create remote address to shard routing table
+	memset(&attr, 0, sizeof(attr));
+	attr.map_type		= BPF_MAP_TYPE_LRU_HASH;
+	attr.key_size		= sizeof(RouteKey);
+	attr.value_size		= sizeof(uint32_t);
+	attr.max_entries	= MaxSteeringRoutes;
+	Reset(routes, bpf(BPF_MAP_CREATE, &attr));
+	if (!routes.isValid())
+		return Warning("-ShardedRTPBundleTransport::AttachSteering() | could not create routing map [error:%s]\n", strerror(errno));
+
+	//Select the shard of the remote address if it is known, fallback to kernel hashing otherwise
+	const bpf_insn instructions[] = {
+		//r6 = ctx
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0),
+		//Check udp header is in linear data
+		Instruction(BPF_LDX | BPF_DW | BPF_MEM, BPF_REG_2, BPF_REG_6, offsetof(sk_reuseport_md, data), 0),
+		Instruction(BPF_LDX | BPF_DW | BPF_MEM, BPF_REG_3, BPF_REG_6, offsetof(sk_reuseport_md, data_end), 0),
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0),
+		Instruction(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, 8),
+		Instruction(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 26, 0),
+		//key.port = udp source port, key.padding = 0
+		Instruction(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_7, BPF_REG_2, 0, 0),
+		Instruction(BPF_ST | BPF_DW | BPF_MEM, BPF_REG_10, 0, -8, 0),
+		Instruction(BPF_STX | BPF_H | BPF_MEM, BPF_REG_10, BPF_REG_7, -4, 0),
+		//key.ip = ip source address
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0),
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_2, 0, 0, 12),
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_3, BPF_REG_10, 0, 0),
+		Instruction(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_3, 0, 0, -8),
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_4, 0, 0, 4),
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_5, 0, 0, BPF_HDR_START_NET),
+		Instruction(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_skb_load_bytes_relative),
+		Instruction(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_0, 0, 15, 0),
+		//shard = routes[key]
+		Instruction(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, routes),
+		Instruction(0, 0, 0, 0, 0),
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_10, 0, 0),
+		Instruction(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, -8),
+		Instruction(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem),
+		Instruction(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 9, 0),
+		Instruction(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_1, BPF_REG_0, 0, 0),
+		Instruction(BPF_STX | BPF_W | BPF_MEM, BPF_REG_10, BPF_REG_1, -12, 0),
+		//select sockets[shard]
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0),
+		Instruction(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_2, BPF_PSEUDO_MAP_FD, 0, sockets),
+		Instruction(0, 0, 0, 0, 0),
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_3, BPF_REG_10, 0, 0),
+		Instruction(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_3, 0, 0, -12),
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_4, 0, 0, 0),
+		Instruction(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_sk_select_reuseport),
+		//Pass, kernel hashing is used if no socket was selected
+		Instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, SK_PASS),
+		Instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+	};
+
+	//Load it
+	memset(&attr, 0, sizeof(attr));
+	attr.prog_type	= BPF_PROG_TYPE_SK_REUSEPORT;
+	attr.insns	= (uint64_t)instructions;
+	attr.insn_cnt	= sizeof(instructions)/sizeof(bpf_insn);
+	attr.license	= (uint64_t)"GPL";
+	Reset(program, bpf(BPF_PROG_LOAD, &attr));
+	if (!program.isValid())
+		return Warning("-ShardedRTPBundleTransport::AttachSteering() | could not load program [error:%s]\n", strerror(errno));
+
+	//Add sockets in shard order
+	for (uint32_t i = 0; i<shards.size(); ++i)
+	{
+		uint64_t fd = shards[i]->GetSocket();
+		memset(&attr, 0, sizeof(attr));
+		attr.map_fd	= sockets;
+		attr.key	= (uint64_t)&i;
+		attr.value	= (uint64_t)&fd;
+		if (bpf(BPF_MAP_UPDATE_ELEM, &attr))
+			return Warning("-ShardedRTPBundleTransport::AttachSteering() | could not add socket [shard:%u,error:%s]\n", i, strerror(errno));
+	}
+
+	//Attach it to the reuseport group
+	int fd = program;
+	if (setsockopt(shards[0]->GetSocket(), SOL_SOCKET, SO_ATTACH_REUSEPORT_EBPF, &fd, sizeof(fd)))
+		return Warning("-ShardedRTPBundleTransport::AttachSteering() | could not attach program [error:%s]\n", strerror(errno));
+
+	//Done
+	return true;
+}
+
+void ShardedRTPBundleTransport::Steer(uint32_t ip, uint16_t port, uint32_t shard)
+{
+	if (!steering)
+		return;
+
+	RouteKey key = { htonl(ip), htons(port), 0 };
+	union bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.map_fd	= routes;
+	attr.key	= (uint64_t)&key;
+	attr.value	= (uint64_t)&shard;
+	if (bpf(BPF_MAP_UPDATE_ELEM, &attr))
+		Warning("-ShardedRTPBundleTransport::Steer() | could not add route [shard:%u,error:%s]\n", shard, strerror(errno));
+}
+
+void ShardedRTPBundleTransport::Unsteer(uint32_t ip, uint16_t port)
+{
+	if (!steering)
+		return;
+
+	RouteKey key = { htonl(ip), htons(port), 0 };
+	union bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.map_fd	= routes;
+	attr.key	= (uint64_t)&key;
+	(void)bpf(BPF_MAP_DELETE_ELEM, &attr);
+}
+#else
+bool ShardedRTPBundleTransport::AttachSteering()
+{
+	return Warning("-ShardedRTPBundleTransport::AttachSteering() | reuseport steering is only supported in Linux\n");
+}
+
+void ShardedRTPBundleTransport::Steer(uint32_t ip, uint16_t port, uint32_t shard)
+{
+}
+
+void ShardedRTPBundleTransport::Unsteer(uint32_t ip, uint16_t port)
+{
+}
+#endif
+
+ShardedRTPBundleTransport::ShardedRTPBundleTransport(uint32_t count, uint32_t packetPoolSize) :
+	table(std::max(count,1u))
+{
+	//Create shards
+	for (uint32_t i = 0; i<std::max(count,1u); ++i)
+	{
+		auto shard = std::make_unique<RTPBundleTransport>(packetPoolSize);
+		//All of them listen on the same port
+		shard->SetReusePort(true);
+		//Route packets from remote addresses owned by other shards
+		shard->SetRouter(this);
+		//Add it
+		shards.push_back(std::move(shard));
+	}
+}
+
+ShardedRTPBundleTransport::~ShardedRTPBundleTransport()
+{
+	End();
+}
+
+int ShardedRTPBundleTransport::Init(int port)
+{
+	TRACE_EVENT("transport", "ShardedRTPBundleTransport::Init", "port", port);
+	Log(">ShardedRTPBundleTransport::Init() [port:%d,shards:%zu]\n", port, shards.size());
+
+	//First shard selects the port if not set
+	this->port = shards[0]->Init(port);
+
+	//Check
+	if (!this->port)
+		return Error("-ShardedRTPBundleTransport::Init() | could not open port\n");
+
+	//Rest of shards join the port
+	for (size_t i = 1; i<shards.size(); ++i)
+	{
+		if (!shards[i]->Init(this->port))
+		{
+			//Close all
+			End();
+			//Error
+			return Error("-ShardedRTPBundleTransport::Init() | could not open shard [shard:%zu]\n", i);
+		}
+	}
+
+	//Steer known remote addresses to their shard
+	steering = AttachSteering();
+
+	//Pin each loop and socket to a different cpu
+	unsigned int cpus = std::max(std::thread::hardware_concurrency(), 1u);
+	for (size_t i = 0; i<shards.size(); ++i)
+		shards[i]->SetAffinity(i % cpus);
+
+	Log("<ShardedRTPBundleTransport::Init() [port:%d,steering:%d]\n", this->port, steering);
+
+	//Done
+	return this->port;
+}
+
+int ShardedRTPBundleTransport::End()
+{
+	Log("-ShardedRTPBundleTransport::End()\n");
+
+	//Stop all shards
+	for (auto& shard : shards)
+		shard->End();
+
+	//Release steering program and maps
+	steering = false;
+	Reset(program, -1);
+	Reset(routes, -1);
+	Reset(sockets, -1);
+
+	return 1;
+}
+
+RTPBundleTransport::Connection::shared ShardedRTPBundleTransport::AddICETransport(const std::string &username,const Properties& properties)
+{
+	//Store owner on least loaded shard before packets for it arrive
+	uint32_t shard = table.AddOwner(username);
+
+	//Add it
+	auto connection = shards[shard]->AddICETransport(username, properties);
+
+	//Check
+	if (!connection)
+		//Remove owner
+		table.RemoveOwner(username);
+
+	Debug("-ShardedRTPBundleTransport::AddICETransport() [username:%s,shard:%u]\n", username.c_str(), shard);
+
+	return connection;
+}
+
+bool ShardedRTPBundleTransport::RestartICETransport(const std::string& username, const std::string& restarted, const Properties& properties)
+{
+	//Move owner to new username
+	auto shard = table.RestartOwner(username, restarted);
+
+	//Check
+	if (!shard)
+		return Error("-ShardedRTPBundleTransport::RestartICETransport() | ICE transport not found [username:%s]\n", username.c_str());
+
+	//Restart it
+	return shards[*shard]->RestartICETransport(username, restarted, properties);
+}
+
+int ShardedRTPBundleTransport::RemoveICETransport(const std::string &username)
+{
+	//Remove owner
+	auto shard = table.RemoveOwner(username);
+
+	//Check
+	if (!shard)
+		return Error("-ShardedRTPBundleTransport::RemoveICETransport() | ICE transport not found [username:%s]\n", username.c_str());
+
+	//Candidates are removed from routing table when removed from the shard
+	return shards[*shard]->RemoveICETransport(username);
+}
+
+int ShardedRTPBundleTransport::AddRemoteCandidate(const std::string& username,const char* ip, WORD port)
+{
+	//Find owner
+	auto shard = table.GetOwner(username);
+
+	//Check
+	if (!shard)
+		return Error("-ShardedRTPBundleTransport::AddRemoteCandidate() | ICE transport not found [username:%s]\n", username.c_str());
+
+	//Add it on owner shard
+	return shards[*shard]->AddRemoteCandidate(username, ip, port);
+}
+
+void ShardedRTPBundleTransport::SetIceTimeout(uint32_t timeout)
+{
+	for (auto& shard : shards)
+		shard->SetIceTimeout(timeout);
+}
+
+bool ShardedRTPBundleTransport::SetAffinity(size_t shard, int cpu)
+{
+	//Check
+	if (shard>=shards.size())
+		return false;
+	//Pin loop and incoming socket cpu
+	return shards[shard]->SetAffinity(cpu);
+}
+
+bool ShardedRTPBundleTransport::SetThreadName(const std::string& name)
+{
+	bool ok = true;
+	for (size_t i = 0; i<shards.size(); ++i)
+		ok &= shards[i]->SetThreadName(name + std::to_string(i));
+	return ok;
+}
+
+bool ShardedRTPBundleTransport::SetPriority(int priority)
+{
+	bool ok = true;
+	for (auto& shard : shards)
+		ok &= shard->SetPriority(priority);
+	return ok;
+}
+
+uint32_t ShardedRTPBundleTransport::GetShardIndex(const RTPBundleTransport* transport) const
+{
+	for (uint32_t i = 0; i<shards.size(); ++i)
+		if (shards[i].get()==transport)
+			return i;
+	return shards.size();
+}
+
+RTPBundleTransport* ShardedRTPBundleTransport::OnUnknown(RTPBundleTransport* transport, std::string_view username, const uint32_t ip, const uint16_t port)
+{
+	uint32_t shard = GetShardIndex(transport);
+
+	//ICE requests are not authenticated yet, so their remote address is only routed once the owner adds the candidate
+	auto owner = !username.empty() ? table.Lookup(shard, username) : table.Lookup(shard, ip, port);
+
+	//Check it is owned by another shard
+	if (!owner || *owner==shard)
+		return nullptr;
+
+	return shards[*owner].get();
+}
+
+void ShardedRTPBundleTransport::OnCandidateAdded(RTPBundleTransport* transport, const uint32_t ip, const uint16_t port)
+{
+	uint32_t shard = GetShardIndex(transport);
+
+	//Set owner
+	table.AddRemote(shard, ip, port);
+
+	//Steer it
+	Steer(ip, port, shard);
+}
+
+void ShardedRTPBundleTransport::OnCandidateRemoved(RTPBundleTransport* transport, const uint32_t ip, const uint16_t port)
+{
+	//Only if it was still owned by this shard
+	if (!table.RemoveRemote(GetShardIndex(transport), ip, port))
+		return;
+
+	//Use kernel hashing again
+	Unsteer(ip, port);
+}
@@ -0,0 +1,73 @@
+#include "tracing.h"
+#include "log.h"
+#include "EventLoop.h"
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(size_t workers, const std::string& name)
+{
+	Debug("-WorkerPool::WorkerPool() [name:%s,workers:%zu]\n",name.c_str(),workers);
+
+	//Launch threads
+	for (size_t i = 0; i < workers; ++i)
+	{
+		threads.emplace_back([this](){ Run(); });
+		//Name them for debugging
+		EventLoop::SetThreadName(threads.back().native_handle(), name + "-" + std::to_string(i));
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		//Stop after pending tasks are done
+		running = false;
+	}
+	//Wake up all
+	cond.notify_all();
+
+	//Wait for them
+	for (auto& thread : threads)
+		thread.join();
+}
+
+void WorkerPool::Post(Task&& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		//Enqueue it
+		tasks.emplace_back(std::move(task));
+	}
+	//Wake up one worker
+	cond.notify_one();
+}
+
+size_t WorkerPool::GetPending()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return tasks.size();
+}
+
+void WorkerPool::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true)
+	{
+		//Wait for new tasks
+		cond.wait(lock, [this](){ return !running || !tasks.empty(); });
+
+		//Exit if stopped and there is nothing left
+		if (tasks.empty())
+			break;
+
+		//Get first one
+		Task task = std::move(tasks.front());
+		tasks.pop_front();
+
+		//Run it unlocked
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
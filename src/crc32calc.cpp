@@ -1,4 +1,230 @@
 #include "crc32calc.h"
 
-DWORD CRC32Calc::table[256];
-bool CRC32Calc::inited = false;
\ No newline at end of file
+#include <array>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC32_HAVE_PCLMUL 1
+#endif
+
+namespace
+{
+
+using Tables = std::array<std::array<DWORD,256>,8>;
+
+constexpr Tables GenerateTables()
+{
+	Tables tables = {};
+
+	//Byte at a time table
+	for (DWORD i = 0; i < 256; ++i)
+	{
+		DWORD c = i;
+		for (DWORD j = 0; j < 8; ++j)
+			c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+		tables[0][i] = c;
+	}
+
+	//Each following table advances the crc one more zero byte
+	for (DWORD i = 0; i < 256; ++i)
+		for (size_t t = 1; t < 8; ++t)
+			tables[t][i] = tables[0][tables[t-1][i] & 0xFF] ^ (tables[t-1][i] >> 8);
+
+	return tables;
+}
+
+constexpr Tables tables = GenerateTables();
+
+//All engines work on the inverted crc value
+DWORD UpdateTable(DWORD c, const BYTE* data, DWORD size)
+{
+	for (DWORD i = 0; i < size; ++i)
+		c = tables[0][(c ^ data[i]) & 0xFF] ^ (c >> 8);
+	return c;
+}
+
+DWORD UpdateSlicingBy8(DWORD c, const BYTE* data, DWORD size)
+{
+	//Process 8 bytes per iteration, input is read as little endian
+	while (size >= 8)
+	{
+		uint32_t one;
+		uint32_t two;
+		memcpy(&one, data, 4);
+		memcpy(&two, data + 4, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		one = __builtin_bswap32(one);
+		two = __builtin_bswap32(two);
+#endif
+		one ^= c;
+		c =	tables[7][one & 0xFF]		^
+			tables[6][(one >> 8) & 0xFF]	^
+			tables[5][(one >> 16) & 0xFF]	^
+			tables[4][one >> 24]		^
+			tables[3][two & 0xFF]		^
+			tables[2][(two >> 8) & 0xFF]	^
+			tables[1][(two >> 16) & 0xFF]	^
+			tables[0][two >> 24];
+		data += 8;
+		size -= 8;
+	}
+
+	//Remaining bytes
+	return UpdateTable(c, data, size);
+}
+
+#ifdef CRC32_HAVE_PCLMUL
+/*
+ * Folding with carry-less multiplication, see "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ Instruction" (Intel, 2009). Constants
+ * are x^(n) mod P(x) for the reflected polynomial, bit reversed and shifted.
+ */
+__attribute__((target("pclmul,sse4.1")))
+DWORD UpdatePCLMUL(DWORD c, const BYTE* data, DWORD size)
+{
+	//Not worth it for short buffers
+	if (size < 64)
+		return UpdateSlicingBy8(c, data, size);
+
+	const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+	const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+	const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+	const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+	const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+	//Only full 16 byte blocks are folded
+	DWORD tail = size & 15;
+	size -= tail;
+
+	//Load first 64 bytes and add the crc
+	__m128i x1 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+	__m128i x2 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+	__m128i x3 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+	__m128i x4 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(c));
+	data += 64;
+	size -= 64;
+
+	//Fold by 4
+	while (size >= 64)
+	{
+		__m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		__m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		__m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		__m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(data + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(data + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(data + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(data + 0x30)));
+		data += 64;
+		size -= 64;
+	}
+
+	//Fold into 128 bits
+	for (__m128i next : {x2, x3, x4})
+	{
+		__m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, next), x5);
+	}
+
+	//Fold remaining 16 byte blocks
+	while (size >= 16)
+	{
+		__m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)data)), x5);
+		data += 16;
+		size -= 16;
+	}
+
+	//Fold 128 bits to 64 bits
+	__m128i x2r = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2r);
+	x2r = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask);
+	x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+	x1 = _mm_xor_si128(x1, x2r);
+
+	//Barrett reduction to 32 bits
+	x2r = _mm_and_si128(x1, mask);
+	x2r = _mm_clmulepi64_si128(x2r, poly, 0x10);
+	x2r = _mm_and_si128(x2r, mask);
+	x2r = _mm_clmulepi64_si128(x2r, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2r);
+	c = _mm_extract_epi32(x1, 1);
+
+	//Remaining bytes
+	return UpdateSlicingBy8(c, data, tail);
+}
+#endif
+
+}
+
+CRC32Calc::Engine CRC32Calc::GetDefaultEngine()
+{
+	//Detected once
+	static const Engine engine = IsSupported(PCLMUL) ? PCLMUL : SlicingBy8;
+	return engine;
+}
+
+bool CRC32Calc::IsSupported(Engine engine)
+{
+	switch (engine)
+	{
+		case Table:
+		case SlicingBy8:
+			return true;
+		case PCLMUL:
+#ifdef CRC32_HAVE_PCLMUL
+		{
+			//Detected once, may be called from static constructors
+			static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1"));
+			return supported;
+		}
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+const char* CRC32Calc::GetEngineName(Engine engine)
+{
+	switch (engine)
+	{
+		case Table:
+			return "table";
+		case SlicingBy8:
+			return "slicing-by-8";
+		case PCLMUL:
+			return "pclmul";
+	}
+	return "unknown";
+}
+
+DWORD CRC32Calc::Update(const BYTE *data, DWORD size)
+{
+	DWORD c = crc ^ 0xFFFFFFFF;
+	switch (engine)
+	{
+		case Table:
+			c = UpdateTable(c, data, size);
+			break;
+		case SlicingBy8:
+			c = UpdateSlicingBy8(c, data, size);
+			break;
+		case PCLMUL:
+#ifdef CRC32_HAVE_PCLMUL
+			c = UpdatePCLMUL(c, data, size);
+#endif
+			break;
+	}
+	crc = c ^ 0xFFFFFFFF;
+	return crc;
+}
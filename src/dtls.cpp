@@ -1,4 +1,7 @@
 #include "tracing.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <openssl/pem.h>
 #include <srtp2/srtp.h>
 #include "dtls.h"
 #include "log.h"
@@ -11,10 +14,15 @@ using namespace std::chrono_literals;
 std::string		DTLSConnection::certfile("");
 std::string		DTLSConnection::pvtfile("");
 std::string		DTLSConnection::cipher("ALL:NULL:eNULL:aNULL");
+std::string		DTLSConnection::ecdsaCipher("ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-ECDSA-AES128-SHA:ECDHE-ECDSA-AES256-SHA");
+std::string		DTLSConnection::cacheDir("");
+DTLSConnection::KeyType	DTLSConnection::keyType		= DTLSConnection::RSA_2048;
 SSL_CTX*		DTLSConnection::ssl_ctx		= NULL;
 X509*			DTLSConnection::certificate	= NULL;
 EVP_PKEY*		DTLSConnection::privateKey	= NULL;
 bool			DTLSConnection::hasDTLS		= false;
+size_t			DTLSConnection::handshakeWorkers = 2;
+std::unique_ptr<WorkerPool>	DTLSConnection::workers;
 
 DTLSConnection::LocalFingerPrints	DTLSConnection::localFingerPrints;
 DTLSConnection::AvailableHashes		DTLSConnection::availableHashes;
@@ -29,64 +37,72 @@ void DTLSConnection::SetCertificate(const char* cert,const char* key)
 	DTLSConnection::pvtfile.assign(key);
 }
 
-int DTLSConnection::GenerateCertificate()
+void DTLSConnection::SetKeyType(KeyType type)
 {
-	TRACE_EVENT("dtls", "DTLSConnection::GenerateCertificate");
-	Debug(">DTLSConnection::GenerateCertificate()\n");
-	
-	int ret = 0;
-	BIGNUM* bne = NULL;
-	RSA* rsa_key = NULL;
-	int num_bits = 2048;
-	X509_NAME* cert_name = NULL;
+	Debug("-DTLSConnection::SetKeyType() | [type:%s]\n",GetKeyTypeName(type));
+	//Store it
+	DTLSConnection::keyType = type;
+}
 
-	// Create a big number object.
-	bne = BN_new();
-	if (!bne)
-	{
-		Error("BN_new() failed");
-		goto error;
-	}
+void DTLSConnection::SetCertificateCache(const char* directory)
+{
+	Debug("-DTLSConnection::SetCertificateCache() | [directory:\"%s\"]\n",directory);
+	//Store it
+	DTLSConnection::cacheDir.assign(directory);
+}
 
-	ret = BN_set_word(bne, RSA_F4); // RSA_F4 == 65537.
-	if (ret == 0)
-	{
-		Error("BN_set_word() failed");
-		goto error;
-	}
+void DTLSConnection::SetHandshakeWorkers(size_t workers)
+{
+	Debug("-DTLSConnection::SetHandshakeWorkers() | [workers:%zu]\n",workers);
+	//Store it
+	DTLSConnection::handshakeWorkers = workers;
+}
 
-	// Generate a RSA key.
-	rsa_key = RSA_new();
-	if (!rsa_key)
-	{
-		Error("RSA_new() failed");
-		goto error;
-	}
+EVP_PKEY* DTLSConnection::GenerateKey(KeyType type)
+{
+	EVP_PKEY* key = nullptr;
+	EVP_PKEY_CTX* ctx = nullptr;
 
-	// This takes some time.
-	ret = RSA_generate_key_ex(rsa_key, num_bits, bne, NULL);
-	if (ret == 0)
+	switch (type)
 	{
-		Error("RSA_generate_key_ex() failed");
-		goto error;
+		case RSA_2048:
+			ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+			if (!ctx || EVP_PKEY_keygen_init(ctx)<=0 || EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048)<=0)
+				goto error;
+			break;
+		case ECDSA_P256:
+			ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+			if (!ctx || EVP_PKEY_keygen_init(ctx)<=0 || EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1)<=0 || EVP_PKEY_CTX_set_ec_param_enc(ctx, OPENSSL_EC_NAMED_CURVE)<=0)
+				goto error;
+			break;
 	}
 
-	// Create a private key object (needed to hold the RSA key).
-	privateKey = EVP_PKEY_new();
-	if (!privateKey)
-	{
-		Error("EVP_PKEY_new() failed");
+	// This takes some time for RSA.
+	if (EVP_PKEY_keygen(ctx, &key)<=0)
 		goto error;
-	}
 
-	ret = EVP_PKEY_assign_RSA(privateKey, rsa_key);
-	if (ret == 0)
-	{
-		Error("EVP_PKEY_assign_RSA() failed");
+	EVP_PKEY_CTX_free(ctx);
+	return key;
+
+error:
+	if (ctx)
+		EVP_PKEY_CTX_free(ctx);
+	Error("-DTLSConnection::GenerateKey() | Key generation failed [type:%s]\n",GetKeyTypeName(type));
+	return nullptr;
+}
+
+int DTLSConnection::GenerateCertificate()
+{
+	TRACE_EVENT("dtls", "DTLSConnection::GenerateCertificate");
+	Debug(">DTLSConnection::GenerateCertificate() [type:%s]\n",GetKeyTypeName(keyType));
+	
+	int ret = 0;
+	X509_NAME* cert_name = NULL;
+
+	// Generate the private key.
+	privateKey = GenerateKey(keyType);
+	if (!privateKey)
 		goto error;
-	}
-	// The RSA key now belongs to the private key, so don't clean it up separately.
-	rsa_key = NULL;
 
 	// Create the X509 certificate.
 	certificate = X509_new();
@@ -134,28 +150,21 @@ int DTLSConnection::GenerateCertificate()
 	}
 
 	// Sign the certificate with its own private key.
-	ret = X509_sign(certificate, privateKey, EVP_sha1());
+	ret = X509_sign(certificate, privateKey, EVP_sha256());
 	if (ret == 0)
 	{
 		Error("X509_sign() failed");
 		goto error;
 	}
 
-	// Free stuff and return.
-	BN_free(bne);
-	
 	Debug("<DTLSConnection::GenerateCertificate()\n");
 	
 	return 1;
 
 error:
-	if (bne)
-		BN_free(bne);
-	if (rsa_key && !privateKey)
-		RSA_free(rsa_key);
 	if (privateKey)
 	{
-		EVP_PKEY_free(privateKey); // NOTE: This also frees the RSA key.
+		EVP_PKEY_free(privateKey);
 		privateKey = NULL;
 	}
 	if (certificate)
@@ -169,7 +178,7 @@ error:
 	
 }
 
-int DTLSConnection::ReadCertificate()
+int DTLSConnection::ReadCertificate(const std::string& certfile,const std::string& pvtfile)
 {
 	TRACE_EVENT("dtls", "DTLSConnection::ReadCertificate");
 	
@@ -211,6 +220,96 @@ int DTLSConnection::ReadCertificate()
 	return 1;
 }
 
+int DTLSConnection::ReadCachedCertificate()
+{
+	TRACE_EVENT("dtls", "DTLSConnection::ReadCachedCertificate");
+
+	//Get file names for current key type
+	std::string name = cacheDir + "/dtls-" + GetKeyTypeName(keyType);
+
+	//Check files are there, to not report an error on first run
+	if (access((name + ".crt").c_str(), R_OK) || access((name + ".key").c_str(), R_OK))
+		return 0;
+
+	//Read them
+	if (!ReadCertificate(name + ".crt", name + ".key"))
+		goto error;
+
+	//Check key is of the requested type and matches the certificate
+	if (EVP_PKEY_base_id(privateKey)!=GetKeyTypeId(keyType) || !X509_check_private_key(certificate, privateKey))
+	{
+		Warning("-DTLSConnection::ReadCachedCertificate() | Cached key does not match [file:%s.key]\n",name.c_str());
+		goto error;
+	}
+
+	//Check it is currently valid
+	if (X509_cmp_time(X509_get_notAfter(certificate), nullptr)<=0 || X509_cmp_current_time(X509_get_notBefore(certificate))>0)
+	{
+		Warning("-DTLSConnection::ReadCachedCertificate() | Cached certificate expired [file:%s.crt]\n",name.c_str());
+		goto error;
+	}
+	
+	Log("-DTLSConnection::ReadCachedCertificate() | Using cached certificate [file:%s.crt]\n",name.c_str());
+
+	//Done
+	return 1;
+
+error:
+	if (privateKey)
+		EVP_PKEY_free(privateKey);
+	if (certificate)
+		X509_free(certificate);
+	privateKey = nullptr;
+	certificate = nullptr;
+	return 0;
+}
+
+int DTLSConnection::WriteCachedCertificate()
+{
+	TRACE_EVENT("dtls", "DTLSConnection::WriteCachedCertificate");
+
+	//Get file names for current key type
+	std::string name = cacheDir + "/dtls-" + GetKeyTypeName(keyType);
+
+	//Write to temporal files and rename them so a concurrent start never reads half written ones
+	std::string crt = name + ".crt." + std::to_string(getpid());
+	std::string key = name + ".key." + std::to_string(getpid());
+
+	//Private key must only be readable by us
+	int fd = open(key.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	FILE* file = fd!=-1 ? fdopen(fd, "w") : nullptr;
+	if (!file)
+	{
+		if (fd!=-1)
+			close(fd);
+		return Error("-DTLSConnection::WriteCachedCertificate() | Could not open key file [file:%s,errno:%d]\n",key.c_str(),errno);
+	}
+	bool ok = PEM_write_PrivateKey(file, privateKey, nullptr, nullptr, 0, nullptr, nullptr);
+	ok = !fclose(file) && ok;
+
+	//Write certificate
+	if (ok && (file = fopen(crt.c_str(), "w")))
+	{
+		ok = PEM_write_X509(file, certificate);
+		ok = !fclose(file) && ok;
+	} else {
+		ok = false;
+	}
+
+	//Move them to final location, key first so a certificate is never paired with an older key
+	if (!ok || rename(key.c_str(), (name + ".key").c_str()) || rename(crt.c_str(), (name + ".crt").c_str()))
+	{
+		unlink(key.c_str());
+		unlink(crt.c_str());
+		return Error("-DTLSConnection::WriteCachedCertificate() | Could not write cached certificate [file:%s,errno:%d]\n",name.c_str(),errno);
+	}
+
+	Log("-DTLSConnection::WriteCachedCertificate() | Stored certificate [file:%s.crt]\n",name.c_str());
+
+	//Done
+	return 1;
+}
+
 int DTLSConnection::Initialize()
 {
 	TRACE_EVENT("dtls", "Initialize");
@@ -261,12 +360,18 @@ int DTLSConnection::Initialize()
 	if (certfile.size()>0 && pvtfile.size()>0)
 	{
 		//Read it
-		if (!ReadCertificate())
+		if (!ReadCertificate(certfile,pvtfile))
 			return Error("Could not read SSL files\n");
+	//If we have a cached one from a previous run
+	} else if (cacheDir.size()>0 && ReadCachedCertificate()) {
+		//Nothing else to do
 	} else {
 		//Generate them it
 		if (!GenerateCertificate())
 			return Error("Could not generate SSL certificate or private key files\n");
+		//Store it for next runs, not fatal
+		if (cacheDir.size()>0)
+			WriteCachedCertificate();
 	}
 	
 	// Set certificate.
@@ -277,9 +382,12 @@ int DTLSConnection::Initialize()
 	if (! SSL_CTX_use_PrivateKey(ssl_ctx, privateKey) || !SSL_CTX_check_private_key(ssl_ctx))
 		return Error("-DTLSConnection::Initialize() | Specified private key file '%s' could not be used\n",pvtfile.c_str());
 
+	//Only ECDSA suites can be used with EC keys
+	const std::string& ciphers = EVP_PKEY_base_id(privateKey)==EVP_PKEY_RSA ? cipher : ecdsaCipher;
+
 	//Set cipher list
-	if (! SSL_CTX_set_cipher_list(ssl_ctx, cipher.c_str()))
-		return Error("-DTLSConnection::Initialize() | Invalid cipher specified in cipher list '%s' for DTLS-SRTP\n",cipher.c_str());
+	if (! SSL_CTX_set_cipher_list(ssl_ctx, ciphers.c_str()))
+		return Error("-DTLSConnection::Initialize() | Invalid cipher specified in cipher list '%s' for DTLS-SRTP\n",ciphers.c_str());
 	
 	// Fill the DTLSConnection::availableHashes vector.
 	DTLSConnection::availableHashes.push_back(SHA1);
@@ -334,6 +442,10 @@ int DTLSConnection::Initialize()
 		Debug("-LocalFingerprint %d %s\n",hash, DTLSConnection::localFingerPrints[hash].c_str());
 	}
 
+	//Start handshake workers
+	if (handshakeWorkers)
+		DTLSConnection::workers = std::make_unique<WorkerPool>(handshakeWorkers, "dtls-worker");
+
 	// OK, we have DTLS.
 	DTLSConnection::hasDTLS = true;
 
@@ -347,6 +459,9 @@ int DTLSConnection::Terminate()
 	TRACE_EVENT("dtls", "DTLSConnection::Terminate");
 	Debug("-DTLSConnection::Terminate()\n");
 	
+	//Stop handshake workers
+	workers.reset();
+	
 	//Free stuff
 	if (privateKey)
 		EVP_PKEY_free(privateKey);
@@ -455,6 +570,9 @@ int DTLSConnection::Init()
 			return Error("-DTLSConnection::Init() | we are hold conn!");
 	}
 	
+	//Nothing running on the workers yet
+	offloaded = std::make_shared<Offloaded>();
+	
 	//Now we are ready to read and write DTLS packets.
 	inited = true;
 	
@@ -464,8 +582,8 @@ int DTLSConnection::Init()
 	//Start timeout
 	timeout = timeService.CreateTimer(0ms, [this](auto now){
 		//UltraDebug("-DTLSConnection::Timeout()\n");
-		//Check if still inited
-		if (inited)
+		//Check if still inited and not owned by a worker
+		if (inited && !handshaking)
 		{
 			//Run timeut
 			if (DTLSv1_handle_timeout(ssl)!=-1)
@@ -481,7 +599,7 @@ int DTLSConnection::Init()
 	sctp.OnPendingData([this](){
 		//UltraDebug("-sctp::OnPendingData() [ssl:%p]\n",ssl);
 
-		if (ssl)
+		if (ssl && !handshaking)
 		{
 			BYTE msg[MTU];
 			size_t len;
@@ -518,6 +636,9 @@ void DTLSConnection::End()
 	//Not inited anymore
 	inited = false;
 	
+	//Wait for the worker and discard pending handshake work
+	CancelOffload();
+	
 	//Cancel dtls timeout
 	if (timeout) timeout->Cancel();
 
@@ -533,8 +654,8 @@ void DTLSConnection::End()
 
 void DTLSConnection::Shutdown()
 {
-	//If already ended
-	if (!inited || !ssl)
+	//If already ended or handshaking on a worker
+	if (!inited || !ssl || handshaking)
 		return;
 
 	Log("-DTLSConnection::Shutdown()\n");
@@ -649,6 +770,10 @@ int DTLSConnection::Read(BYTE* data,DWORD size)
 	if (! inited)
 		return Error("-DTLSConnection::Read() | SSL not yet ready\n");
 
+	//Owned by a worker, pending data will be checked when it is done
+	if (handshaking)
+		return 0;
+
 	if (BIO_ctrl_pending(write_bio))
 		return BIO_read(write_bio, data, size);
 
@@ -699,14 +824,18 @@ void DTLSConnection::onSSLInfo(int where, int ret)
 		//Log
 		Log("-DTLSConnection::onSSLInfo() | DTLS handshake done\n");
 
+		//If running on a worker, keys are set up when back on the loop
+		if (onWorker)
+			handshakeDone = true;
 		// Use the keying material to set up key/salt information 
-		if (!SetupSRTP())
+		else if (!SetupSRTP())
 			//Error
 			listener.onDTLSSetupError();
 	} 
 
-	//Check pending data for writing
-	CheckPending();
+	//Check pending data for writing, deferred if running on a worker
+	if (!onWorker)
+		CheckPending();
 }
 
 int DTLSConnection::Renegotiate()
@@ -714,7 +843,7 @@ int DTLSConnection::Renegotiate()
 	TRACE_EVENT("dtls", "DTLSConnection::Renegotiate");
 	//Run in event loop thread
 	timeService.Async([this](auto now){
-		if (ssl)
+		if (ssl && !handshaking)
 		{
 
 			TRACE_EVENT("dtls", "DTLSConnection::Renegotiate::Work");
@@ -843,8 +972,29 @@ int DTLSConnection::Write(const BYTE *buffer, DWORD size)
 	if (!inited || !read_bio) 
 		return Error("-DTLSConnection::Write() | SSL not yet ready\n");
 
+	//If the handshake is running on a worker
+	if (handshaking)
+	{
+		//Check we are not flooded
+		if (queued.size()>=MaxQueuedRecords)
+			return Warning("-DTLSConnection::Write() | Too many records queued while handshaking, dropping\n");
+		//Keep it for later
+		queued.emplace_back(buffer, buffer+size);
+		return 0;
+	}
+
 	BIO_write(read_bio, buffer, size);
-	
+
+	//Run handshake crypto out of the event loop
+	if (workers && !SSL_is_init_finished(ssl))
+		return Offload();
+
+	//Process it now
+	return Process();
+}
+
+int DTLSConnection::Process()
+{
 	//Check pending dtls data for sending
 	CheckPending();
 	
@@ -880,6 +1030,91 @@ int DTLSConnection::Write(const BYTE *buffer, DWORD size)
 	return 1;
 }
 
+int DTLSConnection::Offload()
+{
+	//Worker owns the ssl until it posts back
+	handshaking = true;
+
+	workers->Post([this, offloaded = offloaded]() {
+		std::lock_guard<std::mutex> lock(offloaded->mutex);
+
+		//If connection has ended meanwhile
+		if (offloaded->cancelled)
+			return;
+
+		TRACE_EVENT("dtls", "DTLSConnection::Handshake");
+
+		//Run handshake on received records, signing and verification happens here
+		onWorker = true;
+		SSL_do_handshake(ssl);
+		onWorker = false;
+
+		//Continue on the event loop
+		timeService.Async([this, offloaded](auto now){
+			{
+				std::lock_guard<std::mutex> lock(offloaded->mutex);
+				//If connection has ended meanwhile
+				if (offloaded->cancelled)
+					return;
+			}
+			OnOffloaded();
+		});
+	});
+
+	return 1;
+}
+
+void DTLSConnection::OnOffloaded()
+{
+	TRACE_EVENT("dtls", "DTLSConnection::OnOffloaded", "queued", queued.size());
+
+	//Loop owns the ssl again
+	handshaking = false;
+
+	//If handshake has finished on the worker
+	if (handshakeDone)
+	{
+		handshakeDone = false;
+		// Use the keying material to set up key/salt information 
+		if (!SetupSRTP())
+			//Error
+			listener.onDTLSSetupError();
+	}
+
+	//Feed records received meanwhile
+	for (auto& record : queued)
+		BIO_write(read_bio, record.data(), record.size());
+	bool pending = !queued.empty();
+	queued.clear();
+
+	//If still handshaking and got new records
+	if (pending && !SSL_is_init_finished(ssl))
+	{
+		//Send our flight and reschedule timeout before going back to the worker
+		CheckPending();
+		Offload();
+	} else {
+		//Send our flight and read any data left
+		Process();
+	}
+}
+
+void DTLSConnection::CancelOffload()
+{
+	//If there is any
+	if (offloaded)
+	{
+		//Wait for the worker if it is running it
+		std::lock_guard<std::mutex> lock(offloaded->mutex);
+		//Don't run it anymore
+		offloaded->cancelled = true;
+	}
+	offloaded.reset();
+	handshaking = false;
+	handshakeDone = false;
+	queued.clear();
+}
+
 void DTLSConnection::CheckPending()
 {
 	//UltraDebug("-DTLSConnection::CheckPending()\n");
@@ -423,7 +423,7 @@ bool H264LayerSelector::Select(const RTPPacket::shared& packet,bool &mark)
 								//Create sps
 								packet->h264SeqParameterSet.emplace();
 								//Parse sps
-								if (packet->h264SeqParameterSet->Decode(nalData, nalSize - 1))
+								if (packet->h264SeqParameterSet.modify().Decode(nalData, nalSize - 1))
 								{
 									//Set dimensions
 									packet->SetWidth(packet->h264SeqParameterSet->GetWidth());
@@ -439,7 +439,7 @@ bool H264LayerSelector::Select(const RTPPacket::shared& packet,bool &mark)
 								//Create pps
 								packet->h264PictureParameterSet.emplace();
 								//Parse sps
-								if (!packet->h264PictureParameterSet->Decode(nalData, nalSize - 1))
+								if (!packet->h264PictureParameterSet.modify().Decode(nalData, nalSize - 1))
 								{
 									//Remove sps
 									packet->h264SeqParameterSet.reset();
@@ -462,7 +462,7 @@ bool H264LayerSelector::Select(const RTPPacket::shared& packet,bool &mark)
 					//Create sps
 					packet->h264SeqParameterSet.emplace();
 					//Parse sps
-					if (packet->h264SeqParameterSet->Decode(nalData, nalSize - 1))
+					if (packet->h264SeqParameterSet.modify().Decode(nalData, nalSize - 1))
 					{
 						//Set dimensions
 						packet->SetWidth(packet->h264SeqParameterSet->GetWidth());
@@ -479,7 +479,7 @@ bool H264LayerSelector::Select(const RTPPacket::shared& packet,bool &mark)
 					//Create pps
 					packet->h264PictureParameterSet.emplace();
 					//Parse sps
-					if (!packet->h264PictureParameterSet->Decode(nalData, nalSize - 1))
+					if (!packet->h264PictureParameterSet.modify().Decode(nalData, nalSize - 1))
 					{
 						//Remove sps
 						packet->h264SeqParameterSet.reset();
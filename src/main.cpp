@@ -157,6 +157,8 @@ int main(int argc,char **argv)
 	const char *pidfile = "mcu.pid";
 	const char *crtfile = NULL;
 	const char *keyfile = NULL;
+	const char *crtcache = NULL;
+	DTLSConnection::KeyType crttype = DTLSConnection::RSA_2048;
     
 	//Get all
 	for(int i=1;i<argc;i++)
@@ -177,6 +179,8 @@ int main(int argc,char **argv)
 				" --mcu-pid        Set mcu pid file path (default: mcu.pid)\r\n"
 				" --mcu-crt        Set mcu SSL certificate file path (default: mcu.crt)\r\n"
 				" --mcu-key        Set mcu SSL key file path (default: mcu.pid)\r\n"
+				" --mcu-crt-type   Set generated SSL certificate key type: rsa2048 or ecdsa-p256 (default: rsa2048)\r\n"
+				" --mcu-crt-cache  Set directory to store the generated SSL certificate and reuse it on restart\r\n"
 				" --http-port      Set HTTP xmlrpc api port\r\n"
 				" --http-ip        Set HTTP xmlrpc api listening interface ip\r\n"
 				" --min-rtp-port   Set min rtp port\r\n"
@@ -228,6 +232,19 @@ int main(int argc,char **argv)
 		else if (strcmp(argv[i],"--mcu-key")==0 && (i+1<argc))
 			//Get certificate key file
 			keyfile = argv[++i];
+		else if (strcmp(argv[i],"--mcu-crt-type")==0 && (i+1<argc))
+		{
+			//Get generated certificate key type
+			const char* type = argv[++i];
+			if (strcmp(type,"ecdsa-p256")==0)
+				crttype = DTLSConnection::ECDSA_P256;
+			else if (strcmp(type,"rsa2048")==0)
+				crttype = DTLSConnection::RSA_2048;
+			else
+				printf("Unknown certificate type %s, using rsa2048\r\n",type);
+		} else if (strcmp(argv[i],"--mcu-crt-cache")==0 && (i+1<argc))
+			//Get generated certificate cache directory
+			crtcache = argv[++i];
 		else if (strcmp(argv[i],"--vad-period")==0 && (i+1<=argc))
 			//Get rtmp port
 			vadPeriod = atoi(argv[++i]);
@@ -371,6 +388,11 @@ int main(int argc,char **argv)
 		//Set DTLS certificate
 		DTLSConnection::SetCertificate(crtfile,keyfile);
 	
+	//Set generated certificate options
+	DTLSConnection::SetKeyType(crttype);
+	if (crtcache)
+		DTLSConnection::SetCertificateCache(crtcache);
+	
 	//Init DTLS
 	if (DTLSConnection::Initialize()) 
 	{
@@ -163,6 +163,11 @@ std::optional<TemplateDependencyStructure> TemplateDependencyStructure::Parse(Bi
 }
 	
 std::optional<DependencyDescriptor> DependencyDescriptor::Parse(BitReader& reader, const std::optional<TemplateDependencyStructure>& templateDependencyStructure)
+{
+	return Parse(reader, templateDependencyStructure ? &*templateDependencyStructure : nullptr);
+}
+
+std::optional<DependencyDescriptor> DependencyDescriptor::Parse(BitReader& reader, const TemplateDependencyStructure* templateDependencyStructure)
 {
 	auto dd = std::make_optional<DependencyDescriptor>({});
 	
@@ -584,8 +584,9 @@ DWORD RTCPRTPFeedback::TransportWideFeedbackMessageField::Parse(const BYTE* data
 	//Store packet count
 	feedbackPacketCount	= get1(data,7);
 
-	//Rseserve initial space
-	statuses.reserve(packetStatusCount);
+	//Rseserve initial space, don't trust the remote count further than the status vector chunks that fit in the remaining data
+	statuses.reserve(std::min<DWORD>(packetStatusCount,(size-8)/2*14));
+	packets.clear();
 
 	//Where we are 
 	DWORD len = 8;
@@ -662,6 +663,9 @@ DWORD RTCPRTPFeedback::TransportWideFeedbackMessageField::Parse(const BYTE* data
 				statuses.push_back(status);
 		}
 	}
+	//Now all the statuses have been parsed
+	packets.reserve(packetStatusCount);
+	
 	QWORD time = referenceTime * 64000;
 	//::Dump4(data+len,size-len);
 	//For each packet
@@ -672,7 +676,7 @@ DWORD RTCPRTPFeedback::TransportWideFeedbackMessageField::Parse(const BYTE* data
 		{
 			case PacketStatus::NotReceived:
 				//Append not received
-				packets[baseSeqNumber+i] = 0;
+				packets.emplace_back(baseSeqNumber+i, 0);
 				break;
 			case PacketStatus::SmallDelta:
 			{
@@ -686,7 +690,7 @@ DWORD RTCPRTPFeedback::TransportWideFeedbackMessageField::Parse(const BYTE* data
 				//Increase delta
 				len += 1;
 				//Append it
-				packets[baseSeqNumber+i] = time;
+				packets.emplace_back(baseSeqNumber+i, time);
 				break;
 			}
 			case PacketStatus::LargeOrNegativeDelta:
@@ -702,7 +706,7 @@ DWORD RTCPRTPFeedback::TransportWideFeedbackMessageField::Parse(const BYTE* data
 				//Increase delta
 				time += delta;
 				//Append it
-				packets[baseSeqNumber+i] = time;
+				packets.emplace_back(baseSeqNumber+i, time);
 				break;	
 			}
 			case PacketStatus::Reserved:
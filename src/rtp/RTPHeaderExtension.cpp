@@ -401,7 +401,7 @@ DWORD RTPHeaderExtension::Parse(const RTPMap &extMap,const BYTE* data,const DWOR
 					break;
 				//Init flag and optional data
 				hasColorSpace = true;
-				colorSpace.emplace();
+				auto colorSpace = &this->colorSpace.emplace();
 
 				//Get reader
 				BufferReader reader(ext+i, len);
@@ -452,7 +452,7 @@ DWORD RTPHeaderExtension::Parse(const RTPMap &extMap,const BYTE* data,const DWOR
 			case Type::VideoLayersAllocation:
 			{
 				//Init data, flag will be set when parsing is ok
-				videoLayersAllocation.emplace();
+				auto videoLayersAllocation = &this->videoLayersAllocation.emplace();
 
 				//Get reader for extension data
 				BufferReader reader(ext + i, len);
@@ -588,7 +588,7 @@ DWORD RTPHeaderExtension::Parse(const RTPMap &extMap,const BYTE* data,const DWOR
 	return 4+length;
 }
 
-bool RTPHeaderExtension::ParseDependencyDescriptor(const std::optional<TemplateDependencyStructure>& templateDependencyStructure)
+bool RTPHeaderExtension::ParseDependencyDescriptor(const SharedOptional<TemplateDependencyStructure>& templateDependencyStructure)
 {
 	//Check we have anything to read
 	if (!dependencyDescryptorReader.Left())
@@ -596,7 +596,7 @@ bool RTPHeaderExtension::ParseDependencyDescriptor(const std::optional<TemplateD
 		return false;
 	
 	//Parse it
-	dependencyDescryptor = DependencyDescriptor::Parse(dependencyDescryptorReader,templateDependencyStructure);
+	dependencyDescryptor = DependencyDescriptor::Parse(dependencyDescryptorReader,templateDependencyStructure ? &*templateDependencyStructure : nullptr);
 	//Was it parsed correctly?
 	hasDependencyDescriptor = dependencyDescryptor.has_value();
 	//Release reader
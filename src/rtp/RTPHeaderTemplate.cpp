@@ -0,0 +1,274 @@
+#include "rtp/RTPHeaderTemplate.h"
+#include "tools.h"
+
+#include <string.h>
+
+namespace
+{
+
+inline BYTE GetVideoOrientation(const VideoOrientation& cvo)
+{
+	//Same as RTPHeaderExtension::Serialize
+	return (cvo.facing ? 0x08 : 0x00) | (cvo.flip ? 0x04 : 0x00) | (cvo.rotation & 0x03);
+}
+
+inline DWORD GetPlayoutDelay(const struct RTPHeaderExtension::PlayoutDelay& playoutDelay)
+{
+	return (DWORD)playoutDelay.min << 16 | playoutDelay.max;
+}
+
+//Get the vp8 descriptor written instead of the original one when rewriting picture ids, same as RTPPacket::Serialize
+inline bool GetRewrittenDescriptor(const RTPPacket& packet, VP8PayloadDescriptor& descriptor)
+{
+	if (!packet.rewitePictureIds || !packet.vp8PayloadDescriptor)
+		return false;
+	descriptor = *packet.vp8PayloadDescriptor;
+	//Always stored as two bytes
+	descriptor.pictureIdPresent = 1;
+	descriptor.pictureIdLength = 2;
+	return true;
+}
+
+}
+
+void RTPHeaderTemplate::Reset()
+{
+	headerSize		= 0;
+	transportSeqNumOffset	= 0;
+	absSentTimeOffset	= 0;
+	audioLevelOffset	= 0;
+	mid.clear();
+}
+
+bool RTPHeaderTemplate::GetIds(const RTPPacket& packet, const RTPMap& extMap, Ids& ids)
+{
+	const RTPHeader& header = packet.GetRTPHeader();
+	const RTPHeaderExtension& extension = packet.GetRTPHeaderExtension();
+
+	//No padding, csrcs or osn
+	if (header.padding || !header.csrcs.empty() || packet.HasOSN())
+		return false;
+
+	//If it has any extension that changes on each packet and we don't patch
+	if (extension.hasTimeOffset
+		|| extension.hasFrameMarking
+		|| extension.hasRId
+		|| extension.hasRepairedId
+		|| extension.hasDependencyDescriptor
+		|| extension.hasAbsoluteCaptureTime
+		|| extension.hasColorSpace
+		|| extension.hasVideoLayersAllocation)
+		return false;
+
+	//Not written if there is no extension header
+	ids.fill(RTPMap::NotFound);
+	if (!header.extension)
+		return true;
+
+	//Get ids for the ones present
+	if (extension.hasAudioLevel)		ids[AudioLevel]		= extMap.GetTypeForCodec(RTPHeaderExtension::SSRCAudioLevel);
+	if (extension.hasAbsSentTime)		ids[AbsSentTime]	= extMap.GetTypeForCodec(RTPHeaderExtension::AbsoluteSendTime);
+	if (extension.hasTransportWideCC)	ids[TransportWideCC]	= extMap.GetTypeForCodec(RTPHeaderExtension::TransportWideCC);
+	if (extension.hasMediaStreamId)		ids[MediaStreamId]	= extMap.GetTypeForCodec(RTPHeaderExtension::MediaStreamId);
+	if (extension.hasVideoOrientation)	ids[VideoOrientation]	= extMap.GetTypeForCodec(RTPHeaderExtension::CoordinationOfVideoOrientation);
+	if (extension.hasPlayoutDelay)		ids[PlayoutDelay]	= extMap.GetTypeForCodec(RTPHeaderExtension::PlayoutDelay);
+
+	return true;
+}
+
+bool RTPHeaderTemplate::Matches(const RTPPacket& packet, const RTPMap& extMap) const
+{
+	//If not set
+	if (!headerSize)
+		return false;
+
+	//Get extension ids for this packet
+	Ids current;
+	if (!GetIds(packet, extMap, current))
+		return false;
+
+	const RTPHeaderExtension& extension = packet.GetRTPHeaderExtension();
+
+	//Extensions written must be the same and the ones not patched have the same value
+	return packet.GetRTPHeader().extension == (bool)(header[0] & 0x10)
+		&& current == ids
+		&& (ids[MediaStreamId]==RTPMap::NotFound	|| extension.mid == mid)
+		&& (ids[VideoOrientation]==RTPMap::NotFound	|| GetVideoOrientation(extension.cvo) == cvo)
+		&& (ids[PlayoutDelay]==RTPMap::NotFound		|| GetPlayoutDelay(extension.playoutDelay) == playoutDelay);
+}
+
+bool RTPHeaderTemplate::Set(const RTPPacket& packet, const RTPMap& extMap, const BYTE* data, DWORD size)
+{
+	//Invalidate previous one
+	Reset();
+
+	//Check it can be used
+	if (!GetIds(packet, extMap, ids))
+		return false;
+
+	//Get serialized media length, the vp8 descriptor may have been rewritten with a different size
+	DWORD mediaLength = packet.GetMediaLength();
+	VP8PayloadDescriptor descriptor;
+	if (GetRewrittenDescriptor(packet, descriptor))
+	{
+		//Check size
+		if (packet.vp8PayloadDescriptor->GetSize()>mediaLength)
+			return false;
+		mediaLength += descriptor.GetSize() - packet.vp8PayloadDescriptor->GetSize();
+	}
+
+	//Header and extensions are before the media
+	DWORD len = size - mediaLength;
+
+	//Check size
+	if (size<mediaLength || len<12 || len>MaxSize)
+		return false;
+
+	//Find the values to patch
+	const BYTE extIds[3]	= { ids[TransportWideCC], ids[AbsSentTime], ids[AudioLevel] };
+	const BYTE lengths[3]	= { 2, 3, 1 };
+	WORD offsets[3]		= {};
+
+	//Check it has been serialized without anything between header and media
+	if (FindExtensions(data, size, extIds, lengths, offsets, 3)!=len)
+		return false;
+
+	//Copy it
+	memcpy(header.data(), data, len);
+
+	//Store values
+	const RTPHeaderExtension& extension = packet.GetRTPHeaderExtension();
+	transportSeqNumOffset	= offsets[0];
+	absSentTimeOffset	= offsets[1];
+	audioLevelOffset	= offsets[2];
+	mid			= extension.mid;
+	cvo			= GetVideoOrientation(extension.cvo);
+	playoutDelay		= GetPlayoutDelay(extension.playoutDelay);
+	headerSize		= len;
+
+	return true;
+}
+
+DWORD RTPHeaderTemplate::Serialize(const RTPPacket& packet, BYTE* data, DWORD size) const
+{
+	//Get media payload
+	const BYTE* media = packet.GetMediaData();
+	DWORD mediaLength = packet.GetMediaLength();
+
+	//If the vp8 picture ids are rewritten
+	VP8PayloadDescriptor descriptor;
+	DWORD descriptorLength = 0;
+	if (GetRewrittenDescriptor(packet, descriptor))
+	{
+		//Get original descriptor size
+		DWORD original = packet.vp8PayloadDescriptor->GetSize();
+		//Check size
+		if (original>mediaLength)
+			return 0;
+		//Skip it
+		media += original;
+		mediaLength -= original;
+		descriptorLength = descriptor.GetSize();
+	}
+
+	//Get total length
+	DWORD len = headerSize + descriptorLength + mediaLength;
+
+	//Check size
+	if (!headerSize || len>size)
+		return 0;
+
+	//Copy header and extensions
+	memcpy(data, header.data(), headerSize);
+
+	//Patch header
+	data[1] = (packet.GetMark() ? 0x80 : 0x00) | (packet.GetPayloadType() & 0x7F);
+	set2(data, 2, packet.GetSeqNum());
+	set4(data, 4, packet.GetTimestamp());
+	set4(data, 8, packet.GetSSRC());
+
+	//Patch extensions, same as RTPHeaderExtension::Serialize
+	const RTPHeaderExtension& extension = packet.GetRTPHeaderExtension();
+	if (transportSeqNumOffset)
+		set2(data, transportSeqNumOffset, extension.transportSeqNum);
+	if (absSentTimeOffset)
+		set3(data, absSentTimeOffset, ((extension.absSentTime << 18) / 1000));
+	if (audioLevelOffset)
+		data[audioLevelOffset] = (extension.vad ? 0x80 : 0x00) | (extension.level & 0x7f);
+
+	//Write the new vp8 descriptor before the rest of the payload
+	if (descriptorLength)
+		descriptor.Serialize(data + headerSize, descriptorLength);
+
+	//Copy media payload
+	memcpy(data + headerSize + descriptorLength, media, mediaLength);
+
+	return len;
+}
+
+DWORD RTPHeaderTemplate::FindExtensions(const BYTE* data, DWORD size, const BYTE* ids, const BYTE* lengths, WORD* offsets, DWORD num)
+{
+	//Check size
+	if (size<12)
+		return 0;
+
+	//Get header size
+	DWORD headerSize = 12 + (data[0] & 0x0F) * 4;
+
+	//If there are no extensions
+	if (!(data[0] & 0x10))
+		return headerSize<=size ? headerSize : 0;
+
+	//Check size
+	if (headerSize+4>size)
+		return 0;
+
+	//Get profile and length
+	WORD profile = get2(data,headerSize);
+	DWORD end = headerSize + 4 + get2(data,headerSize+2) * 4;
+
+	//Check size
+	if (end>size)
+		return 0;
+
+	//Find the values of the requested extensions
+	for (DWORD i = headerSize + 4; i < end;)
+	{
+		BYTE id;
+		DWORD len;
+		//Padding
+		if (!data[i])
+		{
+			i++;
+			continue;
+		}
+		//One byte or two bytes header
+		if (profile==0xBEDE)
+		{
+			id = data[i] >> 4;
+			len = (data[i] & 0x0F) + 1;
+			//Reserved id stops processing
+			if (id==15)
+				break;
+			i += 1;
+		} else if ((profile & 0xFFF0)==0x1000 && i+1<end) {
+			id = data[i];
+			len = data[i+1];
+			i += 2;
+		} else {
+			break;
+		}
+		//Check size
+		if (i+len>end)
+			return 0;
+		//Store offset
+		for (DWORD j = 0; j < num; ++j)
+			if (id==ids[j] && len==lengths[j])
+				offsets[j] = i;
+		//Next
+		i += len;
+	}
+
+	//Payload starts after extensions
+	return end;
+}
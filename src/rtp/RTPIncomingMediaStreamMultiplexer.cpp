@@ -88,12 +88,10 @@ void RTPIncomingMediaStreamMultiplexer::onRTP(const RTPIncomingMediaStream* stre
 		timeService.Async([=,ssrc = stream->GetMediaSSRC()](auto now){
 			//Trace method
 			TRACE_EVENT("rtp", "RTPIncomingMediaStreamMultiplexer::onRTP async", "ssrc", ssrc, "packets", packets.size());
-			//Process each packet in order, if we reverse the order of the loops, the last listeners would have a lot of delay
-			for (const auto& packet : packets)
-				//Deliver to all listeners
-				for (auto listener : listeners)
-					//Dispatch rtp packet
-					listener->onRTP(this,packet);
+			//Deliver the whole batch to all listeners, transponders post it in a single task so the last listeners are not delayed
+			for (auto listener : listeners)
+				//Dispatch rtp packets
+				listener->onRTP(this,packets);
 		});
 	}
 }
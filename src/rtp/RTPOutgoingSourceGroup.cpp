@@ -85,6 +85,81 @@ RTPPacket::shared RTPOutgoingSourceGroup::GetPacket(WORD seq) const
 	return packet.value();
 }
 
+void RTPOutgoingSourceGroup::SetSerializedCacheSize(WORD size)
+{
+	//Same history than the rtx packets at most
+	size = std::min<WORD>(size, 512);
+	
+	//Round up to power of two so it is aligned with seq num wraps
+	WORD slots = size ? 1 : 0;
+	while (slots && slots < size)
+		slots <<= 1;
+	
+	Debug("-RTPOutgoingSourceGroup::SetSerializedCacheSize() [size:%u,slots:%u]\n",size,slots);
+	
+	//Drop previous ones, sync as packets are added on the transport thread
+	timeService.Sync([=](auto) {
+		serialized.assign(slots, SerializedPacket());
+		serializedData.assign(slots * MTU, 0);
+		serializedData.shrink_to_fit();
+		serialized.shrink_to_fit();
+	});
+}
+
+void RTPOutgoingSourceGroup::AddSerializedPacket(const RTPPacket::shared& packet,const BYTE* data,DWORD size,BYTE transportWideCCId,BYTE absSentTimeId)
+{
+	//If not enabled or too big
+	if (serialized.empty() || size>MTU || size<12)
+		return;
+	
+	//Get slot
+	WORD seq = get2(data,2);
+	auto& entry = serialized[seq & (serialized.size()-1)];
+	BYTE* slot = serializedData.data() + (seq & (serialized.size()-1)) * MTU;
+	
+	//Invalidate previous one
+	entry = {};
+	
+	//Find the values of the extensions that change on retransmission
+	const BYTE ids[2]	= { transportWideCCId, absSentTimeId };
+	const BYTE lengths[2]	= { 2, 3 };
+	WORD offsets[2]		= {};
+	DWORD headerSize = RTPHeaderTemplate::FindExtensions(data,size,ids,lengths,offsets,2);
+	
+	//Check it is valid
+	if (!headerSize)
+		return;
+	
+	//Copy it
+	memcpy(slot,data,size);
+	
+	//Store it
+	entry.data		= slot;
+	entry.size		= size;
+	entry.headerSize	= headerSize;
+	entry.transportSeqNumOffset	= offsets[0];
+	entry.absSentTimeOffset	= offsets[1];
+	entry.extSeqNum		= packet->GetExtSeqNum();
+	entry.mediaLength	= packet->GetMediaLength();
+	entry.clockRate		= packet->GetClockRate();
+}
+
+const RTPOutgoingSourceGroup::SerializedPacket* RTPOutgoingSourceGroup::GetSerializedPacket(WORD seq) const
+{
+	//If not enabled
+	if (serialized.empty())
+		return nullptr;
+	
+	//Get slot
+	auto& entry = serialized[seq & (serialized.size()-1)];
+	
+	//Check it is the same packet and not an older one with the same slot
+	if (!entry.data || get2(entry.data,2)!=seq)
+		return nullptr;
+	
+	return &entry;
+}
+
 void RTPOutgoingSourceGroup::onPLIRequest(DWORD ssrc)
 {
 	//Send asycn
@@ -132,9 +132,32 @@ RTPPacket::shared RTPPacket::Parse(const BYTE* data, DWORD size, const RTPMap& r
 }
 
 RTPPacket::shared RTPPacket::Parse(const BYTE* data, DWORD size, const RTPMap& rtpMap, const RTPMap& extMap, QWORD time)
+{
+	//Create payload from pool
+	auto payload = RTPPacket::PayloadPool.allocate();
+	
+	//Copy the whole packet on it
+	if (!payload->SetPayload(data,size))
+	{
+		//Debug
+		Debug("-RTPPacket::Parse() | RTP packet too big [size:%u]\n",size);
+		//Exit
+		return nullptr;
+	}
+	
+	//Parse it in place
+	return Parse(std::move(payload),rtpMap,extMap,time);
+}
+
+RTPPacket::shared RTPPacket::Parse(RTPPayload::shared&& payload, const RTPMap& rtpMap, const RTPMap& extMap, QWORD time)
 {
 	RTPHeader header;
 	RTPHeaderExtension extension;
+	
+	//Get packet data
+	const BYTE* data = payload->GetMediaData();
+	DWORD size = payload->GetMediaLength();
+	
 	//Parse RTP header
 	DWORD ini = header.Parse(data,size);
 	
@@ -192,11 +215,16 @@ RTPPacket::shared RTPPacket::Parse(const BYTE* data, DWORD size, const RTPMap& r
 	//Get media
 	MediaFrame::Type media = GetMediaForCodec(codec);
 	
-	//Create normal packet
-	auto packet = std::make_shared<RTPPacket>(media,codec,header,extension,time);
+	//Skip headers, so payload points to media data
+	payload->SkipPayload(ini);
+	//Remove padding
+	payload->SetMediaLength(size-ini);
+	
+	//Create packet with the payload
+	auto packet = std::make_shared<RTPPacket>(media,codec,header,extension,payload,time);
 	
-	//Set the payload
-	packet->SetPayload(data+ini,size-ini);
+	//Nobody else is using the payload, so we own it
+	packet->ownedPayload = true;
 	
 	//Done
 	return packet;
@@ -353,7 +381,7 @@ void RTPPacket::Dump() const
 }
 
 
-bool RTPPacket::ParseDependencyDescriptor(const std::optional<TemplateDependencyStructure>& templateDependencyStructure, std::optional<std::vector<bool>>& activeDecodeTargets)
+bool RTPPacket::ParseDependencyDescriptor(const SharedOptional<TemplateDependencyStructure>& templateDependencyStructure, const SharedOptional<std::vector<bool>>& activeDecodeTargets)
 {
 	//parse it
 	if (!extension.ParseDependencyDescriptor(templateDependencyStructure))
@@ -369,8 +397,10 @@ bool RTPPacket::ParseDependencyDescriptor(const std::optional<TemplateDependency
 	} else {
 		//Keep previous
 		this->templateDependencyStructure = templateDependencyStructure;
-		this->activeDecodeTargets	  = extension.dependencyDescryptor && extension.dependencyDescryptor->activeDecodeTargets.has_value() ?
-			extension.dependencyDescryptor->activeDecodeTargets : activeDecodeTargets;
+		if (extension.dependencyDescryptor && extension.dependencyDescryptor->activeDecodeTargets.has_value())
+			this->activeDecodeTargets = extension.dependencyDescryptor->activeDecodeTargets;
+		else
+			this->activeDecodeTargets = activeDecodeTargets;
 	}
 	//Done
 	return true;
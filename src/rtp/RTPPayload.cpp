@@ -60,7 +60,7 @@ bool RTPPayload::PrefixPayload(BYTE *data,DWORD size)
 bool RTPPayload::SkipPayload(DWORD skip) 
 {
 	//Ensure we have enough to skip
-	if (GetMaxMediaLength()<skip+(payload-buffer.data())+payloadLen)
+	if (skip>payloadLen)
 		//Error
 		return false;
 
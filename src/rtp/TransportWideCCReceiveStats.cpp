@@ -0,0 +1,314 @@
+#include "rtp/TransportWideCCReceiveStats.h"
+#include "tools.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace
+{
+
+enum PacketStatus : BYTE
+{
+	NotReceived = 0,
+	SmallDelta = 1,
+	LargeOrNegativeDelta = 2,
+	Reserved = 3
+};
+
+constexpr DWORD Mask = TransportWideCCReceiveStats::Size - 1;
+
+/*
+ * Packet status chunk writer, same chunking as
+ * RTCPRTPFeedback::TransportWideFeedbackMessageField::Serialize but with
+ * the pending statuses on a fixed array and chunks written as whole words
+ */
+class ChunkWriter
+{
+public:
+	ChunkWriter(BYTE* data) : data(data)
+	{
+	}
+
+	void Add(PacketStatus status)
+	{
+		//Check if all previous ones were equal and this one the first different
+		if (allsame && lastStatus!=Reserved && status!=lastStatus)
+		{
+			//Anything bigger is worth a run
+			if (count>7)
+			{
+				WriteRun(lastStatus, count);
+				count = 0;
+				maxStatus = NotReceived;
+			} else {
+				//Not same
+				allsame = false;
+			}
+		}
+
+		//Only needed while they may end on a vector chunk, a run of same status just counts
+		if (count<14)
+			statuses[count] = status;
+		count++;
+
+		//If it is bigger
+		if (status>maxStatus)
+			maxStatus = status;
+		lastStatus = status;
+
+		//If they are different already
+		if (!allsame)
+		{
+			if (maxStatus==LargeOrNegativeDelta && count>6)
+			{
+				//Two bit vector with the first 7
+				WriteTwoBitVector(7);
+				//Keep the rest and restore state from them
+				count -= 7;
+				memmove(statuses, statuses + 7, count * sizeof(PacketStatus));
+				lastStatus = Reserved;
+				maxStatus = NotReceived;
+				allsame = true;
+				for (DWORD i = 0; i<count; ++i)
+				{
+					if (statuses[i]>maxStatus)
+						maxStatus = statuses[i];
+					if (allsame && lastStatus!=Reserved && statuses[i]!=lastStatus)
+						allsame = false;
+					lastStatus = statuses[i];
+				}
+			} else if (count>13) {
+				//One bit vector with 14
+				WriteOneBitVector(14);
+				count = 0;
+				lastStatus = Reserved;
+				maxStatus = NotReceived;
+				allsame = true;
+			}
+		}
+	}
+
+	//Returns the written length
+	DWORD Flush()
+	{
+		//If not finished yet
+		if (count)
+		{
+			if (allsame)
+				WriteRun(lastStatus, count);
+			else if (maxStatus==LargeOrNegativeDelta)
+				WriteTwoBitVector(count);
+			else
+				WriteOneBitVector(count);
+			count = 0;
+		}
+		return len;
+	}
+private:
+	void WriteRun(PacketStatus status, DWORD run)
+	{
+		//T=0 | S(2) | run length (13)
+		set2(data, len, (DWORD)status << 13 | (run & 0x1FFF));
+		len += 2;
+	}
+
+	void WriteTwoBitVector(DWORD num)
+	{
+		//T=1 | S=1 | 7 two bit symbols
+		DWORD chunk = 0xC000;
+		for (DWORD i = 0; i<num; ++i)
+			chunk |= (DWORD)statuses[i] << (12 - i*2);
+		set2(data, len, chunk);
+		len += 2;
+	}
+
+	void WriteOneBitVector(DWORD num)
+	{
+		//T=1 | S=0 | 14 one bit symbols
+		DWORD chunk = 0x8000;
+		for (DWORD i = 0; i<num; ++i)
+			chunk |= (DWORD)(statuses[i] & 1) << (13 - i);
+		set2(data, len, chunk);
+		len += 2;
+	}
+private:
+	BYTE* data;
+	DWORD len = 0;
+	PacketStatus statuses[14];
+	DWORD count = 0;
+	PacketStatus lastStatus = Reserved;
+	PacketStatus maxStatus = NotReceived;
+	bool allsame = true;
+};
+
+//Delta in 250us units against the running time, which is updated
+inline int GetDelta(QWORD recv, QWORD& time)
+{
+	int delta = recv>time ? (recv - time)/250 : -(int)((time - recv)/250);
+	time += delta*250;
+	return delta;
+}
+
+}
+
+TransportWideCCReceiveStats::TransportWideCCReceiveStats()
+{
+}
+
+void TransportWideCCReceiveStats::Reset()
+{
+	//Clear pending slots
+	for (DWORD i = begin; i!=end; ++i)
+		times[i & Mask] = 0;
+	begin = 0;
+	end = 0;
+	received = 0;
+	firstTime = 0;
+	reported = false;
+}
+
+bool TransportWideCCReceiveStats::Add(DWORD extSeqNum, QWORD time)
+{
+	//First one ever
+	if (!reported && !received)
+		begin = end = extSeqNum;
+
+	//If it is older than the window start
+	if (extSeqNum<begin)
+	{
+		//Already reported as lost or too old
+		if (reported || end - extSeqNum > Size)
+			return false;
+		//Move window start back
+		begin = extSeqNum;
+	}
+
+	//If it does not fit
+	if (extSeqNum - begin >= Size)
+	{
+		//Feedback must be sent first
+		if (received)
+			return false;
+		//Only losses pending, don't report them
+		begin = end = extSeqNum;
+	}
+
+	//Zero is used for not received
+	if (!time)
+		time = 1;
+
+	//Get slot
+	QWORD& slot = times[extSeqNum & Mask];
+
+	//If it is new
+	if (!slot)
+	{
+		//Store first arrival
+		if (!received)
+			firstTime = time;
+		received++;
+	}
+
+	//Store it
+	slot = time;
+
+	//Update window end
+	if (extSeqNum>=end)
+		end = extSeqNum + 1;
+
+	return true;
+}
+
+DWORD TransportWideCCReceiveStats::Serialize(BYTE feedbackPacketCount, BYTE* data, DWORD size)
+{
+	//If we have no packets or no room
+	if (!received || size<16)
+		return 0;
+
+	//Limit packets so worst case, all large deltas, fits in the buffer
+	DWORD count = std::min<DWORD>(end - begin, (size - 13) * 7 / 16);
+
+	/*
+		0                   1                   2                   3
+		0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+	       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	       |      base sequence number     |      packet status count      |
+	       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	       |                 reference time                | fb pkt. count |
+	       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	 */
+	set2(data, 0, begin & 0xFFFF);
+	set2(data, 2, count);
+	set3(data, 4, 0);
+	set1(data, 7, feedbackPacketCount);
+
+	//Reference time is taken from the first received one
+	QWORD time = 0;
+	bool firstReceived = false;
+
+	//Write status chunks
+	ChunkWriter writer(data + 8);
+	for (DWORD i = 0; i<count; ++i)
+	{
+		QWORD recv = times[(begin + i) & Mask];
+		PacketStatus status = NotReceived;
+
+		//If got packet
+		if (recv)
+		{
+			//If first received
+			if (!firstReceived)
+			{
+				firstReceived = true;
+				//Set it as 3 bytes signed integer in 64ms units
+				QWORD referenceTime = (recv/64000) & 0x7FFFFF;
+				time = referenceTime * 64000;
+				set3(data, 4, referenceTime);
+			}
+			//Check delta size
+			int delta = GetDelta(recv, time);
+			status = (delta<0 || delta>127) ? LargeOrNegativeDelta : SmallDelta;
+		}
+		writer.Add(status);
+	}
+	DWORD len = 8 + writer.Flush();
+
+	//Write deltas, restarting from the reference time
+	time = (get3(data, 4) & 0x7FFFFF) * 64000;
+	for (DWORD i = 0; i<count; ++i)
+	{
+		QWORD& recv = times[(begin + i) & Mask];
+		//If got packet
+		if (recv)
+		{
+			int delta = GetDelta(recv, time);
+			if (delta<0 || delta>127)
+			{
+				set2(data, len, (short)delta);
+				len += 2;
+			} else {
+				set1(data, len, (BYTE)delta);
+				len++;
+			}
+			received--;
+		}
+		//Clear slot
+		recv = 0;
+	}
+
+	//Add zero padding
+	while (len%4)
+		data[len++] = 0;
+
+	//Move window
+	begin += count;
+	reported = true;
+
+	//If some did not fit, take arrival of the first remaining one
+	firstTime = 0;
+	for (DWORD i = begin; i!=end && received; ++i)
+		if ((firstTime = times[i & Mask]))
+			break;
+
+	return len;
+}
@@ -14,6 +14,24 @@
 #include <openssl/hmac.h>
 
 static const BYTE MagicCookie[4] = {0x21,0x12,0xA4,0x42};
+static const DWORD MagicCookieValue = 0x2112A442;
+static const DWORD FingerPrintXor = 0x5354554e;
+
+static DWORD GetTypeField(STUNMessage::Type type,STUNMessage::Method method)
+{
+	//Convert so we can sift
+	WORD msgType = type;
+	WORD msgMethod = method;
+
+	//Merge the type and method
+	DWORD msgTypeField =  (msgMethod & 0x0f80) << 2;
+	msgTypeField |= (msgMethod & 0x0070) << 1;
+	msgTypeField |= (msgMethod & 0x000f);
+	msgTypeField |= (msgType & 0x02) << 7;
+	msgTypeField |= (msgType & 0x01) << 4;
+
+	return msgTypeField;
+}
 
 STUNMessage::STUNMessage(Type type,Method method,const BYTE* transId)
 {
@@ -382,6 +400,276 @@ bool STUNMessage::CheckAuthenticatedFingerPrint(const BYTE* data,DWORD size,cons
 	return result;
 }
 
+DWORD STUNMessage::AuthenticatedFingerPrint(BYTE* data,DWORD size,const HMACKey& key)
+{
+	//Get size
+	WORD msgSize = GetSize();
+
+	//Check
+	if (size<msgSize)
+		//Not enought
+		return ::Error("Not enought size [size:%u,need:%u\n",size,msgSize);
+
+	//Set header
+	set2(data,0,GetTypeField(type,method));
+	set2(data,2,msgSize-20);
+	memcpy(data+4,MagicCookie,4);
+	memcpy(data+8,transId,12);
+
+	DWORD i = 20;
+
+	//For each
+	for (Attributes::iterator it = attributes.begin(); it!=attributes.end(); ++it)
+	{
+		//Set attr type
+		set2(data,i,(*it)->type);
+		set2(data,i+2,(*it)->size);
+		//Check not empty attr
+		if ((*it)->attr)
+			//Copy
+			memcpy(data+i+4,(*it)->attr,(*it)->size);
+		//Move
+		i = alignMemory4Bytes(data, i+4+(*it)->size);
+	}
+
+	//Calculate HMAC omitting the Fingerprint attribute from the length
+	key.Compute(data,i,msgSize-20-8,data+i+4);
+
+	//Set message integriti attribute
+	set2(data,i,Attribute::MessageIntegrity);
+	set2(data,i+2,HMACKey::Size);
+	i += 4+HMACKey::Size;
+
+	//Calculate crc 32 XOR'ed with the 32-bit value 0x5354554e
+	CRC32Calc crc32calc;
+	DWORD crc32 = crc32calc.Update(data,i) ^ FingerPrintXor;
+
+	//Set fingerprint attribute
+	set2(data,i,Attribute::FingerPrint);
+	set2(data,i+2,4);
+	set4(data,i+4,crc32);
+
+	//Return size
+	return i+8;
+}
+
+DWORD STUNMessage::SerializeBindingResponse(const View& request,uint32_t ip,uint16_t port,const HMACKey& key,BYTE* data,DWORD size)
+{
+	//Header + XOR-MAPPED-ADDRESS + MESSAGE-INTEGRITY + FINGERPRINT
+	const DWORD msgSize = 20+12+24+8;
+
+	//Check
+	if (size<msgSize)
+		//Not enought
+		return ::Error("Not enought size [size:%u,need:%u\n",size,msgSize);
+
+	//Set header
+	set2(data,0,GetTypeField(Response,Binding));
+	set2(data,2,msgSize-20);
+	memcpy(data+4,MagicCookie,4);
+	memcpy(data+8,request.GetTransactionId(),12);
+
+	//Set xor mapped address of the request origin
+	set2(data,20,Attribute::XorMappedAddress);
+	set2(data,22,8);
+	data[24] = 0;
+	data[25] = 1;
+	set2(data,26,port ^ (MagicCookieValue>>16));
+	set4(data,28,ip ^ MagicCookieValue);
+
+	//Calculate HMAC omitting the Fingerprint attribute from the length
+	key.Compute(data,32,msgSize-20-8,data+36);
+
+	//Set message integrity attribute
+	set2(data,32,Attribute::MessageIntegrity);
+	set2(data,34,HMACKey::Size);
+
+	//Calculate crc 32 XOR'ed with the 32-bit value 0x5354554e
+	CRC32Calc crc32calc;
+	DWORD crc32 = crc32calc.Update(data,56) ^ FingerPrintXor;
+
+	//Set fingerprint attribute
+	set2(data,56,Attribute::FingerPrint);
+	set2(data,58,4);
+	set4(data,60,crc32);
+
+	return msgSize;
+}
+
+STUNMessage::HMACKey::HMACKey() :
+	inner(EVP_MD_CTX_new()),
+	outer(EVP_MD_CTX_new()),
+	ctx(EVP_MD_CTX_new())
+{
+	//Start with empty pads so they can always be copied
+	EVP_DigestInit_ex(inner.get(),EVP_sha1(),nullptr);
+	EVP_DigestInit_ex(outer.get(),EVP_sha1(),nullptr);
+}
+
+void STUNMessage::HMACKey::SetPassword(const char* pwd)
+{
+	//Check if it has not changed
+	if (ready && this->pwd==pwd)
+		return;
+
+	//Store it
+	this->pwd = pwd;
+	ready = true;
+
+	//Keys longer than the block size are hashed first
+	BYTE key[SHA_CBLOCK] = {};
+	if (this->pwd.size()>SHA_CBLOCK)
+		EVP_Digest(this->pwd.data(),this->pwd.size(),key,nullptr,EVP_sha1(),nullptr);
+	else
+		memcpy(key,this->pwd.data(),this->pwd.size());
+
+	//Hash the inner and outer pads
+	BYTE pad[SHA_CBLOCK];
+	for (size_t i=0;i<SHA_CBLOCK;++i)
+		pad[i] = key[i] ^ 0x36;
+	EVP_DigestInit_ex(inner.get(),EVP_sha1(),nullptr);
+	EVP_DigestUpdate(inner.get(),pad,SHA_CBLOCK);
+	for (size_t i=0;i<SHA_CBLOCK;++i)
+		pad[i] = key[i] ^ 0x5c;
+	EVP_DigestInit_ex(outer.get(),EVP_sha1(),nullptr);
+	EVP_DigestUpdate(outer.get(),pad,SHA_CBLOCK);
+}
+
+void STUNMessage::HMACKey::Compute(const BYTE* data,DWORD size,WORD length,BYTE* mac) const
+{
+	//Header with the requested length
+	BYTE header[4];
+	memcpy(header,data,2);
+	set2(header,2,length);
+
+	unsigned int len = 0;
+
+	//Inner hash
+	EVP_MD_CTX_copy_ex(ctx.get(),inner.get());
+	EVP_DigestUpdate(ctx.get(),header,4);
+	EVP_DigestUpdate(ctx.get(),data+4,size-4);
+	EVP_DigestFinal_ex(ctx.get(),mac,&len);
+
+	//Outer hash
+	EVP_MD_CTX_copy_ex(ctx.get(),outer.get());
+	EVP_DigestUpdate(ctx.get(),mac,Size);
+	EVP_DigestFinal_ex(ctx.get(),mac,&len);
+}
+
+bool STUNMessage::View::Parse(const BYTE* data,DWORD size)
+{
+	//Ensure it looks like a STUN message.
+	if (!IsSTUN(data, size))
+		return false;
+
+	//Reset
+	*this = {};
+	this->data = data;
+	this->size = size;
+
+	//Get method and class, see STUNMessage::Parse
+	WORD method = get2(data,0);
+	this->method = (Method)((method & 0x000f) | ((method & 0x00e0)>>1) | ((method & 0x3E00)>>2));
+	this->type = (Type)(((data[0] & 0x01) << 1) | ((data[1] & 0x10) >> 4));
+
+	//Start looking for attributes after STUN header (byte #20).
+	DWORD i = 20;
+	DWORD fingerprint = 0;
+
+	//Ensure there are at least 4 remaining bytes (attribute with 0 length).
+	while (i+4 <= size)
+	{
+		//Get attribute type
+		WORD attrType = get2(data,i);
+		WORD attrLen = get2(data,i+2);
+
+		//Ensure the attribute length is not greater than the remaining size.
+		if (size<i+4+attrLen)
+		{
+			::Debug("-STUNMessage::View::Parse() | the attribute length exceeds the remaining size | message discarded\n");
+			return false;
+		}
+
+		//FINGERPRINT must be the last attribute.
+		if (fingerprint)
+		{
+			::Debug("-STUNMessage::View::Parse() | attribute after FINGERPRINT is not allowed | message discarded\n");
+			return false;
+		}
+
+		//After a MESSAGE-INTEGRITY attribute just FINGERPRINT is allowed.
+		if (integrity && attrType != Attribute::FingerPrint)
+		{
+			::Debug("-STUNMessage::View::Parse() | attribute after MESSAGE_INTEGRITY other than FINGERPRINT is not allowed | message discarded\n");
+			return false;
+		}
+
+		//Store position of the ones we care about, first one wins as in GetAttribute
+		switch(attrType)
+		{
+			case Attribute::Username:
+				if (!username)
+				{
+					username = i+4;
+					usernameLength = attrLen;
+				}
+				break;
+			case Attribute::Priority:
+				if (!priority && attrLen==4)
+					priority = i+4;
+				break;
+			case Attribute::UseCandidate:
+				useCandidate = true;
+				break;
+			case Attribute::MessageIntegrity:
+				integrity = i;
+				break;
+			case Attribute::FingerPrint:
+				fingerprint = i;
+				break;
+			default:
+				break;
+		}
+
+		//Next
+		i = pad32(i+4+attrLen);
+	}
+
+	//Ensure current position matches the total length.
+	if (i != size)
+	{
+		::Debug("-STUNMessage::View::Parse() | computed message size does not match total size | message discarded\n");
+		return false;
+	}
+
+	// If it has FINGERPRINT attribute then verify it.
+	if (fingerprint)
+	{
+		CRC32Calc crc32calc;
+		if (get2(data,fingerprint+2)!=4 || get4(data,fingerprint+4) != (crc32calc.Update(data,fingerprint) ^ FingerPrintXor))
+		{
+			::Debug("-STUNMessage::View::Parse() | computed FINGERPRINT value does not match the value in the message | message discarded\n");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool STUNMessage::View::CheckMessageIntegrity(const HMACKey& key) const
+{
+	//Ensure we have found the attribute
+	if (!integrity || get2(data,integrity+2)!=HMACKey::Size)
+		return false;
+
+	//Calculate HMAC up to the attribute, with the length including it
+	BYTE mac[HMACKey::Size];
+	key.Compute(data,integrity,integrity+4,mac);
+
+	//Compare generated hmac with integrity attribute
+	return memcmp(data+integrity+4,mac,HMACKey::Size)==0;
+}
+
 DWORD STUNMessage::GetSize()
 {
 	//Base message + Message attribute + FINGERPRINT attribute
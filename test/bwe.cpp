@@ -0,0 +1,100 @@
+#include "test.h"
+#include "rtp.h"
+#include "rtp/TransportWideCCReceiveStats.h"
+#include "SendSideBandwidthEstimation.h"
+#include <chrono>
+#include <vector>
+
+class BWETestPlan: public TestPlan
+{
+public:
+	BWETestPlan() : TestPlan("Send side BWE test plan")
+	{
+
+	}
+
+	virtual void Execute()
+	{
+		benchmarkReplay(50);
+		benchmarkReplay(200);
+	}
+
+	void benchmarkReplay(DWORD packetsPerFeedback)
+	{
+		constexpr DWORD Packets		= 200000;
+		constexpr DWORD PacketSize	= 1200;
+		constexpr DWORD Estimators	= 1000;
+
+		//Simulated path: 1ms sending interval, 20ms base delay, some jitter and 2% losses
+		std::vector<PacketStats> sent(Packets);
+		std::vector<QWORD> received(Packets);
+		for (DWORD i = 0; i < Packets; ++i)
+		{
+			QWORD time = 1000000 + i * 1000;
+			sent[i] = PacketStats::Create(i & 0xFFFF, 0x1234, i & 0xFFFF, PacketSize, PacketSize - 40, i * 90, time, i % 30 == 0);
+			received[i] = (i % 50 == 17) ? 0 : time + 20000 + (i * 7919) % 3000;
+		}
+
+		//Serialize the feedback messages as received from the remote peer
+		std::vector<std::vector<BYTE>> feedbacks;
+		TransportWideCCReceiveStats stats;
+		BYTE fbCount = 0;
+		for (DWORD i = 0; i < Packets; ++i)
+		{
+			if (received[i])
+				stats.Add(i, received[i]);
+			if ((i + 1) % packetsPerFeedback == 0 && !stats.IsEmpty())
+			{
+				std::vector<BYTE> data(MTU * 4);
+				DWORD len = stats.Serialize(fbCount++, data.data() + 12, data.size() - 12);
+				RTCPCommonHeader header;
+				header.count		= RTCPRTPFeedback::TransportWideFeedbackMessage;
+				header.packetType	= RTCPPacket::RTPFeedback;
+				header.padding		= 0;
+				header.length		= len + 12;
+				header.Serialize(data.data(), data.size());
+				set4(data.data(), 4, 1);
+				set4(data.data(), 8, 0x1234);
+				data.resize(len + 12);
+				feedbacks.push_back(std::move(data));
+			}
+		}
+
+		//Replay, packets are sent and feedback for them arrives 30ms later
+		SendSideBandwidthEstimation estimator;
+		size_t next = 0;
+		auto ini = std::chrono::steady_clock::now();
+		for (DWORD i = 0; i < Packets; ++i)
+		{
+			estimator.SentPacket(sent[i]);
+			if ((i + 1) % packetsPerFeedback == 0 && next < feedbacks.size())
+			{
+				auto rtcp = RTCPCompoundPacket::Parse(feedbacks[next].data(), feedbacks[next].size());
+				assert(rtcp);
+				auto fb = rtcp->GetPacket<RTCPRTPFeedback>(0);
+				for (DWORD j = 0; j < fb->GetFieldCount(); ++j)
+				{
+					auto field = fb->GetField<RTCPRTPFeedback::TransportWideFeedbackMessageField>(j);
+					estimator.ReceivedFeedback(field->feedbackPacketCount, field->packets, sent[i].time + 30000);
+				}
+				next++;
+			}
+		}
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+
+		Log("-benchmarkReplay() | [packets:%u,packets/feedback:%u,feedbacks:%zu,ns/packet:%.1f,us/feedback:%.1f,estimate:%ubps,memory:%zuB,%u estimators:%.1fMB]\n",
+			Packets,
+			packetsPerFeedback,
+			next,
+			(double)elapsed / Packets,
+			(double)elapsed / next / 1000,
+			estimator.GetEstimatedBitrate(),
+			sizeof(SendSideBandwidthEstimation),
+			Estimators,
+			(double)sizeof(SendSideBandwidthEstimation) * Estimators / (1024 * 1024)
+		);
+	}
+
+};
+
+BWETestPlan bwe;
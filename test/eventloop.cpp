@@ -1,5 +1,24 @@
 #include "test.h"
 #include "EventLoop.h"
+#include <atomic>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static uint64_t GetSteadyNanos()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t GetPercentile(std::vector<uint64_t>& values, double percentile)
+{
+	if (values.empty())
+		return 0;
+	auto pos = values.begin() + std::min<size_t>(values.size() - 1, values.size() * percentile);
+	std::nth_element(values.begin(), pos, values.end());
+	return *pos;
+}
 
 class EventLoopTestPlan : public TestPlan
 {
@@ -25,6 +44,36 @@ public:
 	{
 		init();
 
+		Log("benchmarkBackends\n");
+		benchmarkBackends();
+
+		Log("benchmarkSegmentationOffload\n");
+		benchmarkSegmentationOffload(false);
+		benchmarkSegmentationOffload(true);
+		benchmarkSegmentationOffload(true, true);
+		benchmarkSegmentationOffload(true, true, 16);
+
+		Log("testZeroCopyReceive\n");
+		testZeroCopyReceive();
+
+		Log("benchmarkTimers\n");
+		benchmarkTimers();
+
+		Log("benchmarkAsync\n");
+		for (size_t producers : {1, 2, 4, 8})
+		{
+			benchmarkAsync(producers, false);
+			benchmarkAsync(producers, true);
+		}
+
+		Log("benchmarkSpin\n");
+		benchmarkSpin(0us);
+		benchmarkSpin(50us);
+		benchmarkSpin(200us);
+
+		Log("testSendingPriorities\n");
+		testSendingPriorities();
+
 		Log("testTasks\n");
 		testTasks();
 
@@ -32,6 +81,485 @@ public:
 		end();
 	}
 
+	void benchmarkBackends()
+	{
+		benchmarkBackend(EventLoop::Backend::Poll);
+		benchmarkBackend(EventLoop::Backend::Epoll);
+	}
+
+	void benchmarkBackend(EventLoop::Backend backend)
+	{
+		constexpr size_t NumSockets = 64;
+		constexpr size_t NumPackets = 100000;
+		constexpr size_t NumTasks   = 20000;
+
+		struct Receiver : public EventLoop::Listener
+		{
+			virtual void OnRead(const int fd, const uint8_t* data, const size_t size, const uint32_t ipAddr, const uint16_t port) override
+			{
+				uint64_t sent = 0;
+				memcpy(&sent, data, std::min(size, sizeof(sent)));
+				latencies.push_back(GetSteadyNanos() - sent);
+				received++;
+			}
+			std::vector<uint64_t> latencies;
+			std::atomic<size_t> received = 0;
+		} receiver;
+
+		EventLoop loop;
+		
+		if (!loop.SetBackend(backend))
+			return (void)Log("-benchmarkBackend() | backend not supported [backend:%d]\n", backend);
+
+		loop.Start();
+
+		//Open and register sockets on loopback
+		std::vector<int> sockets;
+		std::vector<sockaddr_in> addrs;
+		for (size_t i = 0; i < NumSockets; ++i)
+		{
+			sockaddr_in addr = {};
+			socklen_t len = sizeof(addr);
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+			assert(fd != FD_INVALID);
+			assert(bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+			assert(getsockname(fd, (sockaddr*)&addr, &len) == 0);
+			loop.AddSocket(fd, &receiver);
+			sockets.push_back(fd);
+			addrs.push_back(addr);
+		}
+		receiver.latencies.reserve(NumPackets);
+
+		//Send datagrams round robin in small bursts so the receive buffers do not overflow
+		int sender = ::socket(AF_INET, SOCK_DGRAM, 0);
+		uint8_t data[200] = {};
+		auto ini = GetSteadyNanos();
+		for (size_t i = 0; i < NumPackets; ++i)
+		{
+			uint64_t ts = GetSteadyNanos();
+			memcpy(data, &ts, sizeof(ts));
+			(void)sendto(sender, data, sizeof(data), 0, (sockaddr*)&addrs[i % NumSockets], sizeof(sockaddr_in));
+			//Let the loop catch up
+			while (i + 1 > receiver.received + 256)
+				std::this_thread::yield();
+		}
+
+		//Wait until all have been received or no progress
+		size_t last = 0;
+		while (receiver.received != NumPackets && receiver.received != last)
+		{
+			last = receiver.received;
+			std::this_thread::sleep_for(100ms);
+		}
+		auto elapsed = GetSteadyNanos() - ini;
+		
+		//Cross thread wakeups
+		std::vector<uint64_t> wakeups;
+		wakeups.reserve(NumTasks);
+		auto start = GetSteadyNanos();
+		for (size_t i = 0; i < NumTasks; ++i)
+		{
+			uint64_t ts = GetSteadyNanos();
+			loop.Async([&wakeups,ts](auto now){
+				wakeups.push_back(GetSteadyNanos() - ts);
+			});
+			//Space them so each one requires a wake up
+			if (i % 16 == 0)
+				std::this_thread::sleep_for(std::chrono::microseconds(20));
+		}
+		loop.Sync([](auto now){});
+		auto tasksElapsed = GetSteadyNanos() - start;
+
+		loop.Stop();
+
+		for (auto fd : sockets)
+			close(fd);
+		close(sender);
+
+		Log("-benchmarkBackend() | [backend:%s,sockets:%zu,received:%zu/%zu,packets/s:%.0f,p50:%lluus,p99:%lluus]\n",
+			backend == EventLoop::Backend::Epoll ? "epoll" : "poll",
+			NumSockets,
+			(size_t)receiver.received, NumPackets,
+			receiver.received * 1E9 / elapsed,
+			GetPercentile(receiver.latencies, 0.50) / 1000,
+			GetPercentile(receiver.latencies, 0.99) / 1000
+		);
+		Log("-benchmarkBackend() | [backend:%s,wakeups/s:%.0f,p50:%lluus,p99:%lluus]\n",
+			backend == EventLoop::Backend::Epoll ? "epoll" : "poll",
+			wakeups.size() * 1E9 / tasksElapsed,
+			GetPercentile(wakeups, 0.50) / 1000,
+			GetPercentile(wakeups, 0.99) / 1000
+		);
+	}
+
+	void benchmarkSegmentationOffload(bool enabled, bool receiveOffload = false, size_t receiveBatchSize = 128)
+	{
+		constexpr size_t NumFrames    = 5000;
+		constexpr size_t FramePackets = 30;
+		constexpr size_t PacketSize   = 1200;
+		constexpr size_t LastSize     = 500;
+
+		struct Receiver : public EventLoop::Listener
+		{
+			virtual void OnRead(const int fd, const uint8_t* data, const size_t size, const uint32_t ipAddr, const uint16_t port) override
+			{
+				//Check sizes are kept after segmentation
+				if (size!=PacketSize && size!=LastSize)
+					invalid++;
+				bytes += size;
+				received++;
+			}
+			std::atomic<size_t> received = 0;
+			std::atomic<size_t> invalid = 0;
+			std::atomic<size_t> bytes = 0;
+		} receiver;
+
+		//Create sending and receiving sockets on loopback
+		sockaddr_in addr = {};
+		socklen_t len = sizeof(addr);
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		int sender = ::socket(AF_INET, SOCK_DGRAM, 0);
+		int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+		int rcvbuf = 8*1024*1024;
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+		assert(bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+		assert(getsockname(fd, (sockaddr*)&addr, &len) == 0);
+
+		EventLoop loop;
+		loop.SetSegmentationOffload(enabled);
+		loop.SetReceiveOffload(receiveOffload);
+		loop.SetReceiveBatchSize(receiveBatchSize);
+		loop.Start(sender);
+		loop.AddSocket(fd, &receiver);
+
+		auto ini = GetSteadyNanos();
+		for (size_t i = 0; i < NumFrames; ++i)
+		{
+			//Send a frame worth of packets to same destination
+			loop.Async([&](auto now){
+				for (size_t j = 0; j < FramePackets; ++j)
+				{
+					Packet packet = loop.GetPacketPool().pick();
+					packet.SetSize(j + 1 < FramePackets ? PacketSize : LastSize);
+					loop.Send(ntohl(addr.sin_addr.s_addr), ntohs(addr.sin_port), std::move(packet));
+				}
+			});
+			//Let the loop catch up
+			while ((i + 1) * FramePackets > receiver.received + 1024)
+				std::this_thread::yield();
+		}
+
+		//Wait until all have been received or no progress
+		size_t last = 0;
+		while (receiver.received != NumFrames * FramePackets && receiver.received != last)
+		{
+			last = receiver.received;
+			std::this_thread::sleep_for(100ms);
+		}
+		auto elapsed = GetSteadyNanos() - ini;
+
+		loop.Stop();
+
+		close(fd);
+		close(sender);
+
+		Log("-benchmarkSegmentationOffload() | [enabled:%d,supported:%d,gro:%d,batch:%zu,received:%zu/%zu,invalid:%zu,packets/s:%.0f,Mbps:%.0f]\n",
+			enabled,
+			loop.IsSegmentationOffloadSupported(),
+			receiveOffload,
+			receiveBatchSize,
+			(size_t)receiver.received, NumFrames * FramePackets,
+			(size_t)receiver.invalid,
+			receiver.received * 1E9 / elapsed,
+			receiver.bytes * 8E3 / elapsed
+		);
+		assert(receiver.invalid == 0);
+	}
+
+	void testZeroCopyReceive()
+	{
+		constexpr size_t NumPackets = 10000;
+
+		struct Receiver : public EventLoop::Listener
+		{
+			virtual void OnRead(const int fd, const uint8_t* data, const size_t size, const uint32_t ipAddr, const uint16_t port) override
+			{
+				copied++;
+			}
+			virtual void OnReadPayload(const int fd, RTPPayload::shared&& payload, const uint32_t ipAddr, const uint16_t port) override
+			{
+				uint64_t value = 0;
+				memcpy(&value, payload->GetMediaData(), std::min<size_t>(payload->GetMediaLength(), sizeof(value)));
+				//Keep every other payload, the loop must not reuse them
+				if (received++ % 2)
+					kept.emplace_back(value, std::move(payload));
+			}
+			std::vector<std::pair<uint64_t,RTPPayload::shared>> kept;
+			std::atomic<size_t> received = 0;
+			std::atomic<size_t> copied = 0;
+		} receiver;
+
+		sockaddr_in addr = {};
+		socklen_t len = sizeof(addr);
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+		assert(bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+		assert(getsockname(fd, (sockaddr*)&addr, &len) == 0);
+
+		EventLoop loop(&receiver);
+		loop.Start(fd);
+
+		int sender = ::socket(AF_INET, SOCK_DGRAM, 0);
+		for (uint64_t i = 0; i < NumPackets; ++i)
+		{
+			(void)sendto(sender, &i, sizeof(i), 0, (sockaddr*)&addr, sizeof(addr));
+			//Let the loop catch up, keep it small so the default receive buffer doesn't overflow
+			while (i + 1 > receiver.received + 64)
+				std::this_thread::yield();
+		}
+
+		//Wait until all have been received or no progress
+		size_t last = 0;
+		while (receiver.received != NumPackets && receiver.received != last)
+		{
+			last = receiver.received;
+			std::this_thread::sleep_for(100ms);
+		}
+
+		loop.Stop();
+		close(fd);
+		close(sender);
+
+		//Kept payloads must not have been overwritten by later reads
+		size_t corrupted = 0;
+		for (const auto& [value, payload] : receiver.kept)
+			if (payload->GetMediaLength()!=sizeof(value) || memcmp(&value, payload->GetMediaData(), sizeof(value))!=0)
+				corrupted++;
+
+		Log("-testZeroCopyReceive() | [received:%zu/%zu,kept:%zu,copied:%zu,corrupted:%zu]\n",(size_t)receiver.received,NumPackets,receiver.kept.size(),(size_t)receiver.copied,corrupted);
+		assert(receiver.copied == 0);
+		assert(corrupted == 0);
+	}
+
+	void benchmarkTimers()
+	{
+		constexpr size_t NumTimers = 10000;
+		constexpr size_t NumReschedules = 1000000;
+
+		EventLoop loop;
+		loop.Start();
+
+		std::vector<Timer::shared> timers;
+		std::vector<uint64_t> lateness;
+		size_t fired = 0;
+
+		//Create and reschedule timers from the loop thread
+		uint64_t elapsed = 0;
+		loop.Sync([&](auto now){
+			for (size_t i = 0; i < NumTimers; ++i)
+				timers.push_back(loop.CreateTimer([&](auto now){ fired++; }));
+			auto ini = GetSteadyNanos();
+			for (size_t i = 0; i < NumReschedules; ++i)
+				timers[i % NumTimers]->Again(std::chrono::milliseconds(1000 + i % 5000));
+			for (auto& timer : timers)
+				timer->Cancel();
+			elapsed = GetSteadyNanos() - ini;
+		});
+		Log("-benchmarkTimers() | [timers:%zu,reschedules:%zu,ns/op:%.1f]\n", NumTimers, NumReschedules, (double)elapsed / (NumReschedules + NumTimers));
+		assert(fired == 0);
+
+		//Check sub millisecond accuracy
+		lateness.reserve(NumTimers);
+		loop.Sync([&](auto now){
+			for (size_t i = 0; i < 1000; ++i)
+			{
+				auto scheduled = GetSteadyNanos() + (i % 50) * 100000;
+				timers[i] = loop.CreateTimer([&, scheduled](auto now){
+					lateness.push_back(GetSteadyNanos() - scheduled);
+				});
+				timers[i]->AgainMicroseconds(std::chrono::microseconds((i % 50) * 100));
+			}
+		});
+		std::this_thread::sleep_for(100ms);
+		loop.Sync([](auto now){});
+		loop.Stop();
+
+		Log("-benchmarkTimers() | [fired:%zu,p50:%lluus,p99:%lluus]\n",
+			lateness.size(),
+			GetPercentile(lateness, 0.50) / 1000,
+			GetPercentile(lateness, 0.99) / 1000
+		);
+		assert(lateness.size() == 1000);
+	}
+
+	void benchmarkAsync(size_t producers, bool function)
+	{
+		constexpr size_t NumTasks = 1000000;
+
+		EventLoop loop;
+		loop.Start();
+
+		std::atomic<size_t> executed = 0;
+		auto payload = std::make_shared<uint64_t>(0);
+
+		//Post tasks capturing a pointer and a shared_ptr, as done per packet by the stream transponder
+		auto ini = GetSteadyNanos();
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < producers; ++i)
+			threads.emplace_back([&](){
+				for (size_t j = 0; j < NumTasks / producers; ++j)
+				{
+					auto task = [&executed, payload](auto now){ executed += (bool)payload; };
+					if (function)
+						loop.Async(std::function<void(std::chrono::milliseconds)>(task));
+					else
+						loop.Async(task);
+				}
+			});
+		for (auto& thread : threads)
+			thread.join();
+
+		//Wait for the loop to run them all
+		while (executed != NumTasks / producers * producers)
+			std::this_thread::yield();
+		auto elapsed = GetSteadyNanos() - ini;
+
+		loop.Stop();
+
+		Log("-benchmarkAsync() | [producers:%zu,function:%d,tasks:%zu,tasks/s:%.0f]\n", producers, function, (size_t)executed, executed * 1E9 / elapsed);
+	}
+
+	void benchmarkSpin(const std::chrono::microseconds& spin)
+	{
+		constexpr size_t NumTasks = 5000;
+
+		EventLoop loop;
+		assert(loop.SetSpin(spin));
+		loop.Start();
+
+		std::vector<uint64_t> latencies;
+		std::atomic<size_t> executed = 0;
+		latencies.reserve(NumTasks);
+
+		//Post tasks spaced in time from another thread and measure how long until they are run
+		for (size_t i = 0; i < NumTasks; ++i)
+		{
+			auto posted = GetSteadyNanos();
+			loop.Async([&, posted](auto now){
+				latencies.push_back(GetSteadyNanos() - posted);
+				executed++;
+			});
+			std::this_thread::sleep_for(std::chrono::microseconds(i % 200));
+		}
+		while (executed != NumTasks)
+			std::this_thread::yield();
+
+		loop.Stop();
+
+		Log("-benchmarkSpin() | [spin:%lldus,tasks:%zu,p50:%lluns,p99:%lluns]\n",
+			spin.count(),
+			NumTasks,
+			GetPercentile(latencies, 0.50),
+			GetPercentile(latencies, 0.99)
+		);
+	}
+
+	void testSendingPriorities()
+	{
+		constexpr size_t NumVideo   = 6000;
+		constexpr size_t NumProbing = 2000;
+		constexpr size_t NumAudio   = 500;
+
+		struct Receiver : public EventLoop::Listener
+		{
+			virtual void OnRead(const int fd, const uint8_t* data, const size_t size, const uint32_t ipAddr, const uint16_t port) override
+			{
+				received[data[0]]++;
+			}
+			std::atomic<size_t> received[EventLoop::NumPriorities] = {};
+		} receiver;
+
+		//Create sending socket and two destinations on loopback
+		sockaddr_in addrs[2] = {};
+		int fds[2];
+		int sender = ::socket(AF_INET, SOCK_DGRAM, 0);
+		for (size_t i = 0; i < 2; ++i)
+		{
+			socklen_t len = sizeof(addrs[i]);
+			addrs[i].sin_family = AF_INET;
+			addrs[i].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			fds[i] = ::socket(AF_INET, SOCK_DGRAM, 0);
+			int rcvbuf = 16*1024*1024;
+			setsockopt(fds[i], SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf));
+			assert(bind(fds[i], (sockaddr*)&addrs[i], sizeof(addrs[i])) == 0);
+			assert(getsockname(fds[i], (sockaddr*)&addrs[i], &len) == 0);
+		}
+
+		EventLoop loop;
+		loop.Start(sender);
+		loop.AddSocket(fds[0], &receiver);
+		loop.AddSocket(fds[1], &receiver);
+
+		std::atomic<size_t> sent = 0;
+		std::atomic<size_t> lastAudio = 0;
+
+		//Flood first destination with video and probing, then send audio to the second one
+		loop.Future([&](auto now){
+			auto send = [&](size_t dest, EventLoop::Priority priority, size_t size) {
+				Packet packet = loop.GetPacketPool().pick();
+				packet.SetSize(size);
+				packet.GetData()[0] = priority;
+				loop.Send(ntohl(addrs[dest].sin_addr.s_addr), ntohs(addrs[dest].sin_port), std::move(packet), std::nullopt, [&, priority](auto now) {
+					//Store send order of last audio packet
+					if (priority==EventLoop::Priority::Audio)
+						lastAudio = sent.load();
+					sent++;
+				}, priority);
+			};
+			for (size_t i = 0; i < NumVideo + NumProbing; ++i)
+				send(0, i % 4 ? EventLoop::Priority::Video : EventLoop::Priority::Probing, 1200);
+			for (size_t i = 0; i < NumAudio; ++i)
+				send(1, EventLoop::Priority::Audio, 200);
+		}).wait();
+
+		//Wait until all queued packets have been sent
+		while (loop.GetSendingStats().queued)
+			std::this_thread::sleep_for(10ms);
+		std::this_thread::sleep_for(100ms);
+
+		auto stats = loop.GetSendingStats();
+
+		loop.Stop();
+
+		for (auto fd : fds)
+			close(fd);
+		close(sender);
+
+		//Audio must not be dropped and must not wait for the whole video burst
+		assert(!stats.dropped[EventLoop::Priority::Audio]);
+		assert(receiver.received[EventLoop::Priority::Audio] == NumAudio);
+		assert(lastAudio < sent / 2);
+		//Overflow of the flooded destination must be taken from probing first
+		assert(stats.dropped[EventLoop::Priority::Probing] == NumProbing);
+
+		Log("-testSendingPriorities() | [sent:%zu,lastAudio:%zu,received:{audio:%zu,video:%zu,probing:%zu},dropped:{audio:%llu,video:%llu,probing:%llu},lagging:%llu,overflown:%llu]\n",
+			(size_t)sent,
+			(size_t)lastAudio,
+			(size_t)receiver.received[EventLoop::Priority::Audio],
+			(size_t)receiver.received[EventLoop::Priority::Video],
+			(size_t)receiver.received[EventLoop::Priority::Probing],
+			stats.dropped[EventLoop::Priority::Audio],
+			stats.dropped[EventLoop::Priority::Video],
+			stats.dropped[EventLoop::Priority::Probing],
+			stats.lagging,
+			stats.overflown
+		);
+	}
+
 	virtual void testTasks()
 	{
 
@@ -0,0 +1,81 @@
+#include "test.h"
+#include "FlatHashMap.h"
+#include "ICERemoteCandidate.h"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+
+class ICEPlan: public TestPlan
+{
+public:
+	ICEPlan() : TestPlan("ICE test plan")
+	{
+		
+	}
+	
+	virtual void Execute()
+	{
+		benchmarkCandidateLookup(1000);
+		benchmarkCandidateLookup(10000);
+	}
+	
+	void benchmarkCandidateLookup(size_t connections)
+	{
+		constexpr size_t NumLookups = 2000000;
+
+		std::map<std::string, std::unique_ptr<ICERemoteCandidate>> byAddress;
+		FlatHashMap<uint64_t, std::unique_ptr<ICERemoteCandidate>> byKey;
+		std::vector<std::pair<uint32_t,uint16_t>> remotes;
+
+		//One remote candidate per connection, spread as public addresses would be
+		std::mt19937 rand(1234);
+		for (size_t i = 0; i < connections; ++i)
+		{
+			uint32_t ip = rand();
+			uint16_t port = 1024 + rand() % 60000;
+			remotes.emplace_back(ip, port);
+			byAddress.try_emplace(ICERemoteCandidate::GetRemoteAddress(ip,port), std::make_unique<ICERemoteCandidate>(ip,port,nullptr));
+			byKey.try_emplace(ICERemoteCandidate::GetRemoteKey(ip,port), std::make_unique<ICERemoteCandidate>(ip,port,nullptr));
+		}
+
+		//Random packet arrival order
+		std::vector<uint32_t> order(NumLookups);
+		for (auto& index : order)
+			index = rand() % remotes.size();
+
+		//Lookup formatting the address, as done per received datagram before
+		size_t found = 0;
+		auto ini = std::chrono::steady_clock::now();
+		for (auto index : order)
+		{
+			auto [ip, port] = remotes[index];
+			auto it = byAddress.find(ICERemoteCandidate::GetRemoteAddress(ip,port));
+			found += it!=byAddress.end() && it->second->GetPort()==port;
+		}
+		auto address = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+		assert(found==NumLookups);
+
+		//Lookup by packed key
+		found = 0;
+		ini = std::chrono::steady_clock::now();
+		for (auto index : order)
+		{
+			auto [ip, port] = remotes[index];
+			auto it = byKey.find(ICERemoteCandidate::GetRemoteKey(ip,port));
+			found += it && (*it)->GetPort()==port;
+		}
+		auto key = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+		assert(found==NumLookups);
+
+		Log("-benchmarkCandidateLookup() | [connections:%zu,lookups:%zu,string ns/op:%.1f,key ns/op:%.1f]\n",
+			connections,
+			NumLookups,
+			(double)address / NumLookups,
+			(double)key / NumLookups
+		);
+	}
+	
+};
+
+ICEPlan ice;
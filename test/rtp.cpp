@@ -1,5 +1,7 @@
 #include "test.h"
 #include "rtp.h"
+#include "rtp/TransportWideCCReceiveStats.h"
+#include <chrono>
 
 class RTPTestPlan: public TestPlan
 {
@@ -30,6 +32,8 @@ public:
 		testRTPHeader();
 		Log("RTPPacket\n");
 		testRTPPacket();
+		Log("RTPPacket in place\n");
+		testRTPPacketInPlace();
 		Log("testSenderReport\n");
 		testSenderReport();
 		Log("NACK\n");
@@ -50,6 +54,10 @@ public:
 		testExtTimestamp();
 		Log("testlostPackets\n");
 		testlostPackets();
+		Log("benchmarkTransportWideFeedback\n");
+		benchmarkTransportWideFeedback();
+		Log("benchmarkParseClone\n");
+		benchmarkParseClone();
 		end();
 	}
 	
@@ -559,12 +567,12 @@ public:
 				//For each lost
 				for (DWORD i = lastFeedbackPacketExtSeqNum+1; i<transportExtSeqNum; ++i)
 					//Add it
-					field->packets.insert(std::make_pair(i,0));
+					field->packets.emplace_back(i,0);
 			//Store last
 			lastFeedbackPacketExtSeqNum = transportExtSeqNum;
 
 			//Add this one
-			field->packets.insert(std::make_pair(transportSeqNum,time));
+			field->packets.emplace_back(transportSeqNum,time);
 
 		}
 			
@@ -629,6 +637,47 @@ public:
 		}
 	}
 	
+	void testRTPPacketInPlace()
+	{
+		RTPMap	rtpMap;
+		RTPMap	extMap;
+		extMap.SetCodecForType(1, RTPHeaderExtension::TimeOffset);
+		
+		constexpr uint8_t kPacketWithTOAndPadding[] = {
+			0xb0, 0x64, 0x12, 0x34,
+			0x65, 0x43, 0x12, 0x78,
+			0x12, 0x34, 0x56, 0x78,
+			0xbe, 0xde, 0x00, 0x01,
+			0x12, 0x00, 0x56, 0xce,
+			0x01, 0x02, 0x03, 0x04,
+			0x00, 0x00, 0x03
+		};
+		
+		//Receive it on a payload
+		auto payload = RTPPacket::PayloadPool.allocate();
+		assert(payload->SetPayload(kPacketWithTOAndPadding, sizeof(kPacketWithTOAndPadding)));
+		const BYTE* received = payload->GetMediaData();
+		
+		//Parse without copying
+		auto packet = RTPPacket::Parse(std::move(payload), rtpMap, extMap, 0);
+		assert(packet);
+		packet->Dump();
+		
+		//Check it is the same buffer without headers nor padding
+		assert(packet->GetSSRC()==0x12345678);
+		assert(packet->GetSeqNum()==0x1234);
+		assert(packet->HasTimeOffeset());
+		assert(packet->GetMediaLength()==4);
+		assert(packet->GetMediaData()==received+20);
+		assert(memcmp(packet->GetMediaData(), kPacketWithTOAndPadding+20, 4)==0);
+		
+		//Must be same as copied one
+		auto copied = RTPPacket::Parse(kPacketWithTOAndPadding, sizeof(kPacketWithTOAndPadding), rtpMap, extMap);
+		assert(copied);
+		assert(copied->GetMediaLength()==packet->GetMediaLength());
+		assert(memcmp(copied->GetMediaData(), packet->GetMediaData(), packet->GetMediaLength())==0);
+	}
+	
 	void testRTPPacket()
 	{
 		
@@ -900,6 +949,142 @@ public:
 		rtp->SetTime(25); rtp->SetExtSeqNum(25); assert(lost.AddPacket(rtp) == 3); lost.Dump(); assert(nack(lost)->pid == 22); assert(nack(lost)->blp == 0b0011);
 
 	}
+
+	void benchmarkTransportWideFeedback()
+	{
+		constexpr DWORD Packets		= 1000;
+		constexpr DWORD Iterations	= 2000;
+
+		//Receive times, 1ms apart with 5% losses
+		std::vector<QWORD> times(Packets);
+		for (DWORD i = 0; i < Packets; ++i)
+			times[i] = (i % 20 == 7) ? 0 : 1000000 + i * 1000 + (i * 37) % 500;
+
+		BYTE data[MTU*2];
+		DWORD seq = 0;
+
+		//Map based, as stored per packet and expanded into the feedback field
+		std::map<DWORD,QWORD> received;
+		DWORD mapLen = 0;
+		auto ini = std::chrono::steady_clock::now();
+		for (DWORD n = 0; n < Iterations; ++n)
+		{
+			for (DWORD i = 0; i < Packets; ++i)
+				if (times[i])
+					received[seq + i] = times[i];
+			RTCPRTPFeedback::TransportWideFeedbackMessageField field(n);
+			DWORD last = 0;
+			for (auto it = received.cbegin(); it != received.cend(); it = received.erase(it))
+			{
+				if (last)
+					for (DWORD i = last + 1; i < it->first; ++i)
+						field.packets.emplace_back(i, 0);
+				last = it->first;
+				field.packets.emplace_back(it->first, it->second);
+			}
+			field.GetSize();
+			mapLen = field.Serialize(data, sizeof(data));
+			seq += Packets;
+		}
+		auto map = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+
+		//Ring based
+		TransportWideCCReceiveStats stats;
+		DWORD ringLen = 0;
+		seq = 0;
+		ini = std::chrono::steady_clock::now();
+		for (DWORD n = 0; n < Iterations; ++n)
+		{
+			for (DWORD i = 0; i < Packets; ++i)
+				if (times[i])
+					stats.Add(seq + i, times[i]);
+			ringLen = stats.Serialize(n, data, sizeof(data));
+			seq += Packets;
+		}
+		auto ring = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+
+		assert(mapLen == ringLen);
+
+		Log("-benchmarkTransportWideFeedback() | [packets:%u,len:%u,us/feedback map:%.1f ring:%.1f]\n",
+			Packets,
+			ringLen,
+			(double)map / Iterations / 1000,
+			(double)ring / Iterations / 1000
+		);
+	}
+
+	void benchmarkParseClone()
+	{
+		constexpr DWORD Packets		= 200000;
+		constexpr DWORD Window		= 4096;
+
+		RTPMap rtpMap;
+		RTPMap extMap;
+		rtpMap.SetCodecForType(96, VideoCodec::AV1);
+		extMap.SetCodecForType(1, RTPHeaderExtension::TransportWideCC);
+		extMap.SetCodecForType(2, RTPHeaderExtension::AbsoluteSendTime);
+		extMap.SetCodecForType(3, RTPHeaderExtension::MediaStreamId);
+		extMap.SetCodecForType(4, RTPHeaderExtension::DependencyDescriptor);
+
+		//Key frame with the template structure and delta frames referencing it
+		DependencyDescriptor key;
+		key.templateDependencyStructure = TemplateDependencyStructure{};
+		key.templateDependencyStructure->dtsCount = 2;
+		key.templateDependencyStructure->chainsCount = 2;
+		key.templateDependencyStructure->frameDependencyTemplates.emplace_back(FrameDependencyTemplate{
+			{0, 0},
+			{DecodeTargetIndication::Switch, DecodeTargetIndication::Required},
+			{1},
+			{2,2}
+		});
+		key.templateDependencyStructure->decodeTargetProtectedByChain = {0,0};
+		key.activeDecodeTargets = {1,1};
+		key.templateDependencyStructure->CalculateLayerMapping();
+		DependencyDescriptor delta;
+
+		BYTE payload[1000] = {};
+		BYTE data[2][MTU];
+		DWORD len[2];
+		for (DWORD i = 0; i < 2; ++i)
+		{
+			RTPPacket packet(MediaFrame::Video, VideoCodec::AV1);
+			packet.SetPayloadType(96);
+			packet.SetSSRC(0x1234);
+			packet.SetSeqNum(i);
+			packet.SetTransportSeqNum(i);
+			packet.SetAbsSentTime(1000);
+			packet.SetMediaStreamId("video");
+			packet.SetDependencyDescriptor(i ? delta : key);
+			packet.SetPayload(payload, sizeof(payload));
+			len[i] = packet.Serialize(data[i], MTU, extMap);
+			assert(len[i]);
+		}
+
+		//Keep a window of received packets and a clone of each one, like the retransmission buffers
+		std::vector<RTPPacket::shared> received(Window);
+		std::vector<RTPPacket::shared> cloned(Window);
+
+		auto first = RTPPacket::Parse(data[0], len[0], rtpMap, extMap);
+		assert(first);
+		first->ParseDependencyDescriptor({}, {});
+		auto templateDependencyStructure = first->GetTemplateDependencyStructure();
+		auto activeDecodeTargets = first->GetActiveDecodeTargets();
+
+		auto ini = std::chrono::steady_clock::now();
+		for (DWORD i = 0; i < Packets; ++i)
+		{
+			auto packet = RTPPacket::Parse(data[i % 30 != 0], len[i % 30 != 0], rtpMap, extMap);
+			packet->ParseDependencyDescriptor(templateDependencyStructure, activeDecodeTargets);
+			cloned[i % Window] = packet->Clone();
+			received[i % Window] = std::move(packet);
+		}
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+
+		Log("-benchmarkParseClone() | [sizeof:%zu,ns/packet:%.1f]\n",
+			sizeof(RTPPacket),
+			(double)elapsed / Packets
+		);
+	}
 	
 };
 
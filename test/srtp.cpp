@@ -0,0 +1,104 @@
+#include "test.h"
+#include "SRTPSession.h"
+#include "rtp/RTPHeader.h"
+#include <chrono>
+#include <vector>
+
+class SRTPPlan: public TestPlan
+{
+public:
+	SRTPPlan() : TestPlan("SRTP test plan")
+	{
+
+	}
+
+	virtual void Execute()
+	{
+		srtp_init();
+
+		benchmarkBatch("AES_CM_128_HMAC_SHA1_80", 30);
+		benchmarkBatch("AEAD_AES_128_GCM", 28);
+	}
+
+	void benchmarkBatch(const char* suite, size_t keyLength)
+	{
+		constexpr size_t NumPackets	= 64000;
+		constexpr size_t BatchSize	= 32;
+		constexpr size_t PacketSize	= 1200;
+		constexpr size_t BufferSize	= PacketSize + 64;
+		constexpr DWORD  SSRC		= 0x12345678;
+
+		std::vector<uint8_t> key(keyLength);
+		for (size_t i = 0; i < keyLength; ++i)
+			key[i] = i;
+
+		SRTPSession send;
+		SRTPSession recv;
+		bool ok = send.Setup(suite, key.data(), key.size()) && recv.Setup(suite, key.data(), key.size());
+		assert(ok);
+		recv.AddStream(SSRC);
+
+		//Create packets with consecutive sequence numbers, first half is processed one by one and second half in batches
+		std::vector<uint8_t> buffers(NumPackets * 2 * BufferSize);
+		std::vector<SRTPSession::Span> spans(NumPackets * 2);
+		for (size_t i = 0; i < spans.size(); ++i)
+		{
+			RTPHeader header;
+			header.ssrc		= SSRC;
+			header.payloadType	= 96;
+			header.sequenceNumber	= i;
+			header.timestamp	= i * 90;
+			uint8_t* data = buffers.data() + i * BufferSize;
+			DWORD len = header.Serialize(data, BufferSize);
+			memset(data + len, i, PacketSize - len);
+			spans[i] = {data, PacketSize};
+		}
+
+		//Protect one by one
+		auto ini = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < NumPackets; ++i)
+			spans[i].size = send.ProtectRTP(spans[i].data, spans[i].size);
+		auto protectSingle = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+
+		//Protect in batches
+		size_t processed = 0;
+		ini = std::chrono::steady_clock::now();
+		for (size_t i = NumPackets; i < spans.size(); i += BatchSize)
+			processed += send.ProtectRTP(spans.data() + i, BatchSize);
+		auto protectBatch = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+		assert(processed==NumPackets);
+
+		//Unprotect one by one
+		processed = 0;
+		ini = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < NumPackets; ++i)
+			processed += recv.UnprotectRTP(spans[i].data, spans[i].size)==PacketSize;
+		auto unprotectSingle = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+		assert(processed==NumPackets);
+
+		//Unprotect in batches
+		processed = 0;
+		ini = std::chrono::steady_clock::now();
+		for (size_t i = NumPackets; i < spans.size(); i += BatchSize)
+			processed += recv.UnprotectRTP(spans.data() + i, BatchSize);
+		auto unprotectBatch = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+		assert(processed==NumPackets);
+
+		//Check decrypted sizes
+		for (size_t i = NumPackets; i < spans.size(); ++i)
+			assert(spans[i].size==PacketSize);
+
+		Log("-benchmarkBatch() | [suite:%s,packets:%zu,batch:%zu,protect ns/op single:%.1f batch:%.1f,unprotect ns/op single:%.1f batch:%.1f]\n",
+			suite,
+			NumPackets,
+			BatchSize,
+			(double)protectSingle / NumPackets,
+			(double)protectBatch / NumPackets,
+			(double)unprotectSingle / NumPackets,
+			(double)unprotectBatch / NumPackets
+		);
+	}
+
+};
+
+SRTPPlan srtpPlan;
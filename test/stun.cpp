@@ -1,6 +1,9 @@
+#include <chrono>
 #include <memory>
+#include <vector>
 #include "test.h"
 #include "stunmessage.h"
+#include "crc32calc.h"
 
 class StunPlan: public TestPlan
 {
@@ -14,6 +17,10 @@ public:
 	virtual void Execute()
 	{
 		testAuth();
+		testView();
+		benchmarkBindingRequest();
+		benchmarkCRC32(100);
+		benchmarkCRC32(1200);
 	}
 	
 	void testAuth()
@@ -51,6 +58,168 @@ public:
 		
 	}
 	
+	DWORD createRequest(BYTE* data,DWORD size,const char* pwd,bool useCandidate)
+	{
+		BYTE transId[12];
+		set4(transId,0,1234);
+		set8(transId,4,getTime());
+		auto request = std::make_unique<STUNMessage>(STUNMessage::Request,STUNMessage::Binding,transId);
+		request->AddUsernameAttribute("localusername","remoteusername");
+		request->AddAttribute(STUNMessage::Attribute::IceControlling,(QWORD)1);
+		request->AddAttribute(STUNMessage::Attribute::Priority,(DWORD)33554431);
+		if (useCandidate)
+			request->AddAttribute(STUNMessage::Attribute::UseCandidate);
+		return request->AuthenticatedFingerPrint(data,size,pwd);
+	}
+	
+	void testView()
+	{
+		const uint32_t ip = 0xC0A80102;
+		const uint16_t port = 54321;
+		
+		BYTE data[1024];
+		DWORD len = createRequest(data,sizeof(data),"pwd",true);
+		
+		//Parse with both
+		auto parsed = std::unique_ptr<STUNMessage>(STUNMessage::Parse(data,len));
+		STUNMessage::View view;
+		assert(parsed);
+		assert(view.Parse(data,len));
+		
+		//Check they agree
+		auto username = parsed->GetAttribute(STUNMessage::Attribute::Username);
+		assert(view.GetType()==parsed->GetType());
+		assert(view.GetMethod()==parsed->GetMethod());
+		assert(memcmp(view.GetTransactionId(),parsed->GetTransactionId(),12)==0);
+		assert(view.GetUsername()==std::string_view((char*)username->attr,username->size));
+		assert(view.GetPriority()==get4(parsed->GetAttribute(STUNMessage::Attribute::Priority)->attr,0));
+		assert(view.HasUseCandidate());
+		
+		//Check authentication
+		STUNMessage::HMACKey key;
+		key.SetPassword("pwd");
+		assert(view.CheckMessageIntegrity(key));
+		key.SetPassword("other");
+		assert(!view.CheckMessageIntegrity(key));
+		
+		//Long passwords are hashed first
+		std::string longPwd(100,'p');
+		len = createRequest(data,sizeof(data),longPwd.c_str(),false);
+		assert(view.Parse(data,len));
+		key.SetPassword(longPwd.c_str());
+		assert(view.CheckMessageIntegrity(key));
+		assert(!view.HasUseCandidate());
+		
+		//Corrupted fingerprint
+		data[len-1] ^= 1;
+		assert(!view.Parse(data,len));
+		data[len-1] ^= 1;
+		
+		//Truncated
+		assert(!view.Parse(data,len-4));
+		
+		//Response must be the same than the allocating path
+		len = createRequest(data,sizeof(data),"pwd",true);
+		parsed.reset(STUNMessage::Parse(data,len));
+		assert(parsed);
+		assert(view.Parse(data,len));
+		key.SetPassword("pwd");
+		auto resp = std::unique_ptr<STUNMessage>(parsed->CreateResponse());
+		resp->AddXorAddressAttribute(htonl(ip),htons(port));
+		BYTE expected[256];
+		BYTE serialized[256];
+		DWORD expectedLen = resp->AuthenticatedFingerPrint(expected,sizeof(expected),"pwd");
+		DWORD serializedLen = STUNMessage::SerializeBindingResponse(view,ip,port,key,serialized,sizeof(serialized));
+		assert(serializedLen==expectedLen);
+		assert(memcmp(expected,serialized,expectedLen)==0);
+		
+		//And the keyed request serialization
+		DWORD requestLen = parsed->AuthenticatedFingerPrint(expected,sizeof(expected),"pwd");
+		assert(parsed->AuthenticatedFingerPrint(serialized,sizeof(serialized),key)==requestLen);
+		assert(memcmp(expected,serialized,requestLen)==0);
+		
+		//Too small
+		assert(!STUNMessage::SerializeBindingResponse(view,ip,port,key,serialized,32));
+	}
+	
+	void benchmarkCRC32(DWORD size)
+	{
+		constexpr size_t NumIterations = 200000;
+		
+		std::vector<BYTE> data(size);
+		for (DWORD i = 0; i < size; ++i)
+			data[i] = i * 13;
+		
+		for (auto engine : {CRC32Calc::Table, CRC32Calc::SlicingBy8, CRC32Calc::PCLMUL})
+		{
+			if (!CRC32Calc::IsSupported(engine))
+				continue;
+			DWORD acc = 0;
+			auto ini = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < NumIterations; ++i)
+			{
+				CRC32Calc crc32calc(engine);
+				acc += crc32calc.Update(data.data(), size);
+				data[0]++;
+			}
+			auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+			Log("-benchmarkCRC32() | [engine:%s,size:%u,ns/op:%.1f,GB/s:%.2f,acc:%x]\n",
+				CRC32Calc::GetEngineName(engine),
+				size,
+				(double)elapsed / NumIterations,
+				(double)size * NumIterations / elapsed,
+				acc
+			);
+		}
+	}
+	
+	void benchmarkBindingRequest()
+	{
+		constexpr size_t NumRequests = 200000;
+		const uint32_t ip = 0xC0A80102;
+		const uint16_t port = 54321;
+		const char* pwd = "0123456789abcdefghijklmn";
+		
+		BYTE data[1024];
+		DWORD len = createRequest(data,sizeof(data),pwd,true);
+		BYTE buffer[1500];
+		size_t bytes = 0;
+		
+		//Allocating path, as done before
+		auto ini = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < NumRequests; ++i)
+		{
+			auto stun = std::unique_ptr<STUNMessage>(STUNMessage::Parse(data,len));
+			auto attr = stun->GetAttribute(STUNMessage::Attribute::Username);
+			std::string username((char*)attr->attr,attr->size);
+			bool ok = stun->CheckAuthenticatedFingerPrint(data,len,pwd);
+			auto resp = std::unique_ptr<STUNMessage>(stun->CreateResponse());
+			resp->AddXorAddressAttribute(htonl(ip),htons(port));
+			bytes += ok * resp->AuthenticatedFingerPrint(buffer,sizeof(buffer),pwd) + username.size();
+		}
+		auto allocating = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+		
+		//In place path with cached key
+		STUNMessage::HMACKey key;
+		ini = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < NumRequests; ++i)
+		{
+			STUNMessage::View stun;
+			stun.Parse(data,len);
+			key.SetPassword(pwd);
+			bool ok = stun.CheckMessageIntegrity(key);
+			bytes += ok * STUNMessage::SerializeBindingResponse(stun,ip,port,key,buffer,sizeof(buffer)) + stun.GetUsername().size();
+		}
+		auto inplace = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ini).count();
+		
+		Log("-benchmarkBindingRequest() | [requests:%zu,bytes:%zu,ns/op allocating:%.1f in place:%.1f]\n",
+			NumRequests,
+			bytes,
+			(double)allocating / NumRequests,
+			(double)inplace / NumRequests
+		);
+	}
+	
 };
 
 StunPlan stun;
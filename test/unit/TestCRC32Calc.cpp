@@ -0,0 +1,73 @@
+#include "TestCommon.h"
+#include "crc32calc.h"
+
+#include <random>
+#include <vector>
+
+static const CRC32Calc::Engine engines[] = {CRC32Calc::Table, CRC32Calc::SlicingBy8, CRC32Calc::PCLMUL};
+
+TEST(TestCRC32Calc, CheckValue)
+{
+	const char* check = "123456789";
+	for (auto engine : engines)
+	{
+		CRC32Calc crc32calc(engine);
+		ASSERT_EQ(crc32calc.Update((const BYTE*)check, 9), 0xCBF43926) << CRC32Calc::GetEngineName(engine);
+	}
+}
+
+TEST(TestCRC32Calc, MatchesTable)
+{
+	std::mt19937 random(1234);
+	std::vector<BYTE> data(4096 + 16);
+	for (auto& byte : data)
+		byte = random();
+
+	//All sizes around the block boundaries and unaligned starts
+	for (size_t offset = 0; offset < 16; offset += 3)
+	{
+		for (DWORD size = 0; size < 300; ++size)
+		{
+			CRC32Calc table(CRC32Calc::Table);
+			DWORD expected = table.Update(data.data() + offset, size);
+			for (auto engine : engines)
+			{
+				CRC32Calc crc32calc(engine);
+				ASSERT_EQ(crc32calc.Update(data.data() + offset, size), expected) << CRC32Calc::GetEngineName(engine) << " size " << size << " offset " << offset;
+			}
+		}
+	}
+
+	//Big ones
+	CRC32Calc table(CRC32Calc::Table);
+	DWORD expected = table.Update(data.data(), 4096);
+	for (auto engine : engines)
+	{
+		CRC32Calc crc32calc(engine);
+		ASSERT_EQ(crc32calc.Update(data.data(), 4096), expected) << CRC32Calc::GetEngineName(engine);
+	}
+}
+
+TEST(TestCRC32Calc, Incremental)
+{
+	std::vector<BYTE> data(1500);
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = i * 7;
+
+	CRC32Calc table(CRC32Calc::Table);
+	DWORD expected = table.Update(data.data(), data.size());
+
+	//Split in chunks of different sizes
+	for (auto engine : engines)
+	{
+		CRC32Calc crc32calc(engine);
+		DWORD pos = 0;
+		for (DWORD chunk = 1; pos < data.size(); chunk = chunk * 3 + 1)
+		{
+			DWORD len = std::min<DWORD>(chunk, data.size() - pos);
+			crc32calc.Update(data.data() + pos, len);
+			pos += len;
+		}
+		ASSERT_EQ(crc32calc.GetValue(), expected) << CRC32Calc::GetEngineName(engine);
+	}
+}
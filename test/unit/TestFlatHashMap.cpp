@@ -0,0 +1,112 @@
+#include "TestCommon.h"
+#include "FlatHashMap.h"
+
+#include <memory>
+#include <random>
+#include <unordered_map>
+
+TEST(TestFlatHashMap, Basic)
+{
+	FlatHashMap<uint64_t, int> map;
+	ASSERT_TRUE(map.empty());
+	ASSERT_EQ(map.find(1), nullptr);
+
+	auto [value, inserted] = map.try_emplace(1, 10);
+	ASSERT_TRUE(inserted);
+	ASSERT_EQ(*value, 10);
+
+	//Existing ones are not overwritten
+	auto [existing, again] = map.try_emplace(1, 20);
+	ASSERT_FALSE(again);
+	ASSERT_EQ(*existing, 10);
+	ASSERT_EQ(map.size(), 1);
+
+	//Default constructed on access
+	map[2] += 5;
+	ASSERT_EQ(*map.find(2), 5);
+	ASSERT_EQ(map.size(), 2);
+	ASSERT_TRUE(map.erase(2));
+
+	ASSERT_TRUE(map.erase(1));
+	ASSERT_FALSE(map.erase(1));
+	ASSERT_EQ(map.find(1), nullptr);
+	ASSERT_TRUE(map.empty());
+}
+
+TEST(TestFlatHashMap, MoveOnly)
+{
+	FlatHashMap<uint64_t, std::unique_ptr<int>> map;
+
+	//Boxed values keep their address while the table grows
+	int* first = map.try_emplace(0, std::make_unique<int>(0)).first->get();
+	for (int i = 1; i < 1000; ++i)
+		map.try_emplace(i, std::make_unique<int>(i));
+	ASSERT_EQ(map.find(0)->get(), first);
+
+	size_t count = 0;
+	for (const auto& [key, value] : map)
+	{
+		ASSERT_EQ(*value, (int)key);
+		count++;
+	}
+	ASSERT_EQ(count, 1000);
+
+	map.clear();
+	ASSERT_TRUE(map.empty());
+	ASSERT_EQ(map.find(0), nullptr);
+}
+
+TEST(TestFlatHashMap, Random)
+{
+	std::mt19937_64 rand(1234);
+	FlatHashMap<uint64_t, uint64_t> map;
+	std::unordered_map<uint64_t, uint64_t> reference;
+
+	for (size_t round = 0; round < 200000; ++round)
+	{
+		//Packed ip:port keys from a small range so there are collisions and removals hit
+		uint64_t key = (uint64_t)(0x0A000000 + rand() % 256) << 16 | (rand() % 64);
+		switch (rand() % 3)
+		{
+			case 0:
+			{
+				auto [value, inserted] = map.try_emplace(key, round);
+				auto [it, expected] = reference.try_emplace(key, round);
+				ASSERT_EQ(inserted, expected);
+				ASSERT_EQ(*value, it->second);
+				break;
+			}
+			case 1:
+				ASSERT_EQ(map.erase(key), reference.erase(key) > 0);
+				break;
+			case 2:
+			{
+				auto value = map.find(key);
+				auto it = reference.find(key);
+				ASSERT_EQ(value != nullptr, it != reference.end());
+				if (value)
+				{
+					ASSERT_EQ(*value, it->second);
+				}
+				break;
+			}
+		}
+		ASSERT_EQ(map.size(), reference.size());
+	}
+
+	//Iteration visits each entry once
+	size_t count = 0;
+	for (auto& entry : map)
+	{
+		ASSERT_EQ(reference.at(entry.first), entry.second);
+		count++;
+	}
+	ASSERT_EQ(count, reference.size());
+
+	//All remaining ones are reachable
+	for (const auto& [key, value] : reference)
+	{
+		ASSERT_NE(map.find(key), nullptr);
+		ASSERT_EQ(*map.find(key), value);
+	}
+}
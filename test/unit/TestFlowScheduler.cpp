@@ -0,0 +1,180 @@
+#include "TestCommon.h"
+#include "FlowScheduler.h"
+
+#include <string>
+
+struct TestItem
+{
+	std::string id;
+	size_t size = 0;
+};
+
+enum TestPriority : uint8_t
+{
+	Control,
+	Audio,
+	Video,
+	Retransmission,
+	Probing,
+	Count
+};
+
+using Scheduler = FlowScheduler<TestItem, TestPriority::Count>;
+
+class TestFlowScheduler : public testing::Test
+{
+public:
+	Scheduler::Result Enqueue(Scheduler& scheduler, uint64_t key, uint8_t priority, const std::string& id, size_t size = 100)
+	{
+		TestItem item{id, size};
+		auto result = scheduler.Enqueue(key, priority, std::move(item), [this](TestItem&& item, uint8_t priority) {
+			dropped.push_back(item.id);
+		});
+		//Not moved if it was not queued
+		if (result!=Scheduler::Queued)
+		{
+			EXPECT_EQ(item.id, id);
+		}
+		return result;
+	}
+
+	std::vector<std::string> Dequeue(Scheduler& scheduler, size_t max = 1000)
+	{
+		std::vector<TestItem> items;
+		scheduler.Dequeue(items, max, [](const TestItem& item) { return item.size; });
+		std::vector<std::string> ids;
+		for (const auto& item : items)
+			ids.push_back(item.id);
+		return ids;
+	}
+protected:
+	std::vector<std::string> dropped;
+};
+
+TEST_F(TestFlowScheduler, PriorityOrder)
+{
+	Scheduler scheduler(100, 100, 10000);
+
+	Enqueue(scheduler, 1, Probing, "p1");
+	Enqueue(scheduler, 1, Video, "v1");
+	Enqueue(scheduler, 1, Audio, "a1");
+	Enqueue(scheduler, 1, Video, "v2");
+	Enqueue(scheduler, 1, Control, "c1");
+	Enqueue(scheduler, 1, Retransmission, "r1");
+	Enqueue(scheduler, 1, Audio, "a2");
+	ASSERT_EQ(scheduler.GetQueued(), 7);
+	ASSERT_EQ(scheduler.GetQueued(Audio), 2);
+	ASSERT_EQ(scheduler.GetFlows(), 1);
+
+	//Higher priority first, in order within the same priority
+	ASSERT_EQ(Dequeue(scheduler), (std::vector<std::string>{"c1", "a1", "a2", "v1", "v2", "r1", "p1"}));
+	ASSERT_EQ(scheduler.GetQueued(), 0);
+	ASSERT_EQ(scheduler.GetQueued(Audio), 0);
+}
+
+TEST_F(TestFlowScheduler, DeficitCarryOver)
+{
+	Scheduler scheduler(100, 100, 500);
+
+	//Flow 1 items are bigger than the quantum
+	Enqueue(scheduler, 1, Video, "a1", 700);
+	Enqueue(scheduler, 1, Video, "a2", 700);
+	for (size_t i = 1; i <= 4; ++i)
+		Enqueue(scheduler, 2, Video, "b" + std::to_string(i), 200);
+
+	//Flow 1 can't send on its first turn and flow 2 fills the batch
+	ASSERT_EQ(Dequeue(scheduler, 2), (std::vector<std::string>{"b1", "b2"}));
+	ASSERT_EQ(scheduler.GetDeficit(1), 500);
+	ASSERT_EQ(scheduler.GetDeficit(2), 100);
+
+	//Flow 2 keeps its turn but what is left is not enough, flow 1 carried its deficit over
+	ASSERT_EQ(Dequeue(scheduler, 1), (std::vector<std::string>{"a1"}));
+	ASSERT_EQ(scheduler.GetDeficit(1), 1000 - 700);
+	ASSERT_EQ(scheduler.GetDeficit(2), 100);
+
+	//Unused deficit is kept for next turns while the flow is active
+	ASSERT_EQ(Dequeue(scheduler), (std::vector<std::string>{"b3", "b4", "a2"}));
+	ASSERT_EQ(scheduler.GetQueued(), 0);
+}
+
+TEST_F(TestFlowScheduler, RoundRobin)
+{
+	Scheduler scheduler(100, 100, 250);
+
+	for (size_t i = 1; i <= 3; ++i)
+	{
+		Enqueue(scheduler, 1, Video, "a" + std::to_string(i));
+		Enqueue(scheduler, 2, Video, "b" + std::to_string(i));
+	}
+
+	//Two items per turn
+	ASSERT_EQ(Dequeue(scheduler), (std::vector<std::string>{"a1", "a2", "b1", "b2", "a3", "b3"}));
+}
+
+TEST_F(TestFlowScheduler, IdleFlowEviction)
+{
+	Scheduler scheduler(100, 100, 1000);
+
+	Enqueue(scheduler, 1, Audio, "a1");
+	Enqueue(scheduler, 2, Audio, "b1");
+	ASSERT_EQ(scheduler.GetFlows(), 2);
+
+	//Flows are removed when idle, with its unused deficit
+	ASSERT_EQ(Dequeue(scheduler), (std::vector<std::string>{"a1", "b1"}));
+	ASSERT_EQ(scheduler.GetFlows(), 0);
+	ASSERT_FALSE(scheduler.HasFlow(1));
+
+	//Starts again without deficit, needs two turns for a bigger item
+	Enqueue(scheduler, 1, Audio, "a2", 1500);
+	ASSERT_EQ(scheduler.GetDeficit(1), 0);
+	ASSERT_EQ(Dequeue(scheduler), (std::vector<std::string>{"a2"}));
+	ASSERT_FALSE(scheduler.HasFlow(1));
+
+	//Deficit left from the second turn is not kept either
+	Enqueue(scheduler, 1, Audio, "a3");
+	ASSERT_EQ(scheduler.GetDeficit(1), 0);
+	ASSERT_EQ(Dequeue(scheduler), (std::vector<std::string>{"a3"}));
+	ASSERT_EQ(scheduler.GetFlows(), 0);
+}
+
+TEST_F(TestFlowScheduler, FlowFull)
+{
+	Scheduler scheduler(100, 2, 1000);
+
+	ASSERT_EQ(Enqueue(scheduler, 1, Video, "v1"), Scheduler::Queued);
+	ASSERT_EQ(Enqueue(scheduler, 1, Video, "v2"), Scheduler::Queued);
+
+	//Oldest lower priority one is dropped
+	ASSERT_EQ(Enqueue(scheduler, 1, Audio, "a1"), Scheduler::Queued);
+	ASSERT_EQ(dropped, (std::vector<std::string>{"v1"}));
+
+	//Nothing lower to drop
+	ASSERT_EQ(Enqueue(scheduler, 1, Probing, "p1"), Scheduler::FlowFull);
+	ASSERT_EQ(Enqueue(scheduler, 1, Video, "v3"), Scheduler::FlowFull);
+	ASSERT_EQ(dropped.size(), 1);
+
+	//Other flows are not affected
+	ASSERT_EQ(Enqueue(scheduler, 2, Probing, "p2"), Scheduler::Queued);
+	ASSERT_EQ(scheduler.GetQueued(), 3);
+	ASSERT_EQ(Dequeue(scheduler), (std::vector<std::string>{"a1", "v2", "p2"}));
+}
+
+TEST_F(TestFlowScheduler, Overflown)
+{
+	Scheduler scheduler(3, 100, 1000);
+
+	Enqueue(scheduler, 1, Video, "v1");
+	Enqueue(scheduler, 1, Video, "v2");
+	Enqueue(scheduler, 1, Video, "v3");
+
+	//Drops lower priority from other flows
+	ASSERT_EQ(Enqueue(scheduler, 2, Audio, "a1"), Scheduler::Queued);
+	ASSERT_EQ(dropped, (std::vector<std::string>{"v1"}));
+	ASSERT_EQ(scheduler.GetQueued(), 3);
+
+	//Nothing lower to drop, new flow is not kept
+	ASSERT_EQ(Enqueue(scheduler, 3, Video, "v4"), Scheduler::Overflown);
+	ASSERT_EQ(scheduler.GetFlows(), 2);
+	ASSERT_FALSE(scheduler.HasFlow(3));
+	ASSERT_EQ(Dequeue(scheduler), (std::vector<std::string>{"v2", "v3", "a1"}));
+}
@@ -0,0 +1,84 @@
+#include "TestCommon.h"
+#include "InlineFunction.h"
+
+#include <array>
+
+struct Counted
+{
+	Counted(int& alive) : alive(&alive)			{ (*this->alive)++; }
+	Counted(const Counted& other) : alive(other.alive)	{ (*alive)++; }
+	Counted(Counted&& other) noexcept : alive(other.alive)	{ (*alive)++; }
+	~Counted()						{ (*alive)--; }
+	int* alive;
+};
+
+using Function = InlineFunction<int(int), 32>;
+
+TEST(TestInlineFunction, Empty)
+{
+	Function func;
+	ASSERT_FALSE(func);
+	Function null(nullptr);
+	ASSERT_FALSE(null);
+}
+
+TEST(TestInlineFunction, Inline)
+{
+	int alive = 0;
+	{
+		Counted counted(alive);
+		int base = 10;
+		auto lambda = [base, counted](int value) { return base + value; };
+		ASSERT_TRUE(Function::IsInline<decltype(lambda)>);
+
+		Function func(std::move(lambda));
+		ASSERT_TRUE(func);
+		ASSERT_EQ(func(5), 15);
+
+		//Move leaves source empty and keeps a single live copy in the function
+		Function moved(std::move(func));
+		ASSERT_FALSE(func);
+		ASSERT_TRUE(moved);
+		ASSERT_EQ(moved(1), 11);
+		ASSERT_EQ(alive, 3);
+
+		moved.Reset();
+		ASSERT_FALSE(moved);
+		ASSERT_EQ(alive, 2);
+	}
+	ASSERT_EQ(alive, 0);
+}
+
+TEST(TestInlineFunction, Heap)
+{
+	int alive = 0;
+	{
+		std::array<int, 64> big = {};
+		big[3] = 7;
+		Counted counted(alive);
+		auto lambda = [big, counted](int value) { return big[3] * value; };
+		ASSERT_FALSE(Function::IsInline<decltype(lambda)>);
+
+		Function func(std::move(lambda));
+		ASSERT_EQ(func(2), 14);
+
+		//Assignment destroys previous callable
+		Function other([](int value) { return value; });
+		other = std::move(func);
+		ASSERT_FALSE(func);
+		ASSERT_EQ(other(3), 21);
+		ASSERT_EQ(alive, 3);
+	}
+	ASSERT_EQ(alive, 0);
+}
+
+TEST(TestInlineFunction, MoveOnly)
+{
+	auto ptr = std::make_unique<int>(42);
+	Function func([ptr = std::move(ptr)](int value) mutable { return *ptr + value; });
+	ASSERT_EQ(func(0), 42);
+
+	Function moved;
+	moved = std::move(func);
+	ASSERT_EQ(moved(1), 43);
+}
@@ -0,0 +1,142 @@
+#include "TestCommon.h"
+#include "Pacer.h"
+#include "video.h"
+#include "audio.h"
+
+class TestPacer : public testing::Test
+{
+public:
+	static RTPPacket::shared CreatePacket(MediaFrame::Type type, WORD seq, DWORD size = 1000)
+	{
+		auto packet = type==MediaFrame::Audio ?
+			std::make_shared<RTPPacket>(MediaFrame::Audio, AudioCodec::OPUS) :
+			std::make_shared<RTPPacket>(MediaFrame::Video, VideoCodec::VP8);
+		packet->SetSeqNum(seq);
+		BYTE payload[1200] = {};
+		packet->SetPayload(payload, size);
+		return packet;
+	}
+
+	Pacer pacer;
+};
+
+TEST_F(TestPacer, Unpaced)
+{
+	//No target bitrate, everything goes out right away
+	for (WORD i = 0; i < 10; ++i)
+		pacer.Enqueue(1, CreatePacket(MediaFrame::Video, i), 1000);
+
+	for (WORD i = 0; i < 10; ++i)
+	{
+		auto packet = pacer.Dequeue(1000);
+		ASSERT_TRUE(packet);
+		EXPECT_EQ(i, packet->GetSeqNum());
+	}
+	EXPECT_TRUE(pacer.IsEmpty());
+	EXPECT_FALSE(pacer.Dequeue(1000));
+}
+
+TEST_F(TestPacer, Rate)
+{
+	//1000 bytes packets at 1Mbps pacing rate
+	pacer.SetPacingFactor(1.0f);
+	pacer.SetTargetBitrate(1000000);
+
+	//Keyframe burst
+	QWORD now = 1000000;
+	for (WORD i = 0; i < 100; ++i)
+		pacer.Enqueue(1, CreatePacket(MediaFrame::Video, i), now);
+
+	//Drain it following the wake up times
+	DWORD sent = 0;
+	DWORD bytes = 0;
+	while (!pacer.IsEmpty())
+	{
+		now = pacer.GetNextSendTime(now);
+		while (auto packet = pacer.Dequeue(now))
+		{
+			bytes += Pacer::GetPacketSize(packet);
+			sent++;
+		}
+	}
+	EXPECT_EQ(100, sent);
+
+	//Should have taken the time needed at the pacing rate, minus the first packet sent on debt
+	QWORD elapsed = now - 1000000;
+	QWORD expected = (QWORD)(bytes - Pacer::GetPacketSize(CreatePacket(MediaFrame::Video, 0))) * 8;
+	EXPECT_GE(elapsed, expected * 95 / 100);
+	EXPECT_LE(elapsed, expected * 105 / 100);
+
+	//Stats
+	auto stats = pacer.GetStats(now);
+	EXPECT_EQ(0, stats.queuedPackets);
+	EXPECT_EQ(0, stats.queuedBytes);
+	EXPECT_EQ(1000000, stats.pacingBitrate);
+	EXPECT_GT(stats.maxQueueDelay, stats.avgQueueDelay);
+	EXPECT_GE(stats.maxQueueDelay, elapsed * 95 / 100);
+}
+
+TEST_F(TestPacer, AudioFirst)
+{
+	pacer.SetTargetBitrate(100000);
+
+	//Video burst first, then audio
+	for (WORD i = 0; i < 10; ++i)
+		pacer.Enqueue(1, CreatePacket(MediaFrame::Video, i), 1000);
+	pacer.Enqueue(2, CreatePacket(MediaFrame::Audio, 100, 100), 1000);
+
+	//Audio overtakes the video
+	auto packet = pacer.Dequeue(1000);
+	ASSERT_TRUE(packet);
+	EXPECT_EQ(MediaFrame::Audio, packet->GetMediaType());
+	EXPECT_EQ(10, pacer.GetStats(1000).queuedPackets);
+}
+
+TEST_F(TestPacer, RoundRobin)
+{
+	//Two video groups get interleaved
+	for (WORD i = 0; i < 4; ++i)
+		pacer.Enqueue(1, CreatePacket(MediaFrame::Video, i), 1000);
+	for (WORD i = 0; i < 4; ++i)
+		pacer.Enqueue(2, CreatePacket(MediaFrame::Video, 100 + i), 1000);
+
+	for (WORD i = 0; i < 4; ++i)
+	{
+		EXPECT_EQ(i, pacer.Dequeue(1000)->GetSeqNum());
+		EXPECT_EQ(100 + i, pacer.Dequeue(1000)->GetSeqNum());
+	}
+}
+
+TEST_F(TestPacer, MaxQueueDelay)
+{
+	pacer.SetPacingFactor(1.0f);
+	pacer.SetTargetBitrate(10000);
+	pacer.SetMaxQueueDelay(50000);
+
+	for (WORD i = 0; i < 10; ++i)
+		pacer.Enqueue(1, CreatePacket(MediaFrame::Video, i), 1000);
+
+	//First one goes on debt, second has to wait
+	EXPECT_TRUE(pacer.Dequeue(1000));
+	EXPECT_FALSE(pacer.Dequeue(1000));
+	EXPECT_EQ(51000, pacer.GetNextSendTime(1000));
+
+	//Once expired everything is released
+	DWORD sent = 0;
+	while (pacer.Dequeue(51000))
+		sent++;
+	EXPECT_EQ(9, sent);
+}
+
+TEST_F(TestPacer, Remove)
+{
+	pacer.Enqueue(1, CreatePacket(MediaFrame::Video, 0), 1000);
+	pacer.Enqueue(2, CreatePacket(MediaFrame::Audio, 1, 100), 1000);
+	pacer.Remove(2);
+
+	auto stats = pacer.GetStats(1000);
+	EXPECT_EQ(1, stats.queuedPackets);
+	EXPECT_EQ(Pacer::GetPacketSize(CreatePacket(MediaFrame::Video, 0)), stats.queuedBytes);
+	EXPECT_EQ(MediaFrame::Video, pacer.Dequeue(1000)->GetMediaType());
+	EXPECT_TRUE(pacer.IsEmpty());
+}
@@ -0,0 +1,99 @@
+#include "TestCommon.h"
+#include "PacketPool.h"
+
+#include <thread>
+
+TEST(TestPacketPool, Reuse)
+{
+	PacketPool pool(64);
+	ASSERT_EQ(pool.size(), 64);
+
+	//Picked packets are reset and keep their buffer
+	Packet packet = pool.pick();
+	uint8_t* data = packet.GetData();
+	packet.SetSize(100);
+	pool.release(std::move(packet));
+
+	Packet again = pool.pick();
+	ASSERT_EQ(again.GetData(), data);
+	ASSERT_EQ(again.GetSize(), 0);
+	pool.release(std::move(again));
+
+	pool.Flush();
+	auto stats = pool.GetStats();
+	ASSERT_EQ(stats.hits, 2);
+	ASSERT_EQ(stats.misses, 0);
+	ASSERT_EQ(stats.available, 64);
+}
+
+TEST(TestPacketPool, MovedOut)
+{
+	PacketPool pool(32);
+
+	//Drain preallocated ones
+	std::vector<Packet> packets;
+	for (size_t i = 0; i < 32; ++i)
+		packets.push_back(pool.pick());
+
+	//Moved out packets must not be pooled
+	Packet moved = std::move(packets[0]);
+	pool.release(std::move(packets[0]));
+	pool.release(std::move(moved));
+
+	Packet packet = pool.pick();
+	ASSERT_TRUE(packet.GetCapacity());
+	ASSERT_TRUE(packet.SetSize(MTU));
+}
+
+TEST(TestPacketPool, Overflow)
+{
+	PacketPool pool(32);
+
+	//Release more packets than the pool can hold
+	for (size_t i = 0; i < 256; ++i)
+		pool.release(Packet());
+	pool.Flush();
+
+	auto stats = pool.GetStats();
+	ASSERT_GT(stats.dropped, 0);
+	ASSERT_LE(stats.available, pool.size());
+}
+
+TEST(TestPacketPool, CrossThread)
+{
+	constexpr size_t NumPackets = 200000;
+	constexpr size_t InFlight = 512;
+
+	PacketPool pool(1024);
+	moodycamel::ConcurrentQueue<Packet> queue;
+	std::atomic<size_t> released = 0;
+
+	//Consumer releases on another thread, as the event loop does after sending
+	std::thread consumer([&](){
+		Packet packet;
+		while (released < NumPackets)
+			if (queue.try_dequeue(packet))
+			{
+				pool.release(std::move(packet));
+				released++;
+			}
+		pool.Flush();
+	});
+
+	//Producer picks as the transport does
+	for (size_t i = 0; i < NumPackets; ++i)
+	{
+		while (i - released > InFlight)
+			std::this_thread::yield();
+		Packet packet = pool.pick();
+		packet.SetSize(1);
+		queue.enqueue(std::move(packet));
+	}
+	consumer.join();
+	pool.Flush();
+
+	//Buffers come back to the producer instead of being allocated again
+	auto stats = pool.GetStats();
+	ASSERT_EQ(stats.hits + stats.misses, NumPackets);
+	ASSERT_EQ(stats.misses, 0);
+}
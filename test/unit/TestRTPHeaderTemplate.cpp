@@ -0,0 +1,215 @@
+#include "TestCommon.h"
+#include "rtp/RTPHeaderTemplate.h"
+#include "audio.h"
+#include "video.h"
+
+class TestRTPHeaderTemplate : public testing::Test
+{
+public:
+	static constexpr BYTE AudioLevelId = 1;
+	static constexpr BYTE TransportWideCCId = 3;
+	static constexpr BYTE AbsSentTimeId = 5;
+	static constexpr BYTE PlayoutDelayId = 6;
+	static constexpr BYTE MidId = 9;
+
+	TestRTPHeaderTemplate()
+	{
+		ext.SetCodecForType(AudioLevelId, RTPHeaderExtension::SSRCAudioLevel);
+		ext.SetCodecForType(TransportWideCCId, RTPHeaderExtension::TransportWideCC);
+		ext.SetCodecForType(AbsSentTimeId, RTPHeaderExtension::AbsoluteSendTime);
+		ext.SetCodecForType(PlayoutDelayId, RTPHeaderExtension::PlayoutDelay);
+		ext.SetCodecForType(MidId, RTPHeaderExtension::MediaStreamId);
+	}
+
+	static RTPPacket::shared CreatePacket(MediaFrame::Type media, WORD seq)
+	{
+		auto packet = std::make_shared<RTPPacket>(media, media==MediaFrame::Audio ? (BYTE)AudioCodec::OPUS : (BYTE)VideoCodec::VP8);
+		packet->SetSeqNum(seq);
+		packet->SetSSRC(0x1234);
+		packet->SetPayloadType(96 + seq % 2);
+		packet->SetMark(seq % 3 == 0);
+		packet->SetTimestamp(seq * 3000);
+		packet->SetMediaStreamId("video");
+		packet->SetTransportSeqNum(seq + 100);
+		packet->SetAbsSentTime(1000000 + seq * 33);
+		BYTE payload[1000];
+		memset(payload, seq, sizeof(payload));
+		packet->SetPayload(payload, 100 + seq % 900);
+		return packet;
+	}
+
+	std::vector<BYTE> Serialize(const RTPPacket::shared& packet)
+	{
+		std::vector<BYTE> data(MTU);
+		data.resize(packet->Serialize(data.data(), data.size(), ext));
+		return data;
+	}
+
+	std::vector<BYTE> SerializeTemplate(const RTPPacket::shared& packet)
+	{
+		std::vector<BYTE> data(MTU);
+		data.resize(headerTemplate.Serialize(*packet, data.data(), data.size()));
+		return data;
+	}
+
+	void SetTemplate(const RTPPacket::shared& packet)
+	{
+		auto data = Serialize(packet);
+		ASSERT_TRUE(headerTemplate.Set(*packet, ext, data.data(), data.size()));
+	}
+protected:
+	RTPMap ext;
+	RTPHeaderTemplate headerTemplate;
+};
+
+TEST_F(TestRTPHeaderTemplate, Empty)
+{
+	auto packet = CreatePacket(MediaFrame::Video, 1);
+	ASSERT_TRUE(headerTemplate.IsEmpty());
+	ASSERT_FALSE(headerTemplate.Matches(*packet, ext));
+	ASSERT_TRUE(SerializeTemplate(packet).empty());
+}
+
+TEST_F(TestRTPHeaderTemplate, SameAsSerialize)
+{
+	SetTemplate(CreatePacket(MediaFrame::Video, 1));
+
+	for (WORD seq = 2; seq < 1000; ++seq)
+	{
+		auto packet = CreatePacket(MediaFrame::Video, seq);
+		ASSERT_TRUE(headerTemplate.Matches(*packet, ext));
+		ASSERT_EQ(Serialize(packet), SerializeTemplate(packet)) << "seq " << seq;
+	}
+}
+
+TEST_F(TestRTPHeaderTemplate, AudioLevel)
+{
+	for (WORD seq = 1; seq < 128; ++seq)
+	{
+		auto base = CreatePacket(MediaFrame::Audio, seq);
+		//Add vad and level
+		RTPHeaderExtension extension = base->GetRTPHeaderExtension();
+		extension.hasAudioLevel = true;
+		extension.vad = seq % 2;
+		extension.level = seq;
+		auto packet = std::make_shared<RTPPacket>(MediaFrame::Audio, AudioCodec::OPUS, base->GetRTPHeader(), extension);
+		packet->SetPayload(base->GetMediaData(), base->GetMediaLength());
+		packet->SetPlayoutDelay(0, 100);
+		if (seq == 1)
+			SetTemplate(packet);
+		ASSERT_TRUE(headerTemplate.Matches(*packet, ext));
+		ASSERT_EQ(Serialize(packet), SerializeTemplate(packet)) << "seq " << seq;
+	}
+}
+
+TEST_F(TestRTPHeaderTemplate, VP8PictureIdRewrite)
+{
+	//Template set before switching to another simulcast layer
+	SetTemplate(CreatePacket(MediaFrame::Video, 1));
+
+	for (WORD seq = 2; seq < 300; ++seq)
+	{
+		auto packet = CreatePacket(MediaFrame::Video, seq);
+
+		//Payload starting with a vp8 descriptor, with one or two bytes picture id and tl0picidx
+		VP8PayloadDescriptor descriptor(true, 0);
+		descriptor.extendedControlBitsPresent = true;
+		descriptor.pictureIdPresent = true;
+		descriptor.pictureIdLength = seq % 2 ? 1 : 2;
+		descriptor.pictureId = seq & 0x7F;
+		descriptor.temporalLevelZeroIndexPresent = true;
+		descriptor.temporalLevelZeroIndex = seq;
+		BYTE* payload = packet->AdquireMediaData();
+		ASSERT_EQ(descriptor.Serialize(payload, packet->GetMediaLength()), descriptor.GetSize());
+		packet->vp8PayloadDescriptor = descriptor;
+
+		//Rewrite ids as the transponder does
+		packet->rewitePictureIds = true;
+		packet->vp8PayloadDescriptor->pictureId = 1000 + seq;
+		packet->vp8PayloadDescriptor->temporalLevelZeroIndex = seq + 7;
+
+		ASSERT_TRUE(headerTemplate.Matches(*packet, ext));
+		auto data = SerializeTemplate(packet);
+		ASSERT_EQ(Serialize(packet), data) << "seq " << seq;
+
+		//Check rewritten descriptor
+		VP8PayloadDescriptor rewritten;
+		DWORD len = rewritten.Parse(data.data() + headerTemplate.GetHeaderSize(), data.size() - headerTemplate.GetHeaderSize());
+		ASSERT_EQ(len, 5);
+		ASSERT_EQ(rewritten.pictureId, 1000 + seq);
+		ASSERT_EQ(rewritten.temporalLevelZeroIndex, (BYTE)(seq + 7));
+		ASSERT_EQ(data.size(), headerTemplate.GetHeaderSize() + len + packet->GetMediaLength() - descriptor.GetSize());
+
+		//Keep it as template for next ones too
+		if (seq == 100)
+			SetTemplate(packet);
+	}
+}
+
+TEST_F(TestRTPHeaderTemplate, Mismatch)
+{
+	SetTemplate(CreatePacket(MediaFrame::Video, 1));
+
+	//Different mid
+	auto packet = CreatePacket(MediaFrame::Video, 2);
+	packet->SetMediaStreamId("other");
+	EXPECT_FALSE(headerTemplate.Matches(*packet, ext));
+
+	//New extension
+	packet = CreatePacket(MediaFrame::Video, 2);
+	packet->SetPlayoutDelay(0, 100);
+	EXPECT_FALSE(headerTemplate.Matches(*packet, ext));
+
+	//Removed extension
+	packet = CreatePacket(MediaFrame::Video, 2);
+	packet->DisableTransportSeqNum();
+	EXPECT_FALSE(headerTemplate.Matches(*packet, ext));
+
+	//Extension not patched
+	packet = CreatePacket(MediaFrame::Video, 2);
+	packet->SetTimeOffset(10);
+	EXPECT_FALSE(headerTemplate.Matches(*packet, ext));
+
+	//Different extension ids
+	RTPMap other;
+	other.SetCodecForType(10, RTPHeaderExtension::TransportWideCC);
+	other.SetCodecForType(AbsSentTimeId, RTPHeaderExtension::AbsoluteSendTime);
+	other.SetCodecForType(MidId, RTPHeaderExtension::MediaStreamId);
+	packet = CreatePacket(MediaFrame::Video, 2);
+	EXPECT_FALSE(headerTemplate.Matches(*packet, other));
+
+	//Extension not negotiated is not written so it can have any value
+	RTPMap noMid;
+	noMid.SetCodecForType(TransportWideCCId, RTPHeaderExtension::TransportWideCC);
+	noMid.SetCodecForType(AbsSentTimeId, RTPHeaderExtension::AbsoluteSendTime);
+	packet = CreatePacket(MediaFrame::Video, 2);
+	ext = noMid;
+	SetTemplate(packet);
+	packet = CreatePacket(MediaFrame::Video, 3);
+	packet->SetMediaStreamId("other");
+	EXPECT_TRUE(headerTemplate.Matches(*packet, ext));
+	EXPECT_EQ(Serialize(packet), SerializeTemplate(packet));
+
+	//After reset
+	headerTemplate.Reset();
+	EXPECT_FALSE(headerTemplate.Matches(*packet, ext));
+}
+
+TEST_F(TestRTPHeaderTemplate, Unsupported)
+{
+	//Rtx packets are not templated
+	auto packet = CreatePacket(MediaFrame::Video, 1);
+	packet->SetOSN(1);
+	auto data = Serialize(packet);
+	EXPECT_FALSE(headerTemplate.Set(*packet, ext, data.data(), data.size()));
+	EXPECT_TRUE(headerTemplate.IsEmpty());
+}
+
+TEST_F(TestRTPHeaderTemplate, Overflow)
+{
+	SetTemplate(CreatePacket(MediaFrame::Video, 1));
+
+	auto packet = CreatePacket(MediaFrame::Video, 899);
+	BYTE data[512];
+	EXPECT_EQ(0, headerTemplate.Serialize(*packet, data, sizeof(data)));
+}
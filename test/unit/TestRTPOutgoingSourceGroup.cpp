@@ -0,0 +1,100 @@
+#include "TestCommon.h"
+#include "rtp/RTPOutgoingSourceGroup.h"
+#include "video.h"
+
+class TestRTPOutgoingSourceGroup : public testing::Test
+{
+public:
+	static constexpr BYTE TransportWideCCId = 3;
+	static constexpr BYTE AbsSentTimeId = 5;
+	static constexpr BYTE MidId = 9;
+
+	TestRTPOutgoingSourceGroup() :
+		group(MediaFrame::Video, timeService)
+	{
+		ext.SetCodecForType(TransportWideCCId, RTPHeaderExtension::TransportWideCC);
+		ext.SetCodecForType(AbsSentTimeId, RTPHeaderExtension::AbsoluteSendTime);
+		ext.SetCodecForType(MidId, RTPHeaderExtension::MediaStreamId);
+	}
+
+	RTPPacket::shared CreatePacket(WORD seq)
+	{
+		auto packet = std::make_shared<RTPPacket>(MediaFrame::Video, VideoCodec::VP8);
+		packet->SetSeqNum(seq);
+		packet->SetSSRC(0x1234);
+		packet->SetPayloadType(96);
+		packet->SetTimestamp(seq * 3000);
+		packet->SetMediaStreamId("video");
+		packet->SetTransportSeqNum(seq + 100);
+		packet->SetAbsSentTime(1000 + seq);
+		BYTE payload[800];
+		memset(payload, seq, sizeof(payload));
+		packet->SetPayload(payload, sizeof(payload));
+		return packet;
+	}
+
+	DWORD AddPacket(WORD seq, BYTE* data)
+	{
+		auto packet = CreatePacket(seq);
+		DWORD len = packet->Serialize(data, MTU, ext);
+		group.AddSerializedPacket(packet, data, len, TransportWideCCId, AbsSentTimeId);
+		return len;
+	}
+protected:
+	TestTimeService timeService;
+	RTPOutgoingSourceGroup group;
+	RTPMap ext;
+};
+
+TEST_F(TestRTPOutgoingSourceGroup, SerializedCacheDisabled)
+{
+	BYTE data[MTU];
+	AddPacket(1, data);
+	ASSERT_EQ(group.GetSerializedPacket(1), nullptr);
+}
+
+TEST_F(TestRTPOutgoingSourceGroup, SerializedCachePatch)
+{
+	group.SetSerializedCacheSize(64);
+
+	BYTE data[MTU];
+	DWORD len = AddPacket(10, data);
+
+	auto serialized = group.GetSerializedPacket(10);
+	ASSERT_NE(serialized, nullptr);
+	ASSERT_EQ(serialized->size, len);
+	ASSERT_EQ(0, memcmp(serialized->data, data, len));
+	ASSERT_EQ(serialized->size - serialized->headerSize, 800);
+	ASSERT_EQ(serialized->mediaLength, 800);
+	ASSERT_NE(serialized->transportSeqNumOffset, 0);
+	ASSERT_NE(serialized->absSentTimeOffset, 0);
+
+	//Patching the extension values must give the same bytes than serializing again
+	auto packet = CreatePacket(10);
+	packet->SetTransportSeqNum(500);
+	packet->SetAbsSentTime(123456);
+	BYTE expected[MTU];
+	ASSERT_EQ(packet->Serialize(expected, sizeof(expected), ext), len);
+
+	BYTE patched[MTU];
+	memcpy(patched, serialized->data, serialized->size);
+	set2(patched, serialized->transportSeqNumOffset, 500);
+	set3(patched, serialized->absSentTimeOffset, ((123456ull << 18) / 1000));
+	ASSERT_EQ(0, memcmp(patched, expected, len));
+}
+
+TEST_F(TestRTPOutgoingSourceGroup, SerializedCacheBounded)
+{
+	//Rounded to a power of two
+	group.SetSerializedCacheSize(48);
+
+	BYTE data[MTU];
+	for (WORD seq = 65500; seq != 100; ++seq)
+		AddPacket(seq, data);
+
+	//Only the last ones are kept
+	ASSERT_NE(group.GetSerializedPacket(99), nullptr);
+	ASSERT_NE(group.GetSerializedPacket(100 - 64), nullptr);
+	ASSERT_EQ(group.GetSerializedPacket(100 - 65), nullptr);
+	ASSERT_EQ(group.GetSerializedPacket(100), nullptr);
+}
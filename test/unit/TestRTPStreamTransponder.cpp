@@ -1,6 +1,7 @@
 #include "TestCommon.h"
 #include "VP8TestBase.h"
 #include "rtp/RTPStreamTransponder.h"
+#include "rtp/RTPIncomingMediaStreamMultiplexer.h"
 #include <limits>
 
 class MockRTPSender : public RTPSender
@@ -9,6 +10,7 @@ public:
 	virtual int Enqueue(const RTPPacket::shared& packet)
 	{
 		lastPacket = packet;
+		packets.push_back(packet);
 		return 0;
 	};
 
@@ -18,8 +20,14 @@ public:
 		return lastPacket;
 	}
 
+	inline const std::vector<RTPPacket::shared>& GetPackets()
+	{
+		return packets;
+	}
+
 private:
 	RTPPacket::shared lastPacket;
+	std::vector<RTPPacket::shared> packets;
 };
 
 class MockRTPIncomingMediaStream : public RTPIncomingMediaStream
@@ -138,6 +146,54 @@ TEST_P(TestRTPStreamTransponder, Dropping)
 	ASSERT_NO_FATAL_FAILURE(Add(MarkerPacket(3000, 0), GetExpectedPicId(3), GetExpectedTl0PicId(3)));
 }
 
+TEST_P(TestRTPStreamTransponder, Batch)
+{
+	//Receive from a multiplexer, which gets the batches dispatched by the jitter buffer
+	auto multiplexer = std::make_shared<RTPIncomingMediaStreamMultiplexer>(stream, timerService);
+	transponder.SetIncoming(multiplexer, nullptr, false);
+
+	//First frame resets the transponder to the new stream
+	multiplexer->onRTP(stream.get(), std::vector<RTPPacket::shared>{ StartPacket(500, 0), MarkerPacket(500, 0) });
+	ASSERT_EQ(sender->GetPackets().size(), 2);
+
+	//Only forward the base temporal layer
+	transponder.SelectLayer(0, 0);
+
+	std::vector<RTPPacket::shared> batch = {
+		StartPacket(1000, 0),
+		MarkerPacket(1000, 0),
+		StartPacket(2000, 0, 1),
+		MarkerPacket(2000, 0, 1),
+		StartPacket(3000, 0),
+		MiddlePacket(3000, 0),
+		MarkerPacket(3000, 0),
+		StartPacket(4000, 0, 1),
+		MarkerPacket(4000, 0, 1)
+	};
+	multiplexer->onRTP(stream.get(), batch);
+
+	//Base layer packets are sent in order
+	std::vector<RTPPacket::shared> sent(sender->GetPackets().begin() + 2, sender->GetPackets().end());
+	ASSERT_EQ(sent.size(), 5);
+	const uint64_t timestamps[5] = { 1000, 1000, 3000, 3000, 3000 };
+	const bool marks[5] = { false, true, false, false, true };
+	for (size_t i = 0; i < sent.size(); ++i)
+	{
+		ASSERT_EQ(sent[i]->vp8PayloadDescriptor->temporalLayerIndex, 0) << "packet " << i;
+		ASSERT_EQ(sent[i]->GetMark(), marks[i]) << "packet " << i;
+		ASSERT_EQ(sent[i]->GetExtTimestamp() - sent[0]->GetExtTimestamp(), timestamps[i] - timestamps[0]) << "packet " << i;
+		ASSERT_EQ(sent[i]->GetSeqNum(), (WORD)(sender->GetPackets()[1]->GetSeqNum() + i + 1)) << "packet " << i;
+	}
+
+	//Picture ids are kept continuous over the dropped frame
+	ASSERT_EQ(sent[0]->vp8PayloadDescriptor->pictureId, GetExpectedPicId(2));
+	ASSERT_EQ(sent[0]->vp8PayloadDescriptor->temporalLevelZeroIndex, GetExpectedTl0PicId(2));
+	ASSERT_EQ(sent[4]->vp8PayloadDescriptor->pictureId, GetExpectedPicId(3));
+	ASSERT_EQ(sent[4]->vp8PayloadDescriptor->temporalLevelZeroIndex, GetExpectedTl0PicId(3));
+
+	multiplexer->Stop();
+}
+
 INSTANTIATE_TEST_SUITE_P(TestVP8LayerSelectorCases,
 	TestRTPStreamTransponder,
 	testing::Values(std::pair(0, 0),
@@ -0,0 +1,140 @@
+#include "TestCommon.h"
+#include "ShardRoutingTable.h"
+
+#include <atomic>
+#include <thread>
+
+static constexpr uint32_t Remote = 0x0A000001;	//10.0.0.1
+static constexpr uint32_t Spoofed = 0x0A000002;	//10.0.0.2
+
+TEST(TestShardRoutingTable, OwnerSelection)
+{
+	ShardRoutingTable table(3);
+
+	//Connections are spread on the least loaded shards
+	ASSERT_EQ(table.AddOwner("a"), 0);
+	ASSERT_EQ(table.AddOwner("b"), 1);
+	ASSERT_EQ(table.AddOwner("c"), 2);
+	ASSERT_EQ(table.AddOwner("d"), 0);
+	ASSERT_EQ(table.GetLoad(0), 2);
+
+	//Removed ones free their shard
+	ASSERT_EQ(table.RemoveOwner("b"), 1);
+	ASSERT_EQ(table.GetLoad(1), 0);
+	ASSERT_EQ(table.AddOwner("e"), 1);
+
+	//Unknown ones
+	ASSERT_FALSE(table.RemoveOwner("b"));
+	ASSERT_FALSE(table.GetOwner("b"));
+
+	//Restarted ones keep their shard without changing the load
+	ASSERT_EQ(table.RestartOwner("c", "f"), 2);
+	ASSERT_FALSE(table.GetOwner("c"));
+	ASSERT_EQ(table.GetOwner("f"), 2);
+	ASSERT_EQ(table.GetLoad(2), 1);
+	ASSERT_FALSE(table.RestartOwner("c", "g"));
+}
+
+TEST(TestShardRoutingTable, LookupUsername)
+{
+	ShardRoutingTable table(2);
+
+	auto owner = table.AddOwner("remote:local");
+
+	//Found from any shard
+	ASSERT_EQ(table.Lookup(0, std::string_view("remote:local")), owner);
+	ASSERT_EQ(table.Lookup(1, std::string_view("remote:local")), owner);
+	ASSERT_FALSE(table.Lookup(1, std::string_view("other:local")));
+
+	//Shards see the changes done after their last lookup
+	table.RemoveOwner("remote:local");
+	ASSERT_FALSE(table.Lookup(0, std::string_view("remote:local")));
+	ASSERT_FALSE(table.Lookup(1, std::string_view("remote:local")));
+
+	//Out of range
+	ASSERT_FALSE(table.Lookup(2, std::string_view("remote:local")));
+}
+
+TEST(TestShardRoutingTable, CandidateAddedRemoved)
+{
+	ShardRoutingTable table(2);
+
+	ASSERT_FALSE(table.Lookup(0, Remote, 5000));
+
+	//Authenticated by shard 1
+	table.AddRemote(1, Remote, 5000);
+	ASSERT_EQ(table.Lookup(0, Remote, 5000), 1);
+	ASSERT_EQ(table.Lookup(1, Remote, 5000), 1);
+	//Other ports are not routed
+	ASSERT_FALSE(table.Lookup(0, Remote, 5001));
+
+	//Moved to shard 0, ie. an ICE restart
+	table.AddRemote(0, Remote, 5000);
+	ASSERT_EQ(table.Lookup(1, Remote, 5000), 0);
+
+	//Removal from the previous owner is ignored
+	ASSERT_FALSE(table.RemoveRemote(1, Remote, 5000));
+	ASSERT_EQ(table.Lookup(1, Remote, 5000), 0);
+
+	//Removal from the owner
+	ASSERT_TRUE(table.RemoveRemote(0, Remote, 5000));
+	ASSERT_FALSE(table.Lookup(1, Remote, 5000));
+	ASSERT_FALSE(table.RemoveRemote(0, Remote, 5000));
+}
+
+TEST(TestShardRoutingTable, SpoofedBindingRequest)
+{
+	ShardRoutingTable table(2);
+
+	auto owner = table.AddOwner("remote:local");
+	auto other = 1 - owner;
+
+	//Unauthenticated binding request with a known username from a spoofed address received on the other shard
+	ASSERT_EQ(table.Lookup(other, std::string_view("remote:local")), owner);
+
+	//It is handed over to the owner, but the spoofed address is not routed
+	ASSERT_FALSE(table.Lookup(other, Spoofed, 5000));
+	ASSERT_FALSE(table.Lookup(owner, Spoofed, 5000));
+
+	//Only once the owner authenticates the real remote
+	table.AddRemote(owner, Remote, 5000);
+	ASSERT_EQ(table.Lookup(other, Remote, 5000), owner);
+	ASSERT_FALSE(table.Lookup(other, Spoofed, 5000));
+
+	//And the other shard can't remove it
+	ASSERT_FALSE(table.RemoveRemote(other, Remote, 5000));
+	ASSERT_EQ(table.Lookup(other, Remote, 5000), owner);
+}
+
+TEST(TestShardRoutingTable, ConcurrentLookups)
+{
+	ShardRoutingTable table(2);
+	std::atomic<bool> running = true;
+
+	//Shard 1 looks up while routes are changed from another thread
+	std::thread reader([&](){
+		while (running)
+		{
+			auto owner = table.Lookup(1, Remote, 5000);
+			if (owner)
+			{
+				ASSERT_EQ(*owner, 0);
+			}
+			table.Lookup(1, std::string_view("remote:local"));
+		}
+	});
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		table.AddOwner("remote:local");
+		table.AddRemote(0, Remote, 5000);
+		table.RemoveRemote(0, Remote, 5000);
+		table.RemoveOwner("remote:local");
+	}
+
+	running = false;
+	reader.join();
+
+	ASSERT_FALSE(table.Lookup(1, Remote, 5000));
+	ASSERT_FALSE(table.Lookup(1, std::string_view("remote:local")));
+}
@@ -0,0 +1,71 @@
+#include "TestCommon.h"
+#include "SharedOptional.h"
+#include "rtp/RTPPacket.h"
+#include "video.h"
+
+#include <vector>
+
+TEST(TestSharedOptional, Empty)
+{
+	SharedOptional<std::vector<int>> empty;
+	ASSERT_FALSE(empty);
+	ASSERT_FALSE(empty.has_value());
+	ASSERT_FALSE(empty.get());
+	ASSERT_EQ(empty, SharedOptional<std::vector<int>>(std::nullopt));
+	ASSERT_EQ(sizeof(empty), sizeof(std::shared_ptr<std::vector<int>>));
+}
+
+TEST(TestSharedOptional, CopyOnWrite)
+{
+	SharedOptional<std::vector<int>> value(std::vector<int>{1, 2, 3});
+	SharedOptional<std::vector<int>> copy = value;
+
+	//Copies share the same value
+	ASSERT_EQ(&*value, &*copy);
+
+	//Modifying one makes a private copy first
+	copy.modify().push_back(4);
+	ASSERT_NE(&*value, &*copy);
+	ASSERT_EQ(value->size(), 3);
+	ASSERT_EQ(copy->size(), 4);
+	ASSERT_NE(value, copy);
+
+	//Not shared anymore so it is modified in place
+	const auto* ptr = &*copy;
+	copy.modify().push_back(5);
+	ASSERT_EQ(ptr, &*copy);
+
+	//Reset only affects this one
+	copy.reset();
+	ASSERT_FALSE(copy);
+	ASSERT_TRUE(value);
+	ASSERT_EQ(value, (std::vector<int>{1, 2, 3}));
+}
+
+TEST(TestSharedOptional, FromOptional)
+{
+	std::optional<std::vector<bool>> optional = std::vector<bool>{true, false};
+	SharedOptional<std::vector<bool>> value = optional;
+	ASSERT_EQ(value, *optional);
+	ASSERT_EQ(value.get(), optional);
+
+	optional.reset();
+	value = optional;
+	ASSERT_FALSE(value);
+}
+
+TEST(TestSharedOptional, ClonedPacket)
+{
+	auto packet = std::make_shared<RTPPacket>(MediaFrame::Video, VideoCodec::AV1);
+	DependencyDescriptor dd;
+	dd.frameNumber = 1;
+	packet->SetDependencyDescriptor(dd);
+	auto cloned = packet->Clone();
+
+	//Clone shares it until it is modified
+	ASSERT_EQ(&*packet->GetDependencyDescriptor(), &*cloned->GetDependencyDescriptor());
+	cloned->OverrideFrameNumber(2);
+	ASSERT_NE(&*packet->GetDependencyDescriptor(), &*cloned->GetDependencyDescriptor());
+	ASSERT_EQ(packet->GetDependencyDescriptor()->frameNumber, 1);
+	ASSERT_EQ(cloned->GetDependencyDescriptor()->frameNumber, 2);
+}
@@ -0,0 +1,185 @@
+#include "TestCommon.h"
+#include "TimerWheel.h"
+
+#include <map>
+#include <random>
+
+struct TestEntry : public TimerWheel::Entry
+{
+	uint64_t id = 0;
+};
+
+TEST(TestTimerWheel, Basic)
+{
+	TimerWheel wheel(1000);
+	TestEntry a, b, c;
+	std::vector<TimerWheel::Entry*> expired;
+
+	ASSERT_TRUE(wheel.empty());
+	ASSERT_EQ(wheel.GetNextExpiration(), TimerWheel::Never);
+
+	wheel.Add(&a, 1010);
+	wheel.Add(&b, 1100);
+	wheel.Add(&c, 5000);
+	ASSERT_EQ(wheel.size(), 3);
+	ASSERT_TRUE(a.IsLinked());
+
+	//Nothing expired yet
+	wheel.Expire(1009, expired);
+	ASSERT_TRUE(expired.empty());
+
+	//First one
+	wheel.Expire(1010, expired);
+	ASSERT_EQ(expired.size(), 1);
+	ASSERT_EQ(expired[0], &a);
+	ASSERT_FALSE(a.IsLinked());
+	expired.clear();
+
+	//Remove second
+	wheel.Remove(&b);
+	ASSERT_FALSE(b.IsLinked());
+	ASSERT_EQ(wheel.size(), 1);
+	wheel.Expire(4999, expired);
+	ASSERT_TRUE(expired.empty());
+
+	//Reschedule third one earlier
+	wheel.Add(&c, 4000);
+	ASSERT_EQ(wheel.size(), 1);
+	wheel.Expire(5000, expired);
+	ASSERT_EQ(expired.size(), 1);
+	ASSERT_EQ(expired[0], &c);
+	ASSERT_TRUE(wheel.empty());
+}
+
+TEST(TestTimerWheel, PastDeadline)
+{
+	TimerWheel wheel(1000000);
+	TestEntry a;
+	std::vector<TimerWheel::Entry*> expired;
+
+	//Already expired entries fire on next call
+	wheel.Add(&a, 10);
+	ASSERT_LE(wheel.GetNextExpiration(), 1000000);
+	wheel.Expire(1000000, expired);
+	ASSERT_EQ(expired.size(), 1);
+}
+
+TEST(TestTimerWheel, FarDeadline)
+{
+	TimerWheel wheel(0);
+	TestEntry a;
+	std::vector<TimerWheel::Entry*> expired;
+
+	//Beyond wheel range
+	uint64_t deadline = 1ull << 40;
+	wheel.Add(&a, deadline);
+
+	//Never early
+	for (uint64_t now = 0; now < deadline; now += (1ull << 33))
+	{
+		ASSERT_LE(wheel.GetNextExpiration(), deadline);
+		wheel.Expire(now, expired);
+		ASSERT_TRUE(expired.empty());
+	}
+	wheel.Expire(deadline, expired);
+	ASSERT_EQ(expired.size(), 1);
+}
+
+TEST(TestTimerWheel, FarDeadlineUnaligned)
+{
+	//Same as event loop, wheel time is not aligned to any level
+	const uint64_t start = 1760000000123456ull;
+	const uint64_t hour = 3600000000ull;
+	const std::vector<uint64_t> delays = {
+		18 * hour + hour / 2,
+		(1ull << 36) - (1ull << 29),
+		(1ull << 36) - 1,
+		1ull << 36,
+		19 * hour,
+		(1ull << 36) + (1ull << 30),
+		72 * hour
+	};
+
+	for (auto delay : delays)
+	{
+		TimerWheel wheel(start);
+		TestEntry a;
+		std::vector<TimerWheel::Entry*> expired;
+		wheel.Add(&a, start + delay);
+
+		//Must return and not fire early
+		ASSERT_GT(wheel.GetNextExpiration(), start) << delay;
+		wheel.Expire(start + 1, expired);
+		ASSERT_TRUE(expired.empty()) << delay;
+		wheel.Expire(start + delay - 1, expired);
+		ASSERT_TRUE(expired.empty()) << delay;
+		ASSERT_LE(wheel.GetNextExpiration(), start + delay) << delay;
+		wheel.Expire(start + delay, expired);
+		ASSERT_EQ(expired.size(), 1) << delay;
+		ASSERT_TRUE(wheel.empty());
+	}
+
+	//Entries beyond the wheel can be removed and cleared
+	TimerWheel wheel(start);
+	TestEntry a, b;
+	std::vector<TimerWheel::Entry*> removed;
+	wheel.Add(&a, start + 72 * hour);
+	wheel.Add(&b, start + 96 * hour);
+	wheel.Remove(&a);
+	ASSERT_FALSE(a.IsLinked());
+	ASSERT_EQ(wheel.size(), 1);
+	wheel.Clear(removed);
+	ASSERT_EQ(removed.size(), 1);
+	ASSERT_FALSE(b.IsLinked());
+	ASSERT_EQ(wheel.GetNextExpiration(), TimerWheel::Never);
+}
+
+TEST(TestTimerWheel, Random)
+{
+	std::mt19937_64 rand(1234);
+	TimerWheel wheel(0);
+	std::vector<TestEntry> entries(2000);
+	std::vector<TimerWheel::Entry*> expired;
+	std::map<uint64_t, uint64_t> pending;
+	uint64_t now = 0;
+
+	for (size_t i = 0; i < entries.size(); ++i)
+		entries[i].id = i;
+
+	for (size_t round = 0; round < 20000; ++round)
+	{
+		auto& entry = entries[rand() % entries.size()];
+		//Schedule or cancel
+		if (rand() % 4)
+		{
+			uint64_t deadline = now + (rand() % (1ull << (rand() % 30)));
+			wheel.Add(&entry, deadline);
+			pending[entry.id] = deadline;
+		} else {
+			wheel.Remove(&entry);
+			pending.erase(entry.id);
+		}
+		ASSERT_EQ(wheel.size(), pending.size());
+
+		//Advance time
+		now += rand() % 5000;
+		expired.clear();
+		wheel.Expire(now, expired);
+
+		//Check all expired ones were due and not cancelled
+		for (auto expiredEntry : expired)
+		{
+			auto id = static_cast<TestEntry*>(expiredEntry)->id;
+			auto it = pending.find(id);
+			ASSERT_NE(it, pending.end());
+			ASSERT_LE(it->second, now);
+			pending.erase(it);
+		}
+		//Check no due one is left
+		for (const auto& [id, deadline] : pending)
+		{
+			ASSERT_GT(deadline, now);
+			ASSERT_LE(wheel.GetNextExpiration(), deadline);
+		}
+	}
+}
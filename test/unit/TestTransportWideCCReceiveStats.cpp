@@ -0,0 +1,140 @@
+#include "TestCommon.h"
+#include "rtp/TransportWideCCReceiveStats.h"
+#include "rtp/RTCPRTPFeedback.h"
+
+#include <random>
+
+class TestTransportWideCCReceiveStats : public testing::Test
+{
+public:
+	//Serialize same packets with the map based field
+	static std::vector<BYTE> SerializeField(BYTE feedbackPacketCount, const std::map<DWORD,QWORD>& packets)
+	{
+		RTCPRTPFeedback::TransportWideFeedbackMessageField field(feedbackPacketCount);
+		field.packets.assign(packets.begin(), packets.end());
+		std::vector<BYTE> data(field.GetSize() + 16);
+		DWORD len = field.Serialize(data.data(), data.size());
+		data.resize(len);
+		return data;
+	}
+
+	static std::vector<BYTE> Serialize(TransportWideCCReceiveStats& stats, BYTE feedbackPacketCount, DWORD size = MTU)
+	{
+		std::vector<BYTE> data(size);
+		DWORD len = stats.Serialize(feedbackPacketCount, data.data(), data.size());
+		data.resize(len);
+		return data;
+	}
+
+	TransportWideCCReceiveStats stats;
+};
+
+TEST_F(TestTransportWideCCReceiveStats, MatchesField)
+{
+	std::mt19937 rand(1234);
+
+	DWORD seq = 65000;
+	QWORD time = 1000000;
+	for (BYTE fb = 0; fb < 200; ++fb)
+	{
+		std::map<DWORD,QWORD> packets;
+
+		//Random losses and deltas, sometimes negative or big
+		DWORD num = 1 + rand() % 300;
+		for (DWORD i = 0; i < num; ++i, ++seq)
+		{
+			DWORD r = rand() % 100;
+			if (r < 10 && i && i < num - 1)
+			{
+				packets[seq] = 0;
+				continue;
+			}
+			if (r < 15)
+				time += 40000 + rand() % 100000;
+			else if (r < 20 && time > 10000)
+				time -= rand() % 10000;
+			else
+				time += rand() % 5000;
+			packets[seq] = time;
+			ASSERT_TRUE(stats.Add(seq, time));
+		}
+
+		auto expected = SerializeField(fb, packets);
+		auto serialized = Serialize(stats, fb);
+		ASSERT_EQ(expected, serialized) << "feedback " << (int)fb;
+		EXPECT_TRUE(stats.IsEmpty());
+	}
+}
+
+TEST_F(TestTransportWideCCReceiveStats, LostBetweenFeedbacks)
+{
+	//First feedback
+	stats.Add(10, 1000);
+	stats.Add(11, 2000);
+	EXPECT_EQ(2, stats.GetPending());
+	Serialize(stats, 0);
+
+	//Next one starts after the last reported, missing ones are lost
+	stats.Add(15, 7000);
+	EXPECT_EQ(1, stats.GetReceived());
+	EXPECT_EQ(4, stats.GetPending());
+	EXPECT_EQ(15, stats.GetMaxExtSeqNum());
+
+	auto data = Serialize(stats, 1);
+	ASSERT_GE(data.size(), 8);
+	EXPECT_EQ(12, get2(data.data(), 0));
+	EXPECT_EQ(4, get2(data.data(), 2));
+
+	//Already reported ones are dropped
+	EXPECT_FALSE(stats.Add(13, 8000));
+	EXPECT_TRUE(stats.IsEmpty());
+}
+
+TEST_F(TestTransportWideCCReceiveStats, Reorder)
+{
+	//Out of order before first feedback moves the window start back
+	stats.Add(20, 2000);
+	stats.Add(18, 1000);
+	EXPECT_EQ(3, stats.GetPending());
+
+	std::map<DWORD,QWORD> packets = {{18,1000},{19,0},{20,2000}};
+	EXPECT_EQ(SerializeField(0, packets), Serialize(stats, 0));
+}
+
+TEST_F(TestTransportWideCCReceiveStats, Window)
+{
+	//Can't grow past the ring size while there are packets pending
+	EXPECT_TRUE(stats.Add(0, 1000));
+	EXPECT_FALSE(stats.Add(TransportWideCCReceiveStats::Size, 2000));
+	Serialize(stats, 0);
+
+	//After feedback a big jump skips the losses
+	EXPECT_TRUE(stats.Add(TransportWideCCReceiveStats::Size * 2, 3000));
+	EXPECT_EQ(1, stats.GetPending());
+}
+
+TEST_F(TestTransportWideCCReceiveStats, Truncate)
+{
+	//All large deltas don't fit in a small buffer, rest is kept for next one
+	QWORD time = 1000000;
+	for (DWORD i = 0; i < 1000; ++i)
+		stats.Add(i, time += 100000);
+
+	auto data = Serialize(stats, 0, 500);
+	ASSERT_FALSE(data.empty());
+	ASSERT_LE(data.size(), 500);
+	DWORD count = get2(data.data(), 2);
+	EXPECT_LT(count, 1000);
+	EXPECT_EQ(1000 - count, stats.GetReceived());
+
+	//Drain the rest
+	DWORD total = count;
+	while (!stats.IsEmpty())
+	{
+		data = Serialize(stats, 0, 500);
+		ASSERT_FALSE(data.empty());
+		EXPECT_EQ(total, get2(data.data(), 0));
+		total += get2(data.data(), 2);
+	}
+	EXPECT_EQ(1000, total);
+}
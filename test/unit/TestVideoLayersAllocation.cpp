@@ -46,9 +46,9 @@ TEST(TestVideoLayersAllocation, CanWriteAndParse2SpatialWith2TemporalLayers)
 	extension.hasVideoLayersAllocation = true;
 	extension.videoLayersAllocation.emplace();
 
-	extension.videoLayersAllocation->streamIdx = 1;
-	extension.videoLayersAllocation->numRtpStreams = 2;
-	extension.videoLayersAllocation->activeSpatialLayers = 
+	extension.videoLayersAllocation.modify().streamIdx = 1;
+	extension.videoLayersAllocation.modify().numRtpStreams = 2;
+	extension.videoLayersAllocation.modify().activeSpatialLayers = 
 	{
 		{
 			/*streamIdx*/ 0,
@@ -88,9 +88,9 @@ TEST(TestVideoLayersAllocation, CanWriteAndParseAllocationWithDifferentNumerOfSp
 	extension.hasVideoLayersAllocation = true;
 	extension.videoLayersAllocation.emplace();
 
-	extension.videoLayersAllocation->streamIdx = 1;
-	extension.videoLayersAllocation->numRtpStreams = 2;
-	extension.videoLayersAllocation->activeSpatialLayers =
+	extension.videoLayersAllocation.modify().streamIdx = 1;
+	extension.videoLayersAllocation.modify().numRtpStreams = 2;
+	extension.videoLayersAllocation.modify().activeSpatialLayers =
 	{
 		{
 			/*streamIdx*/ 0,
@@ -135,9 +135,9 @@ TEST(TestVideoLayersAllocation, CanWriteAndParseAllocationWithSkippedLowerSpatia
 	extension.hasVideoLayersAllocation = true;
 	extension.videoLayersAllocation.emplace();
 
-	extension.videoLayersAllocation->streamIdx = 1;
-	extension.videoLayersAllocation->numRtpStreams = 2;
-	extension.videoLayersAllocation->activeSpatialLayers =
+	extension.videoLayersAllocation.modify().streamIdx = 1;
+	extension.videoLayersAllocation.modify().numRtpStreams = 2;
+	extension.videoLayersAllocation.modify().activeSpatialLayers =
 	{
 		{
 			/*streamIdx*/ 0,
@@ -177,9 +177,9 @@ TEST(TestVideoLayersAllocation,	CanWriteAndParseAllocationWithSkippedRtpStreamId
 	extension.hasVideoLayersAllocation = true;
 	extension.videoLayersAllocation.emplace();
 
-	extension.videoLayersAllocation->streamIdx = 2;
-	extension.videoLayersAllocation->numRtpStreams = 3;
-	extension.videoLayersAllocation->activeSpatialLayers =
+	extension.videoLayersAllocation.modify().streamIdx = 2;
+	extension.videoLayersAllocation.modify().numRtpStreams = 3;
+	extension.videoLayersAllocation.modify().activeSpatialLayers =
 	{
 		{
 			/*streamIdx*/ 0,
@@ -221,9 +221,9 @@ TEST(TestVideoLayersAllocation, CanWriteAndParseAllocationWithDifferentNumerOfTe
 	extension.hasVideoLayersAllocation = true;
 	extension.videoLayersAllocation.emplace();
 
-	extension.videoLayersAllocation->streamIdx = 1;
-	extension.videoLayersAllocation->numRtpStreams = 3;
-	extension.videoLayersAllocation->activeSpatialLayers =
+	extension.videoLayersAllocation.modify().streamIdx = 1;
+	extension.videoLayersAllocation.modify().numRtpStreams = 3;
+	extension.videoLayersAllocation.modify().activeSpatialLayers =
 	{
 		{
 			/*streamIdx*/ 0,
@@ -257,9 +257,9 @@ TEST(TestVideoLayersAllocation, CanWriteAndParseAllocationWithResolution)
 	extension.hasVideoLayersAllocation = true;
 	extension.videoLayersAllocation.emplace();
 
-	extension.videoLayersAllocation->streamIdx = 1;
-	extension.videoLayersAllocation->numRtpStreams = 3;
-	extension.videoLayersAllocation->activeSpatialLayers =
+	extension.videoLayersAllocation.modify().streamIdx = 1;
+	extension.videoLayersAllocation.modify().numRtpStreams = 3;
+	extension.videoLayersAllocation.modify().activeSpatialLayers =
 	{
 		{
 			/*streamIdx*/ 0,
@@ -298,7 +298,7 @@ TEST(TestVideoLayersAllocation, WriteEmptyAllocationCanHaveAnyRtpStreamIndex)
 	//Empty layer
 	extension.hasVideoLayersAllocation = true;
 	extension.videoLayersAllocation.emplace();
-	extension.videoLayersAllocation->streamIdx = 1;
+	extension.videoLayersAllocation.modify().streamIdx = 1;
 
 	//Serialize
 	int len = extension.Serialize(extMap, buffer.data(), buffer.size());
@@ -0,0 +1,50 @@
+#include "TestCommon.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <thread>
+
+TEST(TestWorkerPool, RunsInOrder)
+{
+	std::vector<int> order;
+	std::thread::id id;
+	{
+		WorkerPool pool(1, "test-worker");
+		ASSERT_EQ(pool.GetSize(), 1);
+
+		//Single worker runs them in arrival order out of the caller thread
+		for (int i = 0; i < 100; ++i)
+			pool.Post([&order, &id, i]() {
+				id = std::this_thread::get_id();
+				order.push_back(i);
+			});
+	}
+	//Pending tasks are run before the pool is destroyed
+	ASSERT_EQ(order.size(), 100);
+	for (int i = 0; i < 100; ++i)
+		ASSERT_EQ(order[i], i);
+	ASSERT_NE(id, std::this_thread::get_id());
+}
+
+TEST(TestWorkerPool, Concurrent)
+{
+	std::atomic<size_t> done = 0;
+	std::atomic<size_t> running = 0;
+	std::atomic<size_t> maxRunning = 0;
+	{
+		WorkerPool pool(4, "test-worker");
+
+		for (int i = 0; i < 64; ++i)
+			pool.Post([&]() {
+				size_t now = ++running;
+				size_t max = maxRunning;
+				while (now > max && !maxRunning.compare_exchange_weak(max, now));
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				--running;
+				++done;
+			});
+	}
+	ASSERT_EQ(done, 64);
+	ASSERT_LE(maxRunning, 4);
+	ASSERT_GT(maxRunning, 1);
+}